@@ -0,0 +1,166 @@
+#ifndef CACHED_RATE_CALCULATOR_H
+#define CACHED_RATE_CALCULATOR_H
+
+#include "event_selector.hpp"
+#include "random.hpp"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+class CachedRateCalculatorTest;
+
+namespace lotto
+{
+/*
+ * Counters describing how often a cached rate calculator was able to reuse a rate
+ */
+struct RateCacheStatistics
+{
+    // Number of rates served from the cache
+    UIntType n_hits = 0;
+
+    // Number of rates that had to be calculated by the inner calculator
+    UIntType n_misses = 0;
+
+    // Fraction of lookups served from the cache (zero if nothing has been looked up)
+    double hit_ratio() const
+    {
+        UIntType n_lookups = n_hits + n_misses;
+        return n_lookups == 0 ? 0.0 : static_cast<double>(n_hits) / static_cast<double>(n_lookups);
+    }
+};
+
+/*
+ * Rate calculator adapter that memoizes the rates of an inner rate calculator
+ *
+ * The inner calculator must provide, in addition to calculate_rate, a method
+ *     UIntType environment_key(const EventIDType& event_id)
+ * that returns a key identifying the local environment of an event, such that
+ * events with equal keys are guaranteed to have equal rates.
+ *
+ * Rates are stored in a fixed-size, direct-mapped table, so memory use is bounded
+ * and a newly calculated rate simply replaces whatever occupied its slot.
+ * The cache must be cleared if the inner calculator changes in a way that affects
+ * rates for a given key (e.g. a change of temperature).
+ *
+ * The table and counters are not synchronized, so the adapter is not thread-safe. It must not be shared by threads
+ * calculating rates concurrently, e.g. by a RejectionFreeEventSelector after set_n_threads with more than one thread.
+ */
+template <typename InnerRateCalculatorType>
+class CachedRateCalculator
+{
+public:
+    // Construct given the inner rate calculator and the number of cache slots (rounded up to a power of two)
+    CachedRateCalculator(const std::shared_ptr<InnerRateCalculatorType>& inner_calculator_ptr, std::size_t capacity)
+        : inner_calculator_ptr(inner_calculator_ptr), cache(rounded_capacity(capacity)), slot_mask(cache.size() - 1)
+    {
+    }
+
+    // Returns the rate for an event, calculating it with the inner calculator only if its environment is not cached
+    template <typename EventIDType>
+    double calculate_rate(const EventIDType& event_id)
+    {
+        UIntType key = inner_calculator_ptr->environment_key(event_id);
+        CacheEntry& entry = cache[slot_index(key)];
+        if (entry.is_occupied && entry.key == key)
+        {
+            ++statistics.n_hits;
+            return entry.rate;
+        }
+        ++statistics.n_misses;
+
+        // The slot is only overwritten once the rate is known, so it is left unchanged if the calculation throws
+        double rate = inner_calculator_ptr->calculate_rate(event_id);
+        entry.key = key;
+        entry.rate = rate;
+        entry.is_occupied = true;
+        return rate;
+    }
+
+    // Forwards to the inner calculator, if it reports rate changes, otherwise always returns true
+    template <typename EventIDType>
+    bool has_rate_changed(const EventIDType& event_id)
+    {
+        if constexpr (has_rate_change_hook<InnerRateCalculatorType, EventIDType>::value)
+        {
+            return inner_calculator_ptr->has_rate_changed(event_id);
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    // Discards all cached rates
+    void clear()
+    {
+        for (CacheEntry& entry : cache)
+        {
+            entry.is_occupied = false;
+        }
+        return;
+    }
+
+    // Returns the number of cache slots
+    std::size_t capacity() const { return cache.size(); }
+
+    // Returns the hit and miss counters accumulated since construction (or the last reset)
+    const RateCacheStatistics& get_statistics() const { return statistics; }
+
+    // Resets the hit and miss counters
+    void reset_statistics() { statistics = RateCacheStatistics(); }
+
+    // Returns the inner rate calculator
+    const std::shared_ptr<InnerRateCalculatorType>& inner_calculator() const { return inner_calculator_ptr; }
+
+private:
+    // A single cache slot
+    struct CacheEntry
+    {
+        UIntType key = 0;
+        double rate = 0.0;
+        bool is_occupied = false;
+    };
+
+    // Pointer to the calculator whose rates are cached
+    const std::shared_ptr<InnerRateCalculatorType> inner_calculator_ptr;
+
+    // Cache slots, the number of which is a power of two
+    std::vector<CacheEntry> cache;
+
+    // Mask for converting a hashed key into a slot index
+    const UIntType slot_mask;
+
+    // Hit and miss counters
+    RateCacheStatistics statistics;
+
+    // Returns the slot for a key, mixing the bits first so that structured keys spread over the table
+    std::size_t slot_index(UIntType key) const
+    {
+        // Finalizer from the splitmix64 generator
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        key = key ^ (key >> 31);
+        return key & slot_mask;
+    }
+
+    // Returns the smallest power of two no less than the requested capacity
+    static std::size_t rounded_capacity(std::size_t capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::runtime_error("Cache capacity must be positive.");
+        }
+        std::size_t rounded = 1;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    // Friend for testing
+    friend class ::CachedRateCalculatorTest;
+};
+} // namespace lotto
+#endif
@@ -0,0 +1,435 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "impact_provider.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LOTTO_HAS_MMAP
+#endif
+
+namespace lotto
+{
+/*
+ * Binary file format for event catalogs, i.e. event ID lists with impact tables and optionally initial rates,
+ * designed to be memory-mapped so that opening a catalog costs no parsing and no allocation
+ *
+ * All values are stored in native byte order, and each section starts at an offset that is a multiple of 8:
+ *     header       EventCatalogHeader, as below
+ *     event IDs    n_events values of the event ID type, sorted in increasing order
+ *     offsets      n_events + 1 values of type uint64_t, where the events impacted by event i are
+ *                  neighbors[offsets[i]], ..., neighbors[offsets[i + 1] - 1]
+ *     neighbors    n_impacts values of the event ID type, each of which must be one of the event IDs
+ *     rates        n_events values of type double, in the same order as the event IDs (only if flagged)
+ *
+ * The event ID type must be trivially copyable, and the same type must be used for writing and reading.
+ */
+struct EventCatalogHeader
+{
+    // Identifies the file as an event catalog
+    char magic[8];
+
+    // Format version
+    std::uint32_t version;
+
+    // Bit flags, see below
+    std::uint32_t flags;
+
+    // Written as 0x01020304, to detect a file written with a different byte order
+    std::uint32_t byte_order;
+
+    // Size in bytes of the event ID type
+    std::uint32_t id_size;
+
+    // Number of events, and total number of impacted events over all events
+    std::uint64_t n_events;
+    std::uint64_t n_impacts;
+
+    static constexpr char expected_magic[8] = {'L', 'O', 'T', 'T', 'O', 'C', 'A', 'T'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t expected_byte_order = 0x01020304;
+
+    // Flag set if initial rates are stored
+    static constexpr std::uint32_t has_rates_flag = 1;
+};
+
+/*
+ * Offsets in bytes of each section of an event catalog file, and its total size
+ */
+struct EventCatalogLayout
+{
+    std::uint64_t event_ids_offset;
+    std::uint64_t offsets_offset;
+    std::uint64_t neighbors_offset;
+    std::uint64_t rates_offset;
+    std::uint64_t file_size;
+
+    EventCatalogLayout(const EventCatalogHeader& header)
+    {
+        event_ids_offset = aligned(sizeof(EventCatalogHeader));
+        offsets_offset = aligned(event_ids_offset + header.n_events * header.id_size);
+        neighbors_offset = offsets_offset + (header.n_events + 1) * sizeof(std::uint64_t);
+        rates_offset = aligned(neighbors_offset + header.n_impacts * header.id_size);
+        file_size = rates_offset;
+        if (header.flags & EventCatalogHeader::has_rates_flag)
+        {
+            file_size += header.n_events * sizeof(double);
+        }
+    }
+
+    // Round up to the next multiple of 8
+    static std::uint64_t aligned(std::uint64_t offset) { return (offset + 7) / 8 * 8; }
+};
+
+/*
+ * Write an event catalog file given the event IDs, their impact table, and optionally their initial rates
+ * (in the same order as the event IDs, or empty to store none). Events missing from the table impact no others,
+ * and every impacted event must itself be in the event ID list.
+ */
+template <typename EventIDType>
+void write_event_catalog(const std::string& file_path,
+                         const std::vector<EventIDType>& event_id_list,
+                         const std::map<EventIDType, std::vector<EventIDType>>& impact_table,
+                         const std::vector<double>& initial_rates = std::vector<double>())
+{
+    static_assert(std::is_trivially_copyable<EventIDType>::value, "Event ID type must be trivially copyable.");
+    if (!initial_rates.empty() && initial_rates.size() != event_id_list.size())
+    {
+        throw std::runtime_error("Number of initial rates must match number of events.");
+    }
+
+    // Sort events, keeping track of their original positions for the rates
+    std::vector<std::size_t> sorted_positions(event_id_list.size());
+    std::iota(sorted_positions.begin(), sorted_positions.end(), 0);
+    std::sort(sorted_positions.begin(), sorted_positions.end(),
+              [&](std::size_t lhs, std::size_t rhs) { return event_id_list[lhs] < event_id_list[rhs]; });
+    std::vector<EventIDType> sorted_event_ids;
+    sorted_event_ids.reserve(event_id_list.size());
+    for (std::size_t position : sorted_positions)
+    {
+        if (!sorted_event_ids.empty() && !(sorted_event_ids.back() < event_id_list[position]))
+        {
+            throw std::runtime_error("Event IDs must be unique.");
+        }
+        sorted_event_ids.push_back(event_id_list[position]);
+    }
+
+    // Flatten impact table
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(sorted_event_ids.size() + 1);
+    offsets.push_back(0);
+    std::vector<EventIDType> neighbors;
+    for (const EventIDType& event_id : sorted_event_ids)
+    {
+        auto impact_it = impact_table.find(event_id);
+        if (impact_it != impact_table.end())
+        {
+            for (const EventIDType& impacted_event_id : impact_it->second)
+            {
+                if (!std::binary_search(sorted_event_ids.begin(), sorted_event_ids.end(), impacted_event_id))
+                {
+                    throw std::runtime_error("Impacted events must be in the event ID list.");
+                }
+            }
+            neighbors.insert(neighbors.end(), impact_it->second.begin(), impact_it->second.end());
+        }
+        offsets.push_back(neighbors.size());
+    }
+
+    EventCatalogHeader header;
+    std::memcpy(header.magic, EventCatalogHeader::expected_magic, sizeof(header.magic));
+    header.version = EventCatalogHeader::current_version;
+    header.flags = initial_rates.empty() ? 0 : EventCatalogHeader::has_rates_flag;
+    header.byte_order = EventCatalogHeader::expected_byte_order;
+    header.id_size = sizeof(EventIDType);
+    header.n_events = sorted_event_ids.size();
+    header.n_impacts = neighbors.size();
+    EventCatalogLayout layout(header);
+
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("Could not open event catalog file for writing: " + file_path);
+    }
+    auto write_at = [&](std::uint64_t offset, const void* data, std::size_t n_bytes) {
+        std::uint64_t position = file.tellp();
+        static const char padding[8] = {};
+        file.write(padding, offset - position);
+        file.write(static_cast<const char*>(data), n_bytes);
+    };
+    write_at(0, &header, sizeof(header));
+    write_at(layout.event_ids_offset, sorted_event_ids.data(), sorted_event_ids.size() * sizeof(EventIDType));
+    write_at(layout.offsets_offset, offsets.data(), offsets.size() * sizeof(std::uint64_t));
+    write_at(layout.neighbors_offset, neighbors.data(), neighbors.size() * sizeof(EventIDType));
+    if (!initial_rates.empty())
+    {
+        std::vector<double> sorted_rates;
+        sorted_rates.reserve(initial_rates.size());
+        for (std::size_t position : sorted_positions)
+        {
+            sorted_rates.push_back(initial_rates[position]);
+        }
+        write_at(layout.rates_offset, sorted_rates.data(), sorted_rates.size() * sizeof(double));
+    }
+    write_at(layout.file_size, nullptr, 0);
+    if (!file)
+    {
+        throw std::runtime_error("Could not write event catalog file: " + file_path);
+    }
+    return;
+}
+
+/*
+ * Read-only view of an event catalog file, which is memory-mapped where supported (and read into memory otherwise)
+ *
+ * Mapped pages are shared through the page cache by every process and thread that opens the same file.
+ * Events are looked up by binary search over the sorted IDs, so nothing is built on opening.
+ */
+template <typename EventIDType>
+class EventCatalog
+{
+public:
+    static_assert(std::is_trivially_copyable<EventIDType>::value, "Event ID type must be trivially copyable.");
+
+    // Open and validate a catalog file, throwing if it cannot be read or does not match the event ID type
+    explicit EventCatalog(const std::string& file_path) : mapped_data(nullptr), mapped_size(0)
+    {
+        map_file(file_path);
+        if (size() < sizeof(EventCatalogHeader))
+        {
+            throw std::runtime_error("Event catalog file is too small: " + file_path);
+        }
+        std::memcpy(&header, data(), sizeof(header));
+        if (std::memcmp(header.magic, EventCatalogHeader::expected_magic, sizeof(header.magic)) != 0)
+        {
+            throw std::runtime_error("Not an event catalog file: " + file_path);
+        }
+        if (header.version != EventCatalogHeader::current_version)
+        {
+            throw std::runtime_error("Unsupported event catalog version: " + file_path);
+        }
+        if (header.byte_order != EventCatalogHeader::expected_byte_order)
+        {
+            throw std::runtime_error("Event catalog was written with a different byte order: " + file_path);
+        }
+        if (header.id_size != sizeof(EventIDType))
+        {
+            throw std::runtime_error("Event catalog was written with a different event ID type: " + file_path);
+        }
+        // Counts larger than the file cannot be valid, and could overflow the layout calculation
+        if (header.n_events > size() || header.n_impacts > size())
+        {
+            throw std::runtime_error("Event catalog file is truncated: " + file_path);
+        }
+        EventCatalogLayout layout(header);
+        if (size() < layout.file_size)
+        {
+            throw std::runtime_error("Event catalog file is truncated: " + file_path);
+        }
+        event_ids_begin = reinterpret_cast<const EventIDType*>(data() + layout.event_ids_offset);
+        offsets_begin = reinterpret_cast<const std::uint64_t*>(data() + layout.offsets_offset);
+        neighbors_begin = reinterpret_cast<const EventIDType*>(data() + layout.neighbors_offset);
+        rates_begin = has_rates() ? reinterpret_cast<const double*>(data() + layout.rates_offset) : nullptr;
+        validate_sections(file_path);
+    }
+
+    EventCatalog(const EventCatalog&) = delete;
+    EventCatalog& operator=(const EventCatalog&) = delete;
+
+    ~EventCatalog()
+    {
+#ifdef LOTTO_HAS_MMAP
+        if (mapped_data != nullptr)
+        {
+            munmap(mapped_data, mapped_size);
+        }
+#endif
+    }
+
+    // Returns the number of events
+    std::size_t n_events() const { return header.n_events; }
+
+    // Returns true if initial rates are stored
+    bool has_rates() const { return header.flags & EventCatalogHeader::has_rates_flag; }
+
+    // Returns a copy of the event IDs, in increasing order
+    std::vector<EventIDType> event_id_list() const
+    {
+        return std::vector<EventIDType>(event_ids_begin, event_ids_begin + n_events());
+    }
+
+    // Returns a copy of the initial rates, in the same order as the event IDs, or an empty list if none are stored
+    std::vector<double> initial_rates() const
+    {
+        return has_rates() ? std::vector<double>(rates_begin, rates_begin + n_events()) : std::vector<double>();
+    }
+
+    // Returns the range of event IDs, in increasing order, viewed in place in the catalog
+    std::pair<const EventIDType*, const EventIDType*> event_id_range() const
+    {
+        return std::make_pair(event_ids_begin, event_ids_begin + n_events());
+    }
+
+    // Returns the range of initial rates, in the same order as the event IDs, viewed in place in the catalog
+    // The range is empty if no rates are stored
+    std::pair<const double*, const double*> initial_rate_range() const
+    {
+        return has_rates() ? std::make_pair(rates_begin, rates_begin + n_events())
+                           : std::make_pair(rates_begin, rates_begin);
+    }
+
+    // Returns the range of events impacted by an event, which is empty if the event is not in the catalog
+    std::pair<const EventIDType*, const EventIDType*> impacted_events(const EventIDType& event_id) const
+    {
+        const EventIDType* event_ids_end = event_ids_begin + n_events();
+        const EventIDType* event_it = std::lower_bound(event_ids_begin, event_ids_end, event_id);
+        if (event_it == event_ids_end || event_id < *event_it)
+        {
+            return std::make_pair(neighbors_begin, neighbors_begin);
+        }
+        std::size_t event_ix = event_it - event_ids_begin;
+        return std::make_pair(neighbors_begin + offsets_begin[event_ix], neighbors_begin + offsets_begin[event_ix + 1]);
+    }
+
+private:
+    // Copy of the header
+    EventCatalogHeader header;
+
+    // Mapped file, if memory-mapped
+    void* mapped_data;
+    std::size_t mapped_size;
+
+    // File contents, if read into memory instead
+    std::vector<char> file_contents;
+
+    // Start of each section
+    const EventIDType* event_ids_begin;
+    const std::uint64_t* offsets_begin;
+    const EventIDType* neighbors_begin;
+    const double* rates_begin;
+
+    const char* data() const
+    {
+        return mapped_data != nullptr ? static_cast<const char*>(mapped_data) : file_contents.data();
+    }
+
+    std::size_t size() const { return mapped_data != nullptr ? mapped_size : file_contents.size(); }
+
+    // Check once that event IDs are sorted, that the offsets are monotonic and within the neighbors section, and that
+    // every neighbor is one of the events, so that lookups and selectors can use them without further checks
+    void validate_sections(const std::string& file_path) const
+    {
+        for (std::size_t event_ix = 1; event_ix < n_events(); ++event_ix)
+        {
+            if (!(event_ids_begin[event_ix - 1] < event_ids_begin[event_ix]))
+            {
+                throw std::runtime_error("Event catalog event IDs are not sorted and unique: " + file_path);
+            }
+        }
+        if (offsets_begin[0] != 0 || offsets_begin[n_events()] != header.n_impacts)
+        {
+            throw std::runtime_error("Event catalog offsets do not match the number of impacts: " + file_path);
+        }
+        for (std::size_t event_ix = 0; event_ix < n_events(); ++event_ix)
+        {
+            if (offsets_begin[event_ix] > offsets_begin[event_ix + 1])
+            {
+                throw std::runtime_error("Event catalog offsets are not monotonic: " + file_path);
+            }
+        }
+        const EventIDType* event_ids_end = event_ids_begin + n_events();
+        for (std::size_t impact_ix = 0; impact_ix < header.n_impacts; ++impact_ix)
+        {
+            if (!std::binary_search(event_ids_begin, event_ids_end, neighbors_begin[impact_ix]))
+            {
+                throw std::runtime_error("Event catalog impacted events are not all catalog events: " + file_path);
+            }
+        }
+        return;
+    }
+
+    // Map the file into memory, or read it if mapping is not supported
+    void map_file(const std::string& file_path)
+    {
+#ifdef LOTTO_HAS_MMAP
+        int file_descriptor = open(file_path.c_str(), O_RDONLY);
+        if (file_descriptor < 0)
+        {
+            throw std::runtime_error("Could not open event catalog file: " + file_path);
+        }
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) != 0)
+        {
+            close(file_descriptor);
+            throw std::runtime_error("Could not read size of event catalog file: " + file_path);
+        }
+        if (file_status.st_size > 0)
+        {
+            void* mapping = mmap(nullptr, file_status.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+            if (mapping == MAP_FAILED)
+            {
+                close(file_descriptor);
+                throw std::runtime_error("Could not map event catalog file: " + file_path);
+            }
+            mapped_data = mapping;
+            mapped_size = file_status.st_size;
+        }
+        close(file_descriptor);
+#else
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open event catalog file: " + file_path);
+        }
+        file_contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+#endif
+        return;
+    }
+};
+
+/*
+ * Impact provider that reads impacted events from an event catalog, which may be shared with other providers
+ * (see impact_provider.hpp)
+ */
+template <typename EventIDType>
+class CatalogImpactProvider
+{
+public:
+    explicit CatalogImpactProvider(const std::shared_ptr<const EventCatalog<EventIDType>>& catalog_ptr)
+        : catalog_ptr(catalog_ptr)
+    {
+        if (catalog_ptr == nullptr)
+        {
+            throw std::runtime_error("Event catalog must not be null.");
+        }
+    }
+
+    // Returns the events impacted by an event, viewed in place in the catalog, so they are never copied
+    ImpactedEvents<EventIDType> impacted_events(const EventIDType& event_id) const
+    {
+        auto impacted_range = catalog_ptr->impacted_events(event_id);
+        return ImpactedEvents<EventIDType>(impacted_range.first, impacted_range.second);
+    }
+
+private:
+    // Catalog holding impacted events
+    const std::shared_ptr<const EventCatalog<EventIDType>> catalog_ptr;
+};
+} // namespace lotto
+#endif
@@ -0,0 +1,318 @@
+#ifndef CONCURRENT_EVENT_RATE_TREE_H
+#define CONCURRENT_EVENT_RATE_TREE_H
+
+#include "event_rate_tree.hpp"
+#include "snapshot.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class ConcurrentEventRateTreeTest;
+
+namespace lotto
+{
+/*
+ * Class to contain a binary sum tree of event rates, with events as leaves,
+ * that allows rates to be updated from several threads at once
+ *
+ * Nodes are stored implicitly in a flat array (node i has children 2i and 2i + 1, the root is node 1),
+ * with leaves padded by zero rates up to a power of two. Every node holds an atomic rate.
+ * After writing a leaf, each update walks up to the root and replaces every ancestor with the
+ * sum of its children using compare-and-swap, retrying until the stored sum agrees with the children.
+ * Concurrent updates never lose each other's changes, and once they have all returned every node is
+ * exactly the sum of its children (the same sums that EventRateTree would hold for the same rates).
+ *
+ * Querying the tree while updates are in progress is not allowed. Either join the updating threads
+ * before querying, or call synchronize() to wait for any updates that have already started.
+ *
+ * The tree provides the same interface as EventRateTree, so it can be used as the tree of a RejectionFreeEventSelector,
+ * which then applies the rates of impacted events on its worker threads (see set_n_threads), rather than on the
+ * calling thread. It can also be used directly by drivers that update rates from their own threads. Since the sums
+ * agree with those of EventRateTree once updates are complete, selection is still deterministic.
+ */
+template <typename EventIDType>
+class ConcurrentEventRateTree
+{
+public:
+    // Construct tree given list of event IDs and corresponding initial rates
+    ConcurrentEventRateTree(const std::vector<EventIDType>& all_event_ids, const std::vector<double>& all_rates)
+        : ConcurrentEventRateTree(all_event_ids.begin(),
+                                  all_event_ids.end(),
+                                  validated_rates_begin(all_event_ids, all_rates))
+    {
+    }
+
+    // Construct tree given a range of event IDs and the start of a range of their initial rates, which may be any
+    // forward iterators
+    template <typename EventIDIterType, typename RateIterType>
+    ConcurrentEventRateTree(EventIDIterType event_ids_begin, EventIDIterType event_ids_end, RateIterType rates_begin)
+        : ConcurrentEventRateTree(event_ids_begin, event_ids_end, rates_begin, nullptr)
+    {
+    }
+
+    // Construct tree as above, sharing the event index of another tree (see event_index) rather than building one,
+    // unless it is null. The other tree must have been built from the same event IDs in the same order, which is not
+    // checked beyond the number of events.
+    template <typename EventIDIterType, typename RateIterType>
+    ConcurrentEventRateTree(EventIDIterType event_ids_begin,
+                            EventIDIterType event_ids_end,
+                            RateIterType rates_begin,
+                            const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index)
+        : leaf_event_ids(event_ids_begin, event_ids_end),
+          n_padded_leaves(padded_leaf_count(leaf_event_ids.size())),
+          node_rates(new std::atomic<double>[2 * n_padded_leaves]),
+          event_to_leaf_index(shared_or_new_event_index(shared_event_index)),
+          n_updates_in_progress(0)
+    {
+        for (Index node_ix = 0; node_ix < 2 * n_padded_leaves; ++node_ix)
+        {
+            node_rates[node_ix].store(0.0, std::memory_order_relaxed);
+        }
+        for (std::size_t leaf_ix = 0; leaf_ix < leaf_event_ids.size(); ++leaf_ix, ++rates_begin)
+        {
+            node_rates[n_padded_leaves + leaf_ix].store(*rates_begin, std::memory_order_relaxed);
+        }
+        resum_all_nodes();
+    }
+
+    // Traverse tree and return the event ID of event at index i
+    // for which R(i-1) < u <= R(i), where u is the query value
+    // and R(i) is cumulative rate of all events up to and including event i
+    const EventIDType& query_tree(double query_value) const
+    {
+        assert(n_updates_in_progress.load() == 0); // no updates may be in progress
+        assert(query_value > 0);                    // query value must be positive
+        assert(query_value <= total_rate());        // query value cannot exceed total rate
+
+        Index node_ix = 1;
+        while (node_ix < n_padded_leaves)
+        {
+            Index left_child_ix = 2 * node_ix;
+            double left_rate = node_rates[left_child_ix].load(std::memory_order_relaxed);
+            // Never descend into a subtree with no rate (such as padding), even if rounding suggests it
+            if (query_value <= left_rate || node_rates[left_child_ix + 1].load(std::memory_order_relaxed) <= 0.0)
+            {
+                node_ix = left_child_ix;
+            }
+            else
+            {
+                query_value -= left_rate;
+                node_ix = left_child_ix + 1;
+            }
+        }
+        return leaf_event_ids[node_ix - n_padded_leaves];
+    }
+
+    // Update the rate of a specific event, returning true if it changed, may be called from several threads at once
+    // If the rate is unchanged, the tree is left untouched
+    bool update_rate(const EventIDType& event_id, double new_rate)
+    {
+        Index node_ix = n_padded_leaves + event_to_leaf_index->at(event_id);
+        if (node_rates[node_ix].load() == new_rate)
+        {
+            return false;
+        }
+        n_updates_in_progress.fetch_add(1);
+        node_rates[node_ix].store(new_rate);
+        for (node_ix /= 2; node_ix > 0; node_ix /= 2)
+        {
+            resum_node(node_ix);
+        }
+        n_updates_in_progress.fetch_sub(1);
+        return true;
+    }
+
+    // Return the stored rate of a specific event
+    double get_rate(const EventIDType& event_id) const
+    {
+        return node_rates[n_padded_leaves + event_to_leaf_index->at(event_id)].load();
+    }
+
+    // Return the total rate of all events stored in tree
+    double total_rate() const { return node_rates[1].load(); }
+
+    // Return the index from each event ID to its leaf, which is read-only and can be shared with other trees
+    const std::shared_ptr<const std::map<EventIDType, Index>>& event_index() const { return event_to_leaf_index; }
+
+    // Return the number of nodes on the path from a leaf to the root, which is the same for every leaf
+    Index path_length() const
+    {
+        Index n_nodes = 1;
+        for (Index n_level_nodes = n_padded_leaves; n_level_nodes > 1; n_level_nodes /= 2)
+        {
+            ++n_nodes;
+        }
+        return n_nodes;
+    }
+
+    // Write the rates of all events to a binary snapshot, in the same format as EventRateTree
+    void save_state(std::ostream& stream) const
+    {
+        std::vector<double> rates;
+        rates.reserve(leaf_event_ids.size());
+        for (std::size_t leaf_ix = 0; leaf_ix < leaf_event_ids.size(); ++leaf_ix)
+        {
+            rates.push_back(node_rates[n_padded_leaves + leaf_ix].load());
+        }
+        write_snapshot_tag(stream, "RATETREE");
+        write_snapshot_vector(stream, rates);
+        return;
+    }
+
+    // Restore the rates of all events from a snapshot written by save_state, for a tree with the same events
+    void load_state(std::istream& stream)
+    {
+        restore_state(read_state(stream));
+        return;
+    }
+
+    // Read the rates of all events from a snapshot written by save_state, checking that they match the tree's
+    // events, without restoring them
+    std::vector<double> read_state(std::istream& stream) const
+    {
+        check_snapshot_tag(stream, "RATETREE");
+        std::vector<double> loaded_rates = read_snapshot_vector<double>(stream);
+        if (loaded_rates.size() != leaf_event_ids.size())
+        {
+            throw std::runtime_error("Snapshot does not match the number of events.");
+        }
+        return loaded_rates;
+    }
+
+    // Restore rates read by read_state, recalculating every sum (no updates may be in progress)
+    void restore_state(const std::vector<double>& rates)
+    {
+        for (std::size_t leaf_ix = 0; leaf_ix < leaf_event_ids.size(); ++leaf_ix)
+        {
+            node_rates[n_padded_leaves + leaf_ix].store(rates[leaf_ix], std::memory_order_relaxed);
+        }
+        resum_all_nodes();
+        return;
+    }
+
+    // Block until every update that has already started is complete
+    void synchronize() const
+    {
+        while (n_updates_in_progress.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+        return;
+    }
+
+private:
+    // Event ID of each leaf, in leaf order
+    const std::vector<EventIDType> leaf_event_ids;
+
+    // Number of leaves including padding, a power of two
+    const Index n_padded_leaves;
+
+    // Rates of all nodes, with the root at index 1 and leaves starting at index n_padded_leaves
+    const std::unique_ptr<std::atomic<double>[]> node_rates;
+
+    // Given an EventID, get the corresponding index into the tree leaves, possibly shared with other trees
+    const std::shared_ptr<const std::map<EventIDType, Index>> event_to_leaf_index;
+
+    // Number of updates that have started but not yet returned
+    mutable std::atomic<Index> n_updates_in_progress;
+
+    // Return the sum of the current rates of a node's children
+    double summed_children_rate(Index node_ix) const
+    {
+        return node_rates[2 * node_ix].load() + node_rates[2 * node_ix + 1].load();
+    }
+
+    // Replace a node's rate with the sum of its children's, until the two agree
+    void resum_node(Index node_ix)
+    {
+        double stored_rate = node_rates[node_ix].load();
+        while (true)
+        {
+            double summed_rate = summed_children_rate(node_ix);
+            if (node_rates[node_ix].compare_exchange_weak(stored_rate, summed_rate))
+            {
+                // A child may have changed after it was read, in which case its updater may have
+                // lost a race to this store, so check again before moving up the tree
+                if (summed_children_rate(node_ix) == summed_rate)
+                {
+                    return;
+                }
+                stored_rate = summed_rate;
+            }
+        }
+    }
+
+    // Recalculate every sum from the leaves, without any updates in progress
+    void resum_all_nodes()
+    {
+        for (Index node_ix = n_padded_leaves - 1; node_ix > 0; --node_ix)
+        {
+            node_rates[node_ix].store(summed_children_rate(node_ix), std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    // Returns the start of the initial rates, after checking that there is one for every event
+    static typename std::vector<double>::const_iterator validated_rates_begin(
+        const std::vector<EventIDType>& all_event_ids, const std::vector<double>& all_rates)
+    {
+        if (all_event_ids.size() != all_rates.size())
+        {
+            throw std::runtime_error("Number of rates must match number of event IDs.");
+        }
+        return all_rates.begin();
+    }
+
+    // Returns a shared leaf index map, after checking that it has an entry for every leaf, or a new one if it is null
+    std::shared_ptr<const std::map<EventIDType, Index>>
+    shared_or_new_event_index(const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index) const
+    {
+        if (shared_event_index == nullptr)
+        {
+            return std::make_shared<const std::map<EventIDType, Index>>(event_to_leaf_index_map());
+        }
+        if (shared_event_index->size() != leaf_event_ids.size())
+        {
+            throw std::runtime_error("Shared event index does not match the events of the tree.");
+        }
+        return shared_event_index;
+    }
+
+    // Return the smallest power of two no less than the number of events
+    static Index padded_leaf_count(std::size_t n_events)
+    {
+        if (n_events == 0)
+        {
+            throw std::runtime_error("Event ID list must not be empty.");
+        }
+        std::size_t n_padded_leaves = 1;
+        while (n_padded_leaves < n_events)
+        {
+            n_padded_leaves *= 2;
+        }
+        return static_cast<Index>(n_padded_leaves);
+    }
+
+    // Generate the leaf index map for all events in tree
+    std::map<EventIDType, Index> event_to_leaf_index_map() const
+    {
+        std::map<EventIDType, Index> index_map;
+        for (std::size_t leaf_ix = 0; leaf_ix < leaf_event_ids.size(); ++leaf_ix)
+        {
+            index_map[leaf_event_ids[leaf_ix]] = static_cast<Index>(leaf_ix);
+        }
+        return index_map;
+    }
+
+    // Friend for testing
+    friend class ::ConcurrentEventRateTreeTest;
+};
+} // namespace lotto
+#endif
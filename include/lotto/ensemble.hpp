@@ -0,0 +1,246 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "instrumentation.hpp"
+#include "random.hpp"
+#include "rejection_free.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+class EnsembleRunnerTest;
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Runs an ensemble of independent KMC trajectories (replicas) in parallel, each with its own
+ * rejection-free event selector, rate calculator, and random number generator
+ *
+ * The read-only structures are stored once and shared by all replicas: the event ID list, the impacted events
+ * (through an impact provider that shares its storage when copied, such as a MapImpactProvider over one table, or a
+ * CatalogImpactProvider over one compact catalog, see catalog.hpp), and the index from each event ID to its leaf of
+ * the event rate tree. Each replica still builds its own tree of rates, whose leaves hold copies of the event IDs.
+ * Each replica is always advanced by the same worker thread, which also constructs it, so that
+ * when threads are pinned the replica's tree and other state are allocated on the thread's local NUMA node.
+ */
+template <typename EventIDType,
+          typename RateCalculatorType,
+          typename ImpactProviderType = MapImpactProvider<EventIDType>>
+class EnsembleRunner
+{
+public:
+    using SelectorType = RejectionFreeEventSelector<EventIDType, RateCalculatorType, ImpactProviderType>;
+    using ImpactTable = typename SelectorType::ImpactTable;
+
+    // Construct given the number of replicas, a function that makes the rate calculator for a given replica
+    // (called on the thread that will run that replica), the shared event ID list and impact table,
+    // and the number of threads. If pin_threads is true, each thread is pinned to a different CPU.
+    EnsembleRunner(std::size_t n_replicas,
+                   const std::function<std::shared_ptr<RateCalculatorType>(std::size_t)>& make_rate_calculator,
+                   const std::shared_ptr<const std::vector<EventIDType>>& event_id_list_ptr,
+                   const std::shared_ptr<const ImpactTable>& impact_table_ptr,
+                   std::size_t n_threads,
+                   bool pin_threads = true)
+        : EnsembleRunner(n_replicas,
+                         make_rate_calculator,
+                         event_id_list_ptr,
+                         ImpactProviderType(impact_table_ptr),
+                         n_threads,
+                         pin_threads)
+    {
+    }
+
+    // Construct given the number of replicas, a function that makes the rate calculator for a given replica,
+    // the shared event ID list, an impact provider that is copied into every replica, and the number of threads
+    EnsembleRunner(std::size_t n_replicas,
+                   const std::function<std::shared_ptr<RateCalculatorType>(std::size_t)>& make_rate_calculator,
+                   const std::shared_ptr<const std::vector<EventIDType>>& event_id_list_ptr,
+                   const ImpactProviderType& impact_provider,
+                   std::size_t n_threads,
+                   bool pin_threads = true)
+        : event_id_list_ptr(event_id_list_ptr), thread_pool(n_threads, pin_threads), replicas(n_replicas)
+    {
+        if (n_replicas == 0)
+        {
+            throw std::runtime_error("Ensemble must have at least one replica.");
+        }
+        if (event_id_list_ptr == nullptr)
+        {
+            throw std::runtime_error("Event ID list must not be null.");
+        }
+
+        // The first replica builds the event index, which the others then share
+        thread_pool.parallel_for(1, [&](std::size_t replica_ix) {
+            replicas[replica_ix] = std::make_unique<Replica>(make_rate_calculator(replica_ix),
+                                                             *event_id_list_ptr,
+                                                             impact_provider,
+                                                             nullptr);
+        });
+        std::shared_ptr<const std::map<EventIDType, Index>> event_index = replicas[0]->selector.event_index();
+        thread_pool.parallel_for(n_replicas, [&](std::size_t replica_ix) {
+            if (replica_ix != 0)
+            {
+                replicas[replica_ix] = std::make_unique<Replica>(make_rate_calculator(replica_ix),
+                                                                 *event_id_list_ptr,
+                                                                 impact_provider,
+                                                                 event_index);
+            }
+        });
+    }
+
+    // Advance every replica until it has carried out max_steps events in total, or until its time would exceed
+    // max_time, whichever comes first. Every selected event is passed to apply_event(replica_ix, event_id, time_step),
+    // which is called from the worker threads and must carry out the event in that replica's simulation.
+    // Each replica is advanced with its selector's run_until, so an event that would take a replica past max_time is
+    // not carried out, but held, and is the first event carried out by the next call, so that running in several
+    // calls gives the same trajectory as a single call.
+    template <typename ApplyEventFunctionType>
+    void run(UIntType max_steps, double max_time, const ApplyEventFunctionType& apply_event)
+    {
+        thread_pool.parallel_for(replicas.size(), [&](std::size_t replica_ix) {
+            Replica& replica = *replicas[replica_ix];
+            if (replica.n_steps < max_steps)
+            {
+                auto apply_replica_event = [&](const EventIDType& event_id, double time_step) {
+                    apply_event(replica_ix, event_id, time_step);
+                };
+                replica.n_steps += replica.selector.run_until(max_time, apply_replica_event, max_steps - replica.n_steps);
+            }
+        });
+        return;
+    }
+
+    // Returns the number of replicas
+    std::size_t n_replicas() const { return replicas.size(); }
+
+    // Returns the time reached by a replica
+    double get_time(std::size_t replica_ix) const { return replicas.at(replica_ix)->selector.get_elapsed_time(); }
+
+    // Returns the number of events carried out by a replica
+    UIntType get_n_steps(std::size_t replica_ix) const { return replicas.at(replica_ix)->n_steps; }
+
+    // Returns the rate calculator of a replica
+    const std::shared_ptr<RateCalculatorType>& get_rate_calculator(std::size_t replica_ix) const
+    {
+        return replicas.at(replica_ix)->rate_calculator_ptr;
+    }
+
+    // Reseeds every replica's generator, with seeds derived in order from the given seed
+    void reseed_generators(UIntType new_seed)
+    {
+        RandomGenerator seed_generator;
+        seed_generator.reseed_generator(new_seed);
+        for (auto& replica_ptr : replicas)
+        {
+            replica_ptr->selector.reseed_generator(
+                seed_generator.sample_integer_range(std::numeric_limits<UIntType>::max()));
+        }
+        return;
+    }
+
+    // Write the state of every replica to a binary snapshot: its number of events carried out, and its selector state,
+    // which includes its time and held event. Rate calculators, the event ID list and the impacted events are not
+    // included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "ENSEMBLE");
+        write_snapshot_value<std::uint64_t>(stream, replicas.size());
+        for (const auto& replica_ptr : replicas)
+        {
+            write_snapshot_value(stream, replica_ptr->n_steps);
+            replica_ptr->selector.save_state(stream);
+        }
+        return;
+    }
+
+    // Restore the state of every replica from a snapshot written by save_state, for an ensemble constructed with the
+    // same number of replicas and events. Each replica's rate calculator should be restored separately.
+    void load_state(std::istream& stream)
+    {
+        // Selectors restore their own states, so any already loaded are rolled back if a later replica fails to load
+        check_snapshot_tag(stream, "ENSEMBLE");
+        if (read_snapshot_value<std::uint64_t>(stream) != replicas.size())
+        {
+            throw std::runtime_error("Snapshot does not match the number of replicas.");
+        }
+        std::vector<std::stringstream> selector_backups(replicas.size());
+        std::vector<UIntType> loaded_n_steps(replicas.size());
+        std::size_t n_loaded_replicas = 0;
+        try
+        {
+            for (std::size_t replica_ix = 0; replica_ix < replicas.size(); ++replica_ix)
+            {
+                loaded_n_steps[replica_ix] = read_snapshot_value<UIntType>(stream);
+                replicas[replica_ix]->selector.save_state(selector_backups[replica_ix]);
+                replicas[replica_ix]->selector.load_state(stream);
+                ++n_loaded_replicas;
+            }
+        }
+        catch (...)
+        {
+            for (std::size_t replica_ix = 0; replica_ix < n_loaded_replicas; ++replica_ix)
+            {
+                replicas[replica_ix]->selector.load_state(selector_backups[replica_ix]);
+            }
+            throw;
+        }
+
+        for (std::size_t replica_ix = 0; replica_ix < replicas.size(); ++replica_ix)
+        {
+            replicas[replica_ix]->n_steps = loaded_n_steps[replica_ix];
+        }
+        return;
+    }
+
+private:
+    // State belonging to a single trajectory
+    struct Replica
+    {
+        // Construct given the replica's rate calculator, the shared event IDs and impact provider, and the event
+        // index of another replica to share (or null to build one)
+        Replica(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                const std::vector<EventIDType>& event_id_list,
+                const ImpactProviderType& impact_provider,
+                const std::shared_ptr<const std::map<EventIDType, Index>>& event_index)
+            : rate_calculator_ptr(rate_calculator_ptr),
+              selector(rate_calculator_ptr, event_id_list.begin(), event_id_list.end(), impact_provider, event_index),
+              n_steps(0)
+        {
+        }
+
+        // Rate calculator for this replica only
+        std::shared_ptr<RateCalculatorType> rate_calculator_ptr;
+
+        // Event selector for this replica only, whose runner keeps the replica's time and held event
+        SelectorType selector;
+
+        // Number of events carried out
+        UIntType n_steps;
+    };
+
+    // Event IDs shared by all replicas
+    const std::shared_ptr<const std::vector<EventIDType>> event_id_list_ptr;
+
+    // Worker threads, replica i is always run by worker i % n_threads
+    ThreadPool thread_pool;
+
+    // All replicas, each allocated by the worker that runs it
+    std::vector<std::unique_ptr<Replica>> replicas;
+
+    // Friend for testing
+    friend class ::EnsembleRunnerTest;
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+#endif
@@ -2,8 +2,13 @@
 #define EVENT_RATE_TREE_H
 
 #include "sum_tree.hpp"
+#include <cstddef>
+#include <istream>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <optional>
+#include <ostream>
 
 class EventRateNodeDataTest;
 class EventRateTreeTest;
@@ -60,33 +65,122 @@ public:
     // Construct tree given list of event IDs and corresponding initial rates
     EventRateTree(const std::vector<EventIDType>& all_event_ids, const std::vector<double>& all_rates);
 
+    // Construct tree given a range of event IDs and the start of a range of their initial rates
+    // Leaves are built directly from the ranges, which may be any forward iterators (e.g. pointers into
+    // a memory-mapped catalog), so no intermediate copies of the events are made
+    template <typename EventIDIterType, typename RateIterType>
+    EventRateTree(EventIDIterType event_ids_begin, EventIDIterType event_ids_end, RateIterType rates_begin);
+
+    // Construct tree as above, sharing the event index of another tree (see event_index) rather than building one,
+    // unless it is null. The other tree must have been built from the same event IDs in the same order, which is not
+    // checked beyond the number of events, so that trees over the same events (e.g. ensemble replicas) store the index
+    // only once
+    template <typename EventIDIterType, typename RateIterType>
+    EventRateTree(EventIDIterType event_ids_begin,
+                  EventIDIterType event_ids_end,
+                  RateIterType rates_begin,
+                  const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index);
+
     // Traverse tree and return the event ID of event at index i
     // for which R(i-1) < u <= R(i), where u is the query value
     // and R(i) is cumulative rate of all events up to and including event i
     const EventIDType& query_tree(double query_value) const;
 
-    // Update the rate of a specific event
-    void update_rate(const EventIDType& event_id, double new_rate);
+    // Update the rate of a specific event, returning true if it changed
+    // If the rate is unchanged, the tree is left untouched
+    bool update_rate(const EventIDType& event_id, double new_rate);
+
+    // Return the stored rate of a specific event
+    double get_rate(const EventIDType& event_id) const;
 
     // Return the total rate of all events stored in tree
     double total_rate() const;
 
+    // Return the index from each event ID to its leaf, which is read-only and can be shared with other trees
+    const std::shared_ptr<const std::map<EventIDType, Index>>& event_index() const;
+
+    // Return the number of nodes on the path from a leaf to the root, which is the same for every leaf,
+    // i.e. the number of nodes visited by a query or resummed by a rate update
+    Index path_length() const;
+
+    // Write the rates of all events to a binary snapshot
+    void save_state(std::ostream& stream) const;
+
+    // Restore the rates of all events from a snapshot written by save_state, for a tree with the same events
+    // Every sum is recalculated from the restored rates, so the tree is identical to the one saved
+    void load_state(std::istream& stream);
+
+    // Read the rates of all events from a snapshot written by save_state, checking that they match the tree's
+    // events, without restoring them
+    std::vector<double> read_state(std::istream& stream) const;
+
+    // Restore rates read by read_state, recalculating every sum
+    void restore_state(const std::vector<double>& rates);
+
 private:
     using NodeData = EventRateNodeData<EventIDType>;
     using Node = InvertedBinaryTreeNode<NodeData>;
 
+    /*
+     * Iterator over a range of event IDs and a parallel range of rates, yielding leaf node data
+     */
+    template <typename EventIDIterType, typename RateIterType>
+    class LeafDataIterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = NodeData;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const NodeData*;
+        using reference = NodeData;
+
+        LeafDataIterator(EventIDIterType event_id_it, RateIterType rate_it) : event_id_it(event_id_it), rate_it(rate_it)
+        {
+        }
+
+        NodeData operator*() const { return NodeData(*event_id_it, *rate_it); }
+
+        LeafDataIterator& operator++()
+        {
+            ++event_id_it;
+            ++rate_it;
+            return *this;
+        }
+
+        LeafDataIterator operator++(int)
+        {
+            LeafDataIterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        // Iterators are compared by their event IDs only, so the end of the rates need not be known
+        bool operator==(const LeafDataIterator& rhs) const { return event_id_it == rhs.event_id_it; }
+        bool operator!=(const LeafDataIterator& rhs) const { return event_id_it != rhs.event_id_it; }
+
+    private:
+        EventIDIterType event_id_it;
+        RateIterType rate_it;
+    };
+
     // Tree to store events and their rates, and to quickly select events
     InvertedBinarySumTree<NodeData> event_rate_tree;
 
-    // Given an EventID, get the corresponding index into the tree leaves
-    const std::map<EventIDType, Index> event_to_leaf_index;
+    // Given an EventID, get the corresponding index into the tree leaves, possibly shared with other trees
+    const std::shared_ptr<const std::map<EventIDType, Index>> event_to_leaf_index;
+
+    // Number of nodes on the path from a leaf to the root
+    const Index n_path_nodes;
 
     // Generate the leaf index map for all events in tree
     std::map<EventIDType, Index> event_to_leaf_index_map() const;
 
-    // Convert all events and their rates into leaf node data for initialization
-    std::vector<NodeData> events_as_leaves(const std::vector<EventIDType>& init_events,
-                                           const std::vector<double>& init_rates) const;
+    // Returns a shared leaf index map, after checking that it has an entry for every leaf, or a new one if it is null
+    std::shared_ptr<const std::map<EventIDType, Index>>
+    shared_or_new_event_index(const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index) const;
+
+    // Count the nodes on the path from the first leaf to the root
+    Index count_path_nodes() const;
 
     // Based on the rate of the children nodes, pick the left or right
     // child, and subtract the rate out
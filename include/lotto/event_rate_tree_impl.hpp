@@ -3,8 +3,10 @@
 
 #include "event_rate_tree.hpp"
 #include "sum_tree.hpp"
+#include "snapshot.hpp"
 #include "sum_tree_impl.hpp"
 #include <cassert>
+#include <stdexcept>
 
 namespace lotto
 {
@@ -58,8 +60,33 @@ using Node = InvertedBinaryTreeNode<NodeData<EventIDType>>;
 template <typename EventIDType>
 EventRateTree<EventIDType>::EventRateTree(const std::vector<EventIDType>& all_event_ids,
                                           const std::vector<double>& all_rates)
-    : event_rate_tree(this->events_as_leaves(all_event_ids, all_rates)),
-      event_to_leaf_index(this->event_to_leaf_index_map())
+    : EventRateTree(all_event_ids.begin(), all_event_ids.end(), all_rates.begin())
+{
+}
+
+template <typename EventIDType>
+template <typename EventIDIterType, typename RateIterType>
+EventRateTree<EventIDType>::EventRateTree(EventIDIterType event_ids_begin,
+                                          EventIDIterType event_ids_end,
+                                          RateIterType rates_begin)
+    : event_rate_tree(LeafDataIterator<EventIDIterType, RateIterType>(event_ids_begin, rates_begin),
+                      LeafDataIterator<EventIDIterType, RateIterType>(event_ids_end, rates_begin)),
+      event_to_leaf_index(std::make_shared<const std::map<EventIDType, Index>>(this->event_to_leaf_index_map())),
+      n_path_nodes(this->count_path_nodes())
+{
+}
+
+template <typename EventIDType>
+template <typename EventIDIterType, typename RateIterType>
+EventRateTree<EventIDType>::EventRateTree(
+    EventIDIterType event_ids_begin,
+    EventIDIterType event_ids_end,
+    RateIterType rates_begin,
+    const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index)
+    : event_rate_tree(LeafDataIterator<EventIDIterType, RateIterType>(event_ids_begin, rates_begin),
+                      LeafDataIterator<EventIDIterType, RateIterType>(event_ids_end, rates_begin)),
+      event_to_leaf_index(this->shared_or_new_event_index(shared_event_index)),
+      n_path_nodes(this->count_path_nodes())
 {
 }
 
@@ -80,12 +107,29 @@ const EventIDType& EventRateTree<EventIDType>::query_tree(double query_value) co
 }
 
 template <typename EventIDType>
-void EventRateTree<EventIDType>::update_rate(const EventIDType& event_id, double new_rate)
+bool EventRateTree<EventIDType>::update_rate(const EventIDType& event_id, double new_rate)
 {
-    auto leaf_ix = event_to_leaf_index.at(event_id);
+    auto leaf_ix = event_to_leaf_index->at(event_id);
     NodeData& event_data = event_rate_tree.leaves()[leaf_ix]->data;
+    if (event_data.get_rate() == new_rate)
+    {
+        return false;
+    }
     event_data.update_rate(new_rate);
     event_rate_tree.update(leaf_ix, event_data);
+    return true;
+}
+
+template <typename EventIDType>
+double EventRateTree<EventIDType>::get_rate(const EventIDType& event_id) const
+{
+    return event_rate_tree.leaves()[event_to_leaf_index->at(event_id)]->data.get_rate();
+}
+
+template <typename EventIDType>
+const std::shared_ptr<const std::map<EventIDType, Index>>& EventRateTree<EventIDType>::event_index() const
+{
+    return event_to_leaf_index;
 }
 
 template <typename EventIDType>
@@ -94,6 +138,57 @@ double EventRateTree<EventIDType>::total_rate() const
     return event_rate_tree.root()->data.get_rate();
 }
 
+template <typename EventIDType>
+Index EventRateTree<EventIDType>::path_length() const
+{
+    return n_path_nodes;
+}
+
+template <typename EventIDType>
+void EventRateTree<EventIDType>::save_state(std::ostream& stream) const
+{
+    std::vector<double> rates;
+    rates.reserve(event_rate_tree.leaves().size());
+    for (const auto& leaf_ptr : event_rate_tree.leaves())
+    {
+        rates.push_back(leaf_ptr->data.get_rate());
+    }
+    write_snapshot_tag(stream, "RATETREE");
+    write_snapshot_vector(stream, rates);
+    return;
+}
+
+template <typename EventIDType>
+void EventRateTree<EventIDType>::load_state(std::istream& stream)
+{
+    restore_state(read_state(stream));
+    return;
+}
+
+template <typename EventIDType>
+std::vector<double> EventRateTree<EventIDType>::read_state(std::istream& stream) const
+{
+    check_snapshot_tag(stream, "RATETREE");
+    std::vector<double> loaded_rates = read_snapshot_vector<double>(stream);
+    if (loaded_rates.size() != event_rate_tree.leaves().size())
+    {
+        throw std::runtime_error("Snapshot does not match the number of events.");
+    }
+    return loaded_rates;
+}
+
+template <typename EventIDType>
+void EventRateTree<EventIDType>::restore_state(const std::vector<double>& rates)
+{
+    const auto& tree_leaves = event_rate_tree.leaves();
+    for (std::size_t leaf_ix = 0; leaf_ix < tree_leaves.size(); ++leaf_ix)
+    {
+        tree_leaves[leaf_ix]->data.update_rate(rates[leaf_ix]);
+    }
+    event_rate_tree.resum();
+    return;
+}
+
 template <typename EventIDType>
 std::map<EventIDType, Index> EventRateTree<EventIDType>::event_to_leaf_index_map() const
 {
@@ -108,18 +203,31 @@ std::map<EventIDType, Index> EventRateTree<EventIDType>::event_to_leaf_index_map
 }
 
 template <typename EventIDType>
-std::vector<EventRateNodeData<EventIDType>>
-EventRateTree<EventIDType>::events_as_leaves(const std::vector<EventIDType>& init_events,
-                                             const std::vector<double>& init_rates) const
+std::shared_ptr<const std::map<EventIDType, Index>> EventRateTree<EventIDType>::shared_or_new_event_index(
+    const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index) const
+{
+    if (shared_event_index == nullptr)
+    {
+        return std::make_shared<const std::map<EventIDType, Index>>(this->event_to_leaf_index_map());
+    }
+    if (shared_event_index->size() != this->event_rate_tree.leaves().size())
+    {
+        throw std::runtime_error("Shared event index does not match the events of the tree.");
+    }
+    return shared_event_index;
+}
+
+template <typename EventIDType>
+Index EventRateTree<EventIDType>::count_path_nodes() const
 {
-    std::vector<EventRateNodeData<EventIDType>> event_leaves;
-    auto rate_it = init_rates.begin();
-    for (auto event_it = init_events.begin(); event_it != init_events.end(); ++event_it)
+    // Every level is paired up in full (padded with null nodes), so all leaves are at the same depth
+    Index n_nodes = 1;
+    for (const Node* node_ptr = event_rate_tree.leaves()[0].get(); node_ptr != event_rate_tree.root();
+         node_ptr = node_ptr->parent.get())
     {
-        event_leaves.emplace_back(*event_it, *rate_it);
-        ++rate_it;
+        ++n_nodes;
     }
-    return event_leaves;
+    return n_nodes;
 }
 
 template <typename EventIDType>
@@ -130,7 +238,10 @@ const Node<EventIDType>* EventRateTree<EventIDType>::bifurcate(const Node* curre
         return nullptr;
     }
 
-    if (current_node_ptr->left_child != nullptr && running_rate <= current_node_ptr->left_child->data.get_rate())
+    // Never descend into a subtree with no rate (such as padding), even if rounding suggests it
+    if (current_node_ptr->left_child != nullptr &&
+        (running_rate <= current_node_ptr->left_child->data.get_rate() || current_node_ptr->right_child == nullptr ||
+         current_node_ptr->right_child->data.get_rate() <= 0.0))
     {
         return current_node_ptr->left_child;
     }
@@ -2,15 +2,187 @@
 #define EVENT_SELECTOR_H
 
 #include "random.hpp"
+#include "snapshot.hpp"
 #include <cassert>
 #include <cmath>
+#include <istream>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <ostream>
+#include <type_traits>
 #include <utility>
 
 namespace lotto
 {
+/*
+ * Detects whether a rate calculator type provides the optional method
+ *     bool has_rate_changed(const EventIDType& event_id)
+ * which reports whether an event's rate may differ from the value last calculated,
+ * allowing selectors to skip calls to calculate_rate
+ */
+template <typename RateCalculatorType, typename EventIDType, typename = void>
+struct has_rate_change_hook : std::false_type
+{
+};
+
+template <typename RateCalculatorType, typename EventIDType>
+struct has_rate_change_hook<RateCalculatorType,
+                            EventIDType,
+                            std::void_t<decltype(std::declval<RateCalculatorType&>().has_rate_changed(
+                                std::declval<const EventIDType&>()))>> : std::true_type
+{
+};
+
+// Returns the rate of an event given by a rate calculator, which must be non-negative
+template <typename RateCalculatorType, typename EventIDType>
+double calculate_checked_rate(RateCalculatorType& rate_calculator, const EventIDType& event_id)
+{
+    double rate = rate_calculator.calculate_rate(event_id);
+    assert(rate >= 0.0); // rates must be non-negative
+    return rate;
+}
+
+/*
+ * Detects whether a type can be used as an event selector, i.e. whether it provides a method
+ *     std::pair<EventIDType, double> select_event()
+ * for some event ID type. Drivers written as templates over the selector type can check this,
+ * and call select_event without virtual dispatch, so that it may be inlined
+ */
+template <typename SelectorType, typename = void>
+struct is_event_selector : std::false_type
+{
+};
+
+template <typename SelectorType>
+struct is_event_selector<SelectorType, std::void_t<decltype(std::declval<SelectorType&>().select_event().second)>>
+    : std::is_same<decltype(std::declval<SelectorType&>().select_event().second), double>
+{
+};
+
+/*
+ * Mixin providing loops that select and carry out many events, for the event selector type deriving from it
+ *
+ * The selector type is known statically, so its select_event and the function carrying out each event
+ * can be inlined into the loop, and the elapsed time is accumulated here rather than by the caller.
+ * Selections should not be made directly with select_event while an event is held by run_until.
+ */
+template <typename SelectorType, typename EventIDType>
+class EventSelectorRunner
+{
+public:
+    // Select and carry out a given number of events, passing each to apply_event(event_id, time_step)
+    template <typename ApplyEventFunctionType>
+    void run_steps(UIntType n_steps, ApplyEventFunctionType&& apply_event)
+    {
+        for (UIntType step = 0; step < n_steps; ++step)
+        {
+            if (!held_event.has_value())
+            {
+                held_event = static_cast<SelectorType&>(*this).select_event();
+            }
+            carry_out_held_event(apply_event);
+        }
+        return;
+    }
+
+    // Select and carry out events, passing each to apply_event(event_id, time_step), until the next event would take
+    // the elapsed time past max_time. That event is held, rather than carried out, and is the first one carried out
+    // by the next call to either method. Stops early, without selecting another event, once max_steps events have
+    // been carried out. Returns the number of events carried out.
+    template <typename ApplyEventFunctionType>
+    UIntType run_until(double max_time,
+                       ApplyEventFunctionType&& apply_event,
+                       UIntType max_steps = std::numeric_limits<UIntType>::max())
+    {
+        UIntType n_steps = 0;
+        while (n_steps < max_steps)
+        {
+            if (!held_event.has_value())
+            {
+                held_event = static_cast<SelectorType&>(*this).select_event();
+            }
+            if (elapsed_time + held_event->second > max_time)
+            {
+                return n_steps;
+            }
+            carry_out_held_event(apply_event);
+            ++n_steps;
+        }
+        return n_steps;
+    }
+
+    // Returns the total time step of all events carried out by these methods
+    double get_elapsed_time() const { return elapsed_time; }
+
+protected:
+    EventSelectorRunner() : elapsed_time(0.0) {}
+
+    // Write the elapsed time and any held event to a binary snapshot, as part of the selector's state
+    void save_runner_state(std::ostream& stream) const
+    {
+        write_snapshot_value(stream, elapsed_time);
+        write_snapshot_value(stream, held_event.has_value());
+        if (held_event.has_value())
+        {
+            write_snapshot_value(stream, held_event->first);
+            write_snapshot_value(stream, held_event->second);
+        }
+        return;
+    }
+
+    // Elapsed time and held event of a runner, read from a snapshot but not yet restored
+    struct RunnerState
+    {
+        double elapsed_time;
+        std::optional<std::pair<EventIDType, double>> held_event;
+    };
+
+    // Read the elapsed time and any held event from a snapshot written by save_runner_state, without restoring them,
+    // so that selectors can read their whole snapshot before changing any state
+    static RunnerState read_runner_state(std::istream& stream)
+    {
+        RunnerState state;
+        state.elapsed_time = read_snapshot_value<double>(stream);
+        if (read_snapshot_value<bool>(stream))
+        {
+            EventIDType held_event_id = read_snapshot_value<EventIDType>(stream);
+            state.held_event = std::make_pair(held_event_id, read_snapshot_value<double>(stream));
+        }
+        return state;
+    }
+
+    // Restore the elapsed time and any held event read by read_runner_state
+    void restore_runner_state(const RunnerState& state)
+    {
+        elapsed_time = state.elapsed_time;
+        held_event = state.held_event;
+        return;
+    }
+
+private:
+    // Total time step of all events carried out
+    double elapsed_time;
+
+    // Event that has been selected but not carried out
+    std::optional<std::pair<EventIDType, double>> held_event;
+
+    // Carry out the held event and advance the elapsed time
+    template <typename ApplyEventFunctionType>
+    void carry_out_held_event(ApplyEventFunctionType& apply_event)
+    {
+        apply_event(held_event->first, held_event->second);
+        elapsed_time += held_event->second;
+        held_event.reset();
+        return;
+    }
+};
+
 /*
  * Base class template for event selector
+ *
+ * Derived selectors mark select_event as final, so calls made through the derived type
+ * (rather than through a pointer or reference to this base) are bound statically
  */
 template <typename EventIDType, typename RateCalculatorType>
 class EventSelectorBase
@@ -21,6 +193,9 @@ public:
     // Selects a single event, returns the event ID and the time step
     virtual std::pair<EventIDType, double> select_event() = 0;
 
+    // Reseeds the generator
+    void reseed_generator(UIntType new_seed) { random_generator.reseed_generator(new_seed); }
+
 protected:
     // Pointer to rate calculator
     const std::shared_ptr<RateCalculatorType> rate_calculator_ptr;
@@ -38,9 +213,20 @@ protected:
     // Returns the rate given an event ID
     double calculate_rate(const EventIDType& event_id) const
     {
-        double rate = rate_calculator_ptr->calculate_rate(event_id);
-        assert(rate >= 0.0); // rates must be non-negative
-        return rate;
+        return calculate_checked_rate(*rate_calculator_ptr, event_id);
+    }
+
+    // Returns false only if the rate calculator reports that an event's rate has not changed
+    bool is_rate_update_needed(const EventIDType& event_id) const
+    {
+        if constexpr (has_rate_change_hook<RateCalculatorType, EventIDType>::value)
+        {
+            return rate_calculator_ptr->has_rate_changed(event_id);
+        }
+        else
+        {
+            return true;
+        }
     }
 
     // Returns a list of rates given a list of event IDs
@@ -62,9 +248,6 @@ protected:
         double time_step = -std::log(random_generator.sample_unit_interval()) / total_rate;
         return time_step;
     }
-
-    // Reseeds the generator
-    void reseed_generator(UIntType new_seed) { random_generator.reseed_generator(new_seed); }
 };
 } // namespace lotto
 #endif
@@ -0,0 +1,372 @@
+#ifndef FLICKER_H
+#define FLICKER_H
+
+#include "event_selector.hpp"
+#include "instrumentation.hpp"
+#include "rejection_free.hpp"
+#include <algorithm>
+#include <deque>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+class FlickerAcceleratedEventSelectorTest;
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Rate calculator adapter that multiplies the rates of an inner rate calculator by a per-event scale factor
+ *
+ * Events without a scale factor keep their unscaled rates.
+ */
+template <typename EventIDType, typename InnerRateCalculatorType>
+class ScaledRateCalculator
+{
+public:
+    ScaledRateCalculator(const std::shared_ptr<InnerRateCalculatorType>& inner_calculator_ptr)
+        : inner_calculator_ptr(inner_calculator_ptr)
+    {
+    }
+
+    // Returns the inner rate for an event times its scale factor
+    double calculate_rate(const EventIDType& event_id)
+    {
+        return get_scale_factor(event_id) * inner_calculator_ptr->calculate_rate(event_id);
+    }
+
+    // Forwards to the inner calculator, if it reports rate changes, otherwise always returns true
+    // Changes of scale factor are not reported, rates must be recalculated explicitly after them
+    bool has_rate_changed(const EventIDType& event_id)
+    {
+        if constexpr (has_rate_change_hook<InnerRateCalculatorType, EventIDType>::value)
+        {
+            return inner_calculator_ptr->has_rate_changed(event_id);
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    // Returns the scale factor for an event, which is one unless set otherwise
+    double get_scale_factor(const EventIDType& event_id) const
+    {
+        auto scale_factor_it = scale_factors.find(event_id);
+        return scale_factor_it == scale_factors.end() ? 1.0 : scale_factor_it->second;
+    }
+
+    // Set the scale factor for an event
+    void set_scale_factor(const EventIDType& event_id, double scale_factor)
+    {
+        if (scale_factor == 1.0)
+        {
+            scale_factors.erase(event_id);
+        }
+        else
+        {
+            scale_factors[event_id] = scale_factor;
+        }
+        return;
+    }
+
+    // Returns the IDs of all events whose scale factor is not one
+    std::vector<EventIDType> scaled_events() const
+    {
+        std::vector<EventIDType> event_ids;
+        event_ids.reserve(scale_factors.size());
+        for (const auto& event_and_scale_factor : scale_factors)
+        {
+            event_ids.push_back(event_and_scale_factor.first);
+        }
+        return event_ids;
+    }
+
+    // Returns the number of events whose scale factor is not one
+    std::size_t n_scaled_events() const { return scale_factors.size(); }
+
+    // Reset all scale factors to one
+    void clear_scale_factors()
+    {
+        scale_factors.clear();
+        return;
+    }
+
+    // Returns the inner rate calculator
+    const std::shared_ptr<InnerRateCalculatorType>& inner_calculator() const { return inner_calculator_ptr; }
+
+private:
+    // Calculator providing unscaled rates
+    std::shared_ptr<InnerRateCalculatorType> inner_calculator_ptr;
+
+    // Scale factors for events whose rates are scaled
+    std::map<EventIDType, double> scale_factors;
+};
+
+/*
+ * Settings controlling when a flicker accelerated event selector treats the system as trapped
+ */
+struct FlickerParameters
+{
+    // Number of most recent selections examined
+    std::size_t window_size = 100;
+
+    // System is trapped if at most this many distinct events occurred in a full window
+    std::size_t max_distinct_events = 4;
+
+    // Factor by which the rates of trapped events are multiplied each time trapping is detected
+    double scale_factor = 0.5;
+
+    // Smallest total scale factor applied to any event, which bounds the error introduced
+    double min_scale_factor = 1e-6;
+};
+
+/*
+ * Event selector that accelerates escape from groups of states connected by fast, repeatedly selected events
+ * (superbasins), by adaptively lowering the rates of those events
+ *
+ * Selection is carried out by a rejection-free event selector. If only a few distinct events are selected over
+ * a full window of recent selections, the system is considered trapped and their rates are lowered by a constant
+ * factor, repeatedly if trapping persists. This lets slower events that leave the superbasin compete, and the time
+ * steps grow accordingly. As soon as an event whose rate has not been lowered is selected, all rates are restored
+ * and an escape is counted. This includes events inside the superbasin that did not occur in the window when
+ * trapping was last detected, so not every counted escape leaves the superbasin.
+ *
+ * This is an approximate method (accelerated superbasin KMC): dynamics within the superbasin are distorted, but
+ * escape times and pathways are preserved as long as the lowered rates remain fast compared to the rates of
+ * escape. The minimum scale factor should be chosen with that in mind.
+ */
+template <typename EventIDType, typename RateCalculatorType>
+class FlickerAcceleratedEventSelector
+    : public EventSelectorRunner<FlickerAcceleratedEventSelector<EventIDType, RateCalculatorType>, EventIDType>
+{
+public:
+    using ScaledRateCalculatorType = ScaledRateCalculator<EventIDType, RateCalculatorType>;
+    using ImpactTable = typename RejectionFreeEventSelector<EventIDType, ScaledRateCalculatorType>::ImpactTable;
+
+    // Construct given a rate calculator, event ID list, impact table, and trapping detection settings
+    FlickerAcceleratedEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                                    const std::vector<EventIDType>& event_id_list,
+                                    const ImpactTable& impact_table,
+                                    const FlickerParameters& parameters = FlickerParameters())
+        : scaled_calculator_ptr(std::make_shared<ScaledRateCalculatorType>(rate_calculator_ptr)),
+          selector(scaled_calculator_ptr, event_id_list, impact_table),
+          parameters(parameters),
+          n_detections(0),
+          n_escapes(0)
+    {
+        if (parameters.window_size == 0)
+        {
+            throw std::runtime_error("Flicker detection window must not be empty.");
+        }
+        if (!(parameters.scale_factor > 0.0 && parameters.scale_factor <= 1.0) ||
+            !(parameters.min_scale_factor > 0.0 && parameters.min_scale_factor <= 1.0))
+        {
+            throw std::runtime_error("Scale factors must be positive and at most one.");
+        }
+    }
+
+    // Select an event and return its ID and the time step
+    std::pair<EventIDType, double> select_event()
+    {
+        // Rates changed by the last selection are only recalculated now, after that event has been carried out
+        if (!rescaled_events.empty())
+        {
+            selector.recalculate_rates(rescaled_events);
+            rescaled_events.clear();
+        }
+        auto event_and_time = selector.select_event();
+        record_selection(event_and_time.first);
+        return event_and_time;
+    }
+
+    // Returns the factor currently applied to the rate of an event
+    double get_scale_factor(const EventIDType& event_id) const
+    {
+        return scaled_calculator_ptr->get_scale_factor(event_id);
+    }
+
+    // Returns the number of events whose rates are currently lowered
+    std::size_t n_scaled_events() const { return scaled_calculator_ptr->n_scaled_events(); }
+
+    // Returns the number of times trapping has been detected
+    UIntType get_n_detections() const { return n_detections; }
+
+    // Returns the number of times rates were restored because an event whose rate was not lowered was selected
+    UIntType get_n_escapes() const { return n_escapes; }
+
+    // Returns the instrumentation statistics of the underlying selector, which are only recorded if
+    // LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp). Rates recalculated after scale factors change
+    // are included in its tree updates and rate calculations.
+    const SelectorInstrumentation& get_instrumentation() const { return selector.get_instrumentation(); }
+
+    // Resets the instrumentation statistics of the underlying selector
+    void reset_instrumentation()
+    {
+        selector.reset_instrumentation();
+        return;
+    }
+
+    // Reseed the random number generator of the underlying selector
+    void reseed_generator(UIntType new_seed)
+    {
+        selector.reseed_generator(new_seed);
+        return;
+    }
+
+    // Write the selector's state to a binary snapshot: the runner state, the current scale factors, the recent
+    // selections and counters used to detect trapping, and the state of the underlying selector. The rate calculator,
+    // impact table and trapping detection settings are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "FLICKER_");
+        this->save_runner_state(stream);
+        std::vector<EventIDType> scaled_event_ids = scaled_calculator_ptr->scaled_events();
+        std::vector<double> scale_factors;
+        scale_factors.reserve(scaled_event_ids.size());
+        for (const EventIDType& event_id : scaled_event_ids)
+        {
+            scale_factors.push_back(scaled_calculator_ptr->get_scale_factor(event_id));
+        }
+        write_snapshot_vector(stream, scaled_event_ids);
+        write_snapshot_vector(stream, scale_factors);
+        write_snapshot_vector(stream, std::vector<EventIDType>(recent_events.begin(), recent_events.end()));
+        write_snapshot_vector(stream, rescaled_events);
+        write_snapshot_value(stream, n_detections);
+        write_snapshot_value(stream, n_escapes);
+        selector.save_state(stream);
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // events and settings
+    void load_state(std::istream& stream)
+    {
+        // Everything is read before any state is restored, the underlying selector restoring its own state last
+        check_snapshot_tag(stream, "FLICKER_");
+        auto loaded_runner_state = this->read_runner_state(stream);
+        std::vector<EventIDType> loaded_scaled_event_ids = read_snapshot_vector<EventIDType>(stream);
+        std::vector<double> loaded_scale_factors = read_snapshot_vector<double>(stream);
+        std::vector<EventIDType> loaded_recent_events = read_snapshot_vector<EventIDType>(stream);
+        std::vector<EventIDType> loaded_rescaled_events = read_snapshot_vector<EventIDType>(stream);
+        UIntType loaded_n_detections = read_snapshot_value<UIntType>(stream);
+        UIntType loaded_n_escapes = read_snapshot_value<UIntType>(stream);
+        if (loaded_scale_factors.size() != loaded_scaled_event_ids.size() ||
+            loaded_recent_events.size() > parameters.window_size)
+        {
+            throw std::runtime_error("Snapshot does not match the trapping detection settings.");
+        }
+        selector.load_state(stream);
+
+        this->restore_runner_state(loaded_runner_state);
+        scaled_calculator_ptr->clear_scale_factors();
+        for (std::size_t scaled_ix = 0; scaled_ix < loaded_scaled_event_ids.size(); ++scaled_ix)
+        {
+            scaled_calculator_ptr->set_scale_factor(loaded_scaled_event_ids[scaled_ix],
+                                                    loaded_scale_factors[scaled_ix]);
+        }
+        clear_recent_events();
+        for (const EventIDType& event_id : loaded_recent_events)
+        {
+            recent_events.push_back(event_id);
+            ++recent_event_counts[event_id];
+        }
+        rescaled_events = std::move(loaded_rescaled_events);
+        n_detections = loaded_n_detections;
+        n_escapes = loaded_n_escapes;
+        return;
+    }
+
+private:
+    // Calculator applying the current scale factors
+    std::shared_ptr<ScaledRateCalculatorType> scaled_calculator_ptr;
+
+    // Underlying selector, using scaled rates
+    RejectionFreeEventSelector<EventIDType, ScaledRateCalculatorType> selector;
+
+    // Trapping detection settings
+    const FlickerParameters parameters;
+
+    // Most recently selected events, oldest first
+    std::deque<EventIDType> recent_events;
+
+    // Number of times each event appears in the recent events
+    std::map<EventIDType, std::size_t> recent_event_counts;
+
+    // Events whose scale factors have changed but whose rates have not been recalculated
+    std::vector<EventIDType> rescaled_events;
+
+    // Counters for detections and escapes
+    UIntType n_detections;
+    UIntType n_escapes;
+
+    // Restore all rates if the selected event leaves the superbasin, otherwise lower rates if trapping is detected
+    void record_selection(const EventIDType& selected_event_id)
+    {
+        if (scaled_calculator_ptr->n_scaled_events() != 0 &&
+            scaled_calculator_ptr->get_scale_factor(selected_event_id) == 1.0)
+        {
+            rescaled_events = scaled_calculator_ptr->scaled_events();
+            scaled_calculator_ptr->clear_scale_factors();
+            clear_recent_events();
+            ++n_escapes;
+        }
+
+        recent_events.push_back(selected_event_id);
+        ++recent_event_counts[selected_event_id];
+        if (recent_events.size() > parameters.window_size)
+        {
+            auto count_it = recent_event_counts.find(recent_events.front());
+            if (--count_it->second == 0)
+            {
+                recent_event_counts.erase(count_it);
+            }
+            recent_events.pop_front();
+        }
+
+        if (recent_events.size() == parameters.window_size &&
+            recent_event_counts.size() <= parameters.max_distinct_events)
+        {
+            lower_recent_event_rates();
+        }
+        return;
+    }
+
+    // Multiply the scale factor of every recently selected event by the constant factor, down to the minimum
+    void lower_recent_event_rates()
+    {
+        for (const auto& event_and_count : recent_event_counts)
+        {
+            const EventIDType& event_id = event_and_count.first;
+            double old_scale_factor = scaled_calculator_ptr->get_scale_factor(event_id);
+            double new_scale_factor =
+                std::max(parameters.min_scale_factor, old_scale_factor * parameters.scale_factor);
+            if (new_scale_factor != old_scale_factor)
+            {
+                scaled_calculator_ptr->set_scale_factor(event_id, new_scale_factor);
+                rescaled_events.push_back(event_id);
+            }
+        }
+        clear_recent_events();
+        ++n_detections;
+        return;
+    }
+
+    // Forget all recent selections, so that a full window is needed before trapping is detected again
+    void clear_recent_events()
+    {
+        recent_events.clear();
+        recent_event_counts.clear();
+        return;
+    }
+
+    // Friend for testing
+    friend class ::FlickerAcceleratedEventSelectorTest;
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+#endif
@@ -0,0 +1,280 @@
+#ifndef HYBRID_H
+#define HYBRID_H
+
+#include "event_selector.hpp"
+#include "instrumentation.hpp"
+#include "random.hpp"
+#include "rejection.hpp"
+#include "rejection_free.hpp"
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+class HybridEventSelectorTest;
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Settings controlling when a hybrid event selector switches algorithm
+ */
+struct HybridParameters
+{
+    // Number of selections between evaluations of which algorithm is cheaper
+    UIntType evaluation_interval = 1000;
+
+    // Switch only if the other algorithm is estimated to be cheaper by at least this factor
+    double switching_factor = 1.5;
+
+    // Cost of updating one level of the rate tree, relative to calculating one rate
+    double tree_update_cost = 0.1;
+};
+
+/*
+ * Event selector that switches between the rejection and rejection-free algorithms as rates change
+ *
+ * Costs are estimated in units of rate calculations. Rejection KMC needs on average one calculation per attempt,
+ * i.e. the inverse of the acceptance ratio, while rejection-free KMC needs one calculation and one tree update per
+ * impacted event. The acceptance ratio is measured directly in rejection mode and taken from the tree's total
+ * rate in rejection-free mode, and the number of impacted events is averaged over recent selections in both.
+ *
+ * Both selectors are kept for the whole run, so switching never rebuilds the tree. While in rejection mode, the
+ * events impacted by accepted events are recorded, and only their rates are recalculated on switching back.
+ */
+template <typename EventIDType, typename RateCalculatorType>
+class HybridEventSelector
+    : public EventSelectorRunner<HybridEventSelector<EventIDType, RateCalculatorType>, EventIDType>
+{
+public:
+    using ImpactTable = typename RejectionFreeEventSelector<EventIDType, RateCalculatorType>::ImpactTable;
+
+    // Construct given a rate calculator, an upper bound on rates, event ID list, impact table, and switching settings
+    // Selection starts with the rejection-free algorithm
+    HybridEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                        double rate_upper_bound,
+                        const std::vector<EventIDType>& event_id_list,
+                        const ImpactTable& impact_table,
+                        const HybridParameters& parameters = HybridParameters())
+        : impact_table_ptr(std::make_shared<const ImpactTable>(impact_table)),
+          rejection_selector(rate_calculator_ptr, rate_upper_bound, event_id_list),
+          rejection_free_selector(rate_calculator_ptr, event_id_list, impact_table_ptr),
+          rate_upper_bound(rate_upper_bound),
+          parameters(parameters),
+          is_rejection_mode(false),
+          n_selections_since_evaluation(0),
+          n_impacted_since_evaluation(0),
+          n_switches(0)
+    {
+        if (parameters.evaluation_interval == 0)
+        {
+            throw std::runtime_error("Evaluation interval must be positive.");
+        }
+    }
+
+    // Select an event and return its ID and the time step
+    std::pair<EventIDType, double> select_event()
+    {
+        if (n_selections_since_evaluation == parameters.evaluation_interval)
+        {
+            evaluate_mode();
+        }
+        auto event_and_time =
+            is_rejection_mode ? rejection_selector.select_event() : rejection_free_selector.select_event();
+        record_impacts(event_and_time.first);
+        ++n_selections_since_evaluation;
+        return event_and_time;
+    }
+
+    // Returns true if the rejection algorithm is currently in use, false if the rejection-free algorithm is
+    bool is_using_rejection() const { return is_rejection_mode; }
+
+    // Returns the number of times the algorithm has been switched
+    UIntType get_n_switches() const { return n_switches; }
+
+    // Returns the instrumentation statistics of both underlying selectors combined, which are only recorded if
+    // LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp). Rates recalculated on switching back to the
+    // rejection-free algorithm are included in its tree updates and rate calculations.
+    SelectorInstrumentation get_instrumentation() const
+    {
+        SelectorInstrumentation instrumentation = rejection_selector.get_instrumentation();
+        instrumentation.add(rejection_free_selector.get_instrumentation());
+        return instrumentation;
+    }
+
+    // Resets the instrumentation statistics of both underlying selectors
+    void reset_instrumentation()
+    {
+        rejection_selector.reset_instrumentation();
+        rejection_free_selector.reset_instrumentation();
+        return;
+    }
+
+    // Reseeds the generators of both selectors, with seeds derived from the given seed
+    void reseed_generator(UIntType new_seed)
+    {
+        RandomGenerator seed_generator;
+        seed_generator.reseed_generator(new_seed);
+        rejection_selector.reseed_generator(seed_generator.sample_integer_range(std::numeric_limits<UIntType>::max()));
+        rejection_free_selector.reseed_generator(
+            seed_generator.sample_integer_range(std::numeric_limits<UIntType>::max()));
+        return;
+    }
+
+    // Write the selector's state to a binary snapshot: the runner state, the algorithm in use, the counters used to
+    // choose it, the events whose stored rates are stale, and the states of both underlying selectors. The rate
+    // calculator, impact table and switching settings are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "HYBRID__");
+        this->save_runner_state(stream);
+        write_snapshot_value(stream, is_rejection_mode);
+        write_snapshot_value(stream, n_selections_since_evaluation);
+        write_snapshot_value(stream, n_impacted_since_evaluation);
+        write_snapshot_value(stream, n_switches);
+        write_snapshot_vector(stream, std::vector<EventIDType>(stale_events.begin(), stale_events.end()));
+        rejection_selector.save_state(stream);
+        rejection_free_selector.save_state(stream);
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // events and settings
+    void load_state(std::istream& stream)
+    {
+        // Everything is read before any state is restored. The underlying selectors restore their own states, so
+        // the rejection selector is rolled back if the rejection-free selector's state fails to load.
+        check_snapshot_tag(stream, "HYBRID__");
+        auto loaded_runner_state = this->read_runner_state(stream);
+        bool loaded_is_rejection_mode = read_snapshot_value<bool>(stream);
+        UIntType loaded_n_selections_since_evaluation = read_snapshot_value<UIntType>(stream);
+        UIntType loaded_n_impacted_since_evaluation = read_snapshot_value<UIntType>(stream);
+        UIntType loaded_n_switches = read_snapshot_value<UIntType>(stream);
+        std::vector<EventIDType> loaded_stale_events = read_snapshot_vector<EventIDType>(stream);
+        std::stringstream rejection_selector_backup;
+        rejection_selector.save_state(rejection_selector_backup);
+        rejection_selector.load_state(stream);
+        try
+        {
+            rejection_free_selector.load_state(stream);
+        }
+        catch (...)
+        {
+            rejection_selector.load_state(rejection_selector_backup);
+            throw;
+        }
+
+        this->restore_runner_state(loaded_runner_state);
+        is_rejection_mode = loaded_is_rejection_mode;
+        n_selections_since_evaluation = loaded_n_selections_since_evaluation;
+        n_impacted_since_evaluation = loaded_n_impacted_since_evaluation;
+        n_switches = loaded_n_switches;
+        stale_events = std::set<EventIDType>(loaded_stale_events.begin(), loaded_stale_events.end());
+        return;
+    }
+
+private:
+    // Lookup table indicating, for a given event that is accepted, which events' rates are impacted
+    const std::shared_ptr<const ImpactTable> impact_table_ptr;
+
+    // Selector used in rejection mode
+    RejectionEventSelector<EventIDType, RateCalculatorType> rejection_selector;
+
+    // Selector used in rejection-free mode, whose tree may be out of date while in rejection mode
+    RejectionFreeEventSelector<EventIDType, RateCalculatorType> rejection_free_selector;
+
+    // Upper bound on event rates
+    const double rate_upper_bound;
+
+    // Switching settings
+    const HybridParameters parameters;
+
+    // Whether the rejection algorithm is in use
+    bool is_rejection_mode;
+
+    // Number of selections, and total number of impacted events, since the last evaluation
+    UIntType n_selections_since_evaluation;
+    UIntType n_impacted_since_evaluation;
+
+    // Number of times the algorithm has been switched
+    UIntType n_switches;
+
+    // Events whose rates in the tree may be out of date, because they were impacted during rejection mode
+    std::set<EventIDType> stale_events;
+
+    // Count the events impacted by a selected event, and record them as stale if in rejection mode
+    void record_impacts(const EventIDType& selected_event_id)
+    {
+        auto impact_it = impact_table_ptr->find(selected_event_id);
+        if (impact_it == impact_table_ptr->end())
+        {
+            return;
+        }
+        n_impacted_since_evaluation += impact_it->second.size();
+        if (is_rejection_mode)
+        {
+            stale_events.insert(impact_it->second.begin(), impact_it->second.end());
+        }
+        return;
+    }
+
+    // Estimate the cost per selection of both algorithms, and switch if the other one is sufficiently cheaper
+    void evaluate_mode()
+    {
+        double n_events = rejection_selector.n_events();
+        double mean_n_impacted =
+            static_cast<double>(n_impacted_since_evaluation) / static_cast<double>(n_selections_since_evaluation);
+        double tree_depth = std::log2(n_events);
+        double rejection_free_cost =
+            mean_n_impacted * (1.0 + parameters.tree_update_cost * tree_depth) + parameters.tree_update_cost * tree_depth;
+
+        double acceptance_ratio;
+        if (is_rejection_mode)
+        {
+            acceptance_ratio = rejection_selector.get_statistics().acceptance_ratio();
+        }
+        else
+        {
+            acceptance_ratio = rejection_free_selector.total_rate() / (rate_upper_bound * n_events);
+        }
+        double rejection_cost =
+            acceptance_ratio > 0.0 ? 1.0 / acceptance_ratio : std::numeric_limits<double>::infinity();
+
+        if (is_rejection_mode && parameters.switching_factor * rejection_free_cost < rejection_cost)
+        {
+            switch_to_rejection_free();
+        }
+        else if (!is_rejection_mode && parameters.switching_factor * rejection_cost < rejection_free_cost)
+        {
+            is_rejection_mode = true;
+            ++n_switches;
+        }
+
+        rejection_selector.reset_statistics();
+        n_selections_since_evaluation = 0;
+        n_impacted_since_evaluation = 0;
+        return;
+    }
+
+    // Bring the tree up to date and switch to the rejection-free algorithm
+    void switch_to_rejection_free()
+    {
+        rejection_free_selector.recalculate_rates(std::vector<EventIDType>(stale_events.begin(), stale_events.end()));
+        stale_events.clear();
+        is_rejection_mode = false;
+        ++n_switches;
+        return;
+    }
+
+    // Friend for testing
+    friend class ::HybridEventSelectorTest;
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+#endif
@@ -0,0 +1,121 @@
+#ifndef IMPACT_PROVIDER_H
+#define IMPACT_PROVIDER_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace lotto
+{
+/*
+ * Contiguous range of impacted events, viewed in place in the storage of an impact provider
+ */
+template <typename EventIDType>
+class ImpactedEvents
+{
+public:
+    // Construct an empty range
+    ImpactedEvents() : first(nullptr), last(nullptr) {}
+
+    // Construct given pointers to the first event and one past the last
+    ImpactedEvents(const EventIDType* first, const EventIDType* last) : first(first), last(last) {}
+
+    // Construct viewing the events stored in a vector
+    explicit ImpactedEvents(const std::vector<EventIDType>& events)
+        : first(events.data()), last(events.data() + events.size())
+    {
+    }
+
+    const EventIDType* begin() const { return first; }
+    const EventIDType* end() const { return last; }
+    const EventIDType* data() const { return first; }
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    const EventIDType& operator[](std::size_t ix) const { return first[ix]; }
+
+private:
+    const EventIDType* first;
+    const EventIDType* last;
+};
+
+/*
+ * Impact providers tell an event selector which events' rates are impacted when a given event is carried out,
+ * through a method
+ *     ImpactedEvents<EventIDType> impacted_events(const EventIDType& event_id)
+ * that returns the range of impacted events, which is empty if there are none. The events are not copied, so the
+ * range only needs to remain valid until the next call.
+ */
+
+/*
+ * Impact provider that looks up impacted events in a table, which may be shared with other providers
+ */
+template <typename EventIDType>
+class MapImpactProvider
+{
+public:
+    // Lookup table from each event to the events whose rates it impacts
+    // Events missing from the table impact no other events
+    using ImpactTable = std::map<EventIDType, std::vector<EventIDType>>;
+
+    explicit MapImpactProvider(const std::shared_ptr<const ImpactTable>& impact_table_ptr)
+        : impact_table_ptr(impact_table_ptr)
+    {
+        if (impact_table_ptr == nullptr)
+        {
+            throw std::runtime_error("Impact table must not be null.");
+        }
+    }
+
+    // Returns the events impacted by an event, stored in the table
+    ImpactedEvents<EventIDType> impacted_events(const EventIDType& event_id) const
+    {
+        auto impact_it = impact_table_ptr->find(event_id);
+        return impact_it == impact_table_ptr->end() ? ImpactedEvents<EventIDType>()
+                                                    : ImpactedEvents<EventIDType>(impact_it->second);
+    }
+
+private:
+    // Table of impacted events
+    const std::shared_ptr<const ImpactTable> impact_table_ptr;
+};
+
+/*
+ * Impact provider that generates impacted events on demand, for example from a stencil on a periodic lattice,
+ * so that no table needs to be stored
+ *
+ * The impact function is called as impact_function(event_id, impacted_events), and must append the IDs of all
+ * events impacted by the given event to impacted_events. Its type is a template parameter, so it can be inlined.
+ */
+template <typename EventIDType, typename ImpactFunctionType>
+class FunctionImpactProvider
+{
+public:
+    explicit FunctionImpactProvider(const ImpactFunctionType& impact_function) : impact_function(impact_function) {}
+
+    // Returns the events impacted by an event, which are only valid until the next call
+    ImpactedEvents<EventIDType> impacted_events(const EventIDType& event_id)
+    {
+        impacted_events_buffer.clear();
+        impact_function(event_id, impacted_events_buffer);
+        return ImpactedEvents<EventIDType>(impacted_events_buffer);
+    }
+
+private:
+    // Function generating impacted events
+    ImpactFunctionType impact_function;
+
+    // Storage for the most recently generated impacted events, reused between calls
+    std::vector<EventIDType> impacted_events_buffer;
+};
+
+// Make a function impact provider, deducing the type of the impact function
+template <typename EventIDType, typename ImpactFunctionType>
+FunctionImpactProvider<EventIDType, ImpactFunctionType> make_function_impact_provider(
+    const ImpactFunctionType& impact_function)
+{
+    return FunctionImpactProvider<EventIDType, ImpactFunctionType>(impact_function);
+}
+} // namespace lotto
+#endif
@@ -0,0 +1,185 @@
+#ifndef INDEXED_PRIORITY_QUEUE_H
+#define INDEXED_PRIORITY_QUEUE_H
+
+#include "snapshot.hpp"
+#include <algorithm>
+#include <cassert>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+class IndexedPriorityQueueTest;
+
+namespace lotto
+{
+/*
+ * Indexed priority queue holding one key for each element 0, 1, ..., n - 1,
+ * giving constant time access to the element with the smallest key and
+ * logarithmic time updates of the key of any element
+ *
+ * Implemented as a 4-ary min-heap, which is shallower than a binary heap and
+ * keeps the children of a node together in memory
+ */
+class IndexedPriorityQueue
+{
+public:
+    using Index = long int;
+
+    // Construct given the initial key of every element
+    IndexedPriorityQueue(const std::vector<double>& init_keys)
+        : keys(init_keys), heap(init_keys.size()), heap_positions(init_keys.size())
+    {
+        for (Index element = 0; element < size(); ++element)
+        {
+            heap[element] = element;
+            heap_positions[element] = element;
+        }
+        if (size() > 1)
+        {
+            for (Index heap_ix = parent(size() - 1); heap_ix >= 0; --heap_ix)
+            {
+                sift_down(heap_ix);
+            }
+        }
+    }
+
+    // Return the element with the smallest key
+    Index top() const
+    {
+        assert(!heap.empty()); // queue must not be empty
+        return heap[0];
+    }
+
+    // Return the smallest key
+    double top_key() const { return keys[top()]; }
+
+    // Return the key of an element
+    double get_key(Index element) const { return keys[element]; }
+
+    // Change the key of an element and restore the heap order
+    void update_key(Index element, double new_key)
+    {
+        double old_key = keys[element];
+        keys[element] = new_key;
+        if (new_key < old_key)
+        {
+            sift_up(heap_positions[element]);
+        }
+        else if (new_key > old_key)
+        {
+            sift_down(heap_positions[element]);
+        }
+        return;
+    }
+
+    // Return the number of elements
+    Index size() const { return keys.size(); }
+
+    // Write the keys and heap order to a binary snapshot
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "PRIQUEUE");
+        write_snapshot_vector(stream, keys);
+        write_snapshot_vector(stream, heap);
+        return;
+    }
+
+    // Restore the keys and heap order from a snapshot written by save_state, for a queue of the same size
+    // The heap order is restored as saved rather than rebuilt, so elements with equal keys keep their order
+    void load_state(std::istream& stream)
+    {
+        check_snapshot_tag(stream, "PRIQUEUE");
+        std::vector<double> loaded_keys = read_snapshot_vector<double>(stream);
+        std::vector<Index> loaded_heap = read_snapshot_vector<Index>(stream);
+        if (loaded_keys.size() != keys.size() || loaded_heap.size() != heap.size())
+        {
+            throw std::runtime_error("Snapshot does not match the number of events.");
+        }
+
+        // Positions are found before anything is restored, checking that the heap holds every element once
+        std::vector<Index> loaded_heap_positions(heap_positions.size(), -1);
+        for (Index heap_ix = 0; heap_ix < size(); ++heap_ix)
+        {
+            Index element = loaded_heap[heap_ix];
+            if (element < 0 || element >= size() || loaded_heap_positions[element] != -1)
+            {
+                throw std::runtime_error("Snapshot has an invalid heap order.");
+            }
+            loaded_heap_positions[element] = heap_ix;
+        }
+        keys = std::move(loaded_keys);
+        heap = std::move(loaded_heap);
+        heap_positions = std::move(loaded_heap_positions);
+        return;
+    }
+
+private:
+    // Number of children of each node
+    static constexpr Index arity = 4;
+
+    // Key of each element
+    std::vector<double> keys;
+
+    // Element stored at each position in the heap
+    std::vector<Index> heap;
+
+    // Position in the heap of each element
+    std::vector<Index> heap_positions;
+
+    static Index parent(Index heap_ix) { return (heap_ix - 1) / arity; }
+    static Index first_child(Index heap_ix) { return arity * heap_ix + 1; }
+
+    // Return the key of the element at a heap position
+    double heap_key(Index heap_ix) const { return keys[heap[heap_ix]]; }
+
+    // Swap the elements at two heap positions, keeping track of their positions
+    void swap_heap_positions(Index heap_ix_a, Index heap_ix_b)
+    {
+        std::swap(heap[heap_ix_a], heap[heap_ix_b]);
+        heap_positions[heap[heap_ix_a]] = heap_ix_a;
+        heap_positions[heap[heap_ix_b]] = heap_ix_b;
+        return;
+    }
+
+    // Move an element towards the root until its parent's key is no larger
+    void sift_up(Index heap_ix)
+    {
+        while (heap_ix > 0 && heap_key(heap_ix) < heap_key(parent(heap_ix)))
+        {
+            swap_heap_positions(heap_ix, parent(heap_ix));
+            heap_ix = parent(heap_ix);
+        }
+        return;
+    }
+
+    // Move an element towards the leaves until none of its children's keys are smaller
+    void sift_down(Index heap_ix)
+    {
+        while (true)
+        {
+            Index smallest_ix = heap_ix;
+            Index child_begin = first_child(heap_ix);
+            Index child_end = std::min(child_begin + arity, size());
+            for (Index child_ix = child_begin; child_ix < child_end; ++child_ix)
+            {
+                if (heap_key(child_ix) < heap_key(smallest_ix))
+                {
+                    smallest_ix = child_ix;
+                }
+            }
+            if (smallest_ix == heap_ix)
+            {
+                return;
+            }
+            swap_heap_positions(heap_ix, smallest_ix);
+            heap_ix = smallest_ix;
+        }
+    }
+
+    // Friend for testing
+    friend class ::IndexedPriorityQueueTest;
+};
+} // namespace lotto
+#endif
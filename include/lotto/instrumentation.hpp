@@ -0,0 +1,143 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include "random.hpp"
+#include <chrono>
+
+#if defined(LOTTO_ENABLE_INSTRUMENTATION) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+/*
+ * Instrumentation of the selectors' hot paths is compiled in only if LOTTO_ENABLE_INSTRUMENTATION is defined
+ * before including any kmc-lotto header. Otherwise, every LOTTO_INSTRUMENT statement is removed by the preprocessor,
+ * and the selectors' statistics stay zero.
+ *
+ * The macro changes the definitions of the selectors' member functions, so it should be set for the whole project
+ * (e.g. with -DLOTTO_ENABLE_INSTRUMENTATION), not per file. So that files built with different settings never share
+ * a definition, the classes it affects are declared in an inline namespace named after the setting. Each setting
+ * then gives distinct symbols, and passing a selector between files built with different settings fails to link.
+ */
+#ifdef LOTTO_ENABLE_INSTRUMENTATION
+#define LOTTO_INSTRUMENT(...) __VA_ARGS__
+#define LOTTO_INSTRUMENTATION_NAMESPACE instrumented
+#else
+#define LOTTO_INSTRUMENT(...)
+#define LOTTO_INSTRUMENTATION_NAMESPACE uninstrumented
+#endif
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+// True if selectors record instrumentation statistics
+#ifdef LOTTO_ENABLE_INSTRUMENTATION
+constexpr bool instrumentation_enabled = true;
+#else
+constexpr bool instrumentation_enabled = false;
+#endif
+
+// Returns the current value of a cheap, monotonic cycle counter, for measuring short intervals
+// Uses the time stamp counter on x86, and otherwise falls back to a steady clock in nanoseconds
+inline UIntType read_cycle_counter()
+{
+#if defined(LOTTO_ENABLE_INSTRUMENTATION) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+/*
+ * Number of times a phase of event selection was entered, and the cycles spent in it
+ */
+struct PhaseStatistics
+{
+    // Number of times the phase was entered
+    UIntType n_calls = 0;
+
+    // Total cycles spent in the phase
+    UIntType n_cycles = 0;
+
+    // Record a single call to the phase, which started at the given cycle count
+    void add_call(UIntType start_cycle)
+    {
+        ++n_calls;
+        n_cycles += read_cycle_counter() - start_cycle;
+        return;
+    }
+
+    // Add the calls and cycles recorded by another phase, e.g. of another selector
+    void add(const PhaseStatistics& other)
+    {
+        n_calls += other.n_calls;
+        n_cycles += other.n_cycles;
+        return;
+    }
+
+    // Average cycles per call (zero if the phase was never entered)
+    double average_cycles() const
+    {
+        return n_calls == 0 ? 0.0 : static_cast<double>(n_cycles) / static_cast<double>(n_calls);
+    }
+};
+
+/*
+ * Statistics describing where a selector spends its time, recorded only if LOTTO_ENABLE_INSTRUMENTATION is defined
+ *
+ * Phases may be nested: the impact update phase includes the rate calculations and tree updates it makes.
+ * Phases a selector does not have are left at zero.
+ */
+struct SelectorInstrumentation
+{
+    // Calls to select_event (or equivalent)
+    PhaseStatistics selection;
+
+    // Updates of the rates impacted by committed events, including the rate calculations and tree updates they make
+    PhaseStatistics impact_update;
+
+    // Calls to the rate calculator
+    PhaseStatistics rate_calculation;
+
+    // Rate updates applied to the event rate tree, including the resum of the affected nodes
+    PhaseStatistics tree_update;
+
+    // Queries of the event rate tree
+    PhaseStatistics tree_query;
+
+    // Samples drawn from the random number generator
+    PhaseStatistics random_sampling;
+
+    // Total length of the impacted event lists processed by impact updates
+    UIntType n_impacted_events = 0;
+
+    // Total number of tree nodes visited by queries and updated by rate updates
+    UIntType n_tree_nodes_touched = 0;
+
+    // Add the statistics recorded by another selector, e.g. to combine those of selectors used by a composite selector
+    void add(const SelectorInstrumentation& other)
+    {
+        selection.add(other.selection);
+        impact_update.add(other.impact_update);
+        rate_calculation.add(other.rate_calculation);
+        tree_update.add(other.tree_update);
+        tree_query.add(other.tree_query);
+        random_sampling.add(other.random_sampling);
+        n_impacted_events += other.n_impacted_events;
+        n_tree_nodes_touched += other.n_tree_nodes_touched;
+        return;
+    }
+
+    // Average number of impacted events per impact update (zero if there were none)
+    double average_impact_length() const
+    {
+        return impact_update.n_calls == 0
+                   ? 0.0
+                   : static_cast<double>(n_impacted_events) / static_cast<double>(impact_update.n_calls);
+    }
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+#endif
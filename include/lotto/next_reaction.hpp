@@ -0,0 +1,318 @@
+#ifndef NEXT_REACTION_H
+#define NEXT_REACTION_H
+
+#include "event_selector.hpp"
+#include "indexed_priority_queue.hpp"
+#include "instrumentation.hpp"
+#include "snapshot.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+class NextReactionEventSelectorTest;
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Event selector implemented using the next reaction method of Gibson and Bruck
+ *
+ * Every event is assigned a putative absolute time at which it will next occur, and the event
+ * with the earliest time is selected. When the rate of an impacted event changes, its remaining
+ * waiting time is rescaled by the ratio of its old and new rates rather than drawn again,
+ * so only the selected event needs a new random number. Times are kept in an indexed priority queue,
+ * so each selection costs one update per impacted event, each logarithmic in the number of events.
+ */
+template <typename EventIDType, typename RateCalculatorType>
+class NextReactionEventSelector
+    : public EventSelectorBase<EventIDType, RateCalculatorType>,
+      public EventSelectorRunner<NextReactionEventSelector<EventIDType, RateCalculatorType>, EventIDType>
+{
+public:
+    // Lookup table from each event to the events whose rates it impacts
+    using ImpactTable = std::map<EventIDType, std::vector<EventIDType>>;
+
+    // Construct given a rate calculator, event ID list, and impact table
+    NextReactionEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                              const std::vector<EventIDType>& event_id_list,
+                              const ImpactTable& impact_table)
+        : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
+          event_id_list(event_id_list),
+          event_to_index(event_to_index_map(event_id_list)),
+          rates(this->calculate_rates(event_id_list)),
+          event_times(std::vector<double>(event_id_list.size(), std::numeric_limits<double>::infinity())),
+          impact_table(impact_table),
+          time(0.0),
+          are_event_times_drawn(false),
+          impacted_events_ptr(nullptr),
+          last_selected_ix(-1)
+    {
+        if (event_id_list.empty())
+        {
+            throw std::runtime_error("Event ID list must not be empty.");
+        }
+    }
+
+    // Select an event and return its ID and the time step
+    std::pair<EventIDType, double> select_event() final
+    {
+        LOTTO_INSTRUMENT(UIntType selection_start_cycle = read_cycle_counter());
+
+        // Initial times are drawn on the first selection rather than on construction,
+        // so that they depend on the seed if the generator is reseeded in between
+        if (!are_event_times_drawn)
+        {
+            draw_initial_event_times();
+        }
+
+        // Because this function only selects events and does not process them,
+        // it cannot update any rates impacted by the selected event until the next call.
+        update_impacted_event_times();
+
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        Index selected_ix = event_times.top();
+        double selected_time = event_times.top_key();
+        LOTTO_INSTRUMENT(instrumentation.tree_query.add_call(start_cycle));
+        assert(selected_time < std::numeric_limits<double>::infinity()); // at least one rate must be positive
+        double time_step = selected_time - time;
+        time = selected_time;
+
+        last_selected_ix = selected_ix;
+        set_impacted_events(event_id_list[selected_ix]);
+        LOTTO_INSTRUMENT(instrumentation.selection.add_call(selection_start_cycle));
+        return std::make_pair(event_id_list[selected_ix], time_step);
+    }
+
+    // Returns the number of calls to, and cycles spent in, each phase of selection, which are only recorded if
+    // LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp). The priority queue of event times counts as
+    // the tree: updating an event's time is a tree update, and finding the earliest one a tree query.
+    const SelectorInstrumentation& get_instrumentation() const { return instrumentation; }
+
+    // Resets the instrumentation statistics
+    void reset_instrumentation() { instrumentation = SelectorInstrumentation(); }
+
+    // Write the selector's state to a binary snapshot: the random number generator, the runner state, the current
+    // rates and event times, and the last selected event, whose impacts have not yet been applied. The rate
+    // calculator and impact table are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "NEXTRXN_");
+        this->random_generator.save_state(stream);
+        this->save_runner_state(stream);
+        write_snapshot_vector(stream, rates);
+        event_times.save_state(stream);
+        write_snapshot_value(stream, time);
+        write_snapshot_value(stream, are_event_times_drawn);
+        write_snapshot_value(stream, last_selected_ix);
+        write_snapshot_value(stream, impacted_events_ptr != nullptr);
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // events and impact table. No rates are calculated or times drawn, so selection continues exactly as it would have.
+    void load_state(std::istream& stream)
+    {
+        // The whole snapshot is read before any state is restored, so a snapshot that fails to load has no effect
+        check_snapshot_tag(stream, "NEXTRXN_");
+        RandomGenerator loaded_generator = this->random_generator;
+        loaded_generator.load_state(stream);
+        auto loaded_runner_state = this->read_runner_state(stream);
+        std::vector<double> loaded_rates = read_snapshot_vector<double>(stream);
+        if (loaded_rates.size() != rates.size())
+        {
+            throw std::runtime_error("Snapshot does not match the number of events.");
+        }
+        IndexedPriorityQueue loaded_event_times = event_times;
+        loaded_event_times.load_state(stream);
+        double loaded_time = read_snapshot_value<double>(stream);
+        bool loaded_are_event_times_drawn = read_snapshot_value<bool>(stream);
+        Index loaded_last_selected_ix = read_snapshot_value<Index>(stream);
+        bool has_impacted_events = read_snapshot_value<bool>(stream);
+        if (loaded_last_selected_ix < -1 || loaded_last_selected_ix >= static_cast<Index>(event_id_list.size()))
+        {
+            throw std::runtime_error("Snapshot does not match the number of events.");
+        }
+
+        this->random_generator = loaded_generator;
+        this->restore_runner_state(loaded_runner_state);
+        rates = std::move(loaded_rates);
+        event_times = std::move(loaded_event_times);
+        time = loaded_time;
+        are_event_times_drawn = loaded_are_event_times_drawn;
+        last_selected_ix = loaded_last_selected_ix;
+        impacted_events_ptr = nullptr;
+        if (has_impacted_events && last_selected_ix >= 0)
+        {
+            set_impacted_events(event_id_list[last_selected_ix]);
+        }
+        return;
+    }
+
+private:
+    using Index = IndexedPriorityQueue::Index;
+
+    // IDs of all events, indexed by their position in the priority queue
+    const std::vector<EventIDType> event_id_list;
+
+    // Given an event ID, get the corresponding index into the event ID list
+    const std::map<EventIDType, Index> event_to_index;
+
+    // Current rate of each event
+    std::vector<double> rates;
+
+    // Absolute time at which each event will next occur, infinite for events with zero rate
+    IndexedPriorityQueue event_times;
+
+    // Lookup table indicating, for a given event that is accepted, which events' rates are impacted
+    const ImpactTable impact_table;
+
+    // Absolute time of the most recently selected event
+    double time;
+
+    // Whether initial event times have been drawn yet
+    bool are_event_times_drawn;
+
+    // Pointer to vector of impacted events whose rates have not been updated
+    const std::vector<EventIDType>* impacted_events_ptr;
+
+    // Index of the most recently selected event, which always needs a new time
+    Index last_selected_ix;
+
+    // Time spent in each phase of selection, if instrumentation is enabled
+    SelectorInstrumentation instrumentation;
+
+    // Returns an absolute time for an event drawn from the exponential distribution, infinite if the rate is zero
+    double draw_event_time(double rate)
+    {
+        if (rate <= 0.0)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        double unit_sample = this->random_generator.sample_unit_interval();
+        LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+        return time - std::log(unit_sample) / rate;
+    }
+
+    // Set the time of an event in the priority queue, timing the update if instrumentation is enabled
+    void update_event_key(Index event_ix, double event_time)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        event_times.update_key(event_ix, event_time);
+        LOTTO_INSTRUMENT(instrumentation.tree_update.add_call(start_cycle));
+        return;
+    }
+
+    // Draw times for all events
+    void draw_initial_event_times()
+    {
+        for (std::size_t event_ix = 0; event_ix < rates.size(); ++event_ix)
+        {
+            update_event_key(static_cast<Index>(event_ix), draw_event_time(rates[event_ix]));
+        }
+        are_event_times_drawn = true;
+        return;
+    }
+
+    // Set the impact events pointer based on an accepted event ID
+    void set_impacted_events(const EventIDType& accepted_event_id)
+    {
+        assert(impacted_events_ptr == nullptr); // pointer should be null before proceeding
+        auto impact_it = impact_table.find(accepted_event_id);
+        if (impact_it != impact_table.end())
+        {
+            impacted_events_ptr = &impact_it->second;
+        }
+        return;
+    }
+
+    // Update rates of impacted events and rescale their times, then draw a new time for the last selected event
+    void update_impacted_event_times()
+    {
+        if (impacted_events_ptr != nullptr)
+        {
+            LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+            LOTTO_INSTRUMENT(instrumentation.n_impacted_events += impacted_events_ptr->size());
+            for (const EventIDType& event_id : *impacted_events_ptr)
+            {
+                if (this->is_rate_update_needed(event_id))
+                {
+                    update_event_time(event_to_index.at(event_id), calculate_rate_instrumented(event_id));
+                }
+            }
+            impacted_events_ptr = nullptr;
+            LOTTO_INSTRUMENT(instrumentation.impact_update.add_call(start_cycle));
+        }
+        if (last_selected_ix >= 0)
+        {
+            update_event_key(last_selected_ix, draw_event_time(rates[last_selected_ix]));
+            last_selected_ix = -1;
+        }
+        return;
+    }
+
+    // Store a new rate for an event and adjust its time accordingly
+    void update_event_time(Index event_ix, double new_rate)
+    {
+        double old_rate = rates[event_ix];
+        if (new_rate == old_rate)
+        {
+            return;
+        }
+        rates[event_ix] = new_rate;
+        if (event_ix == last_selected_ix)
+        {
+            // A new time will be drawn anyway
+            return;
+        }
+        if (old_rate <= 0.0 || new_rate <= 0.0)
+        {
+            // No remaining waiting time to rescale
+            update_event_key(event_ix, draw_event_time(new_rate));
+        }
+        else
+        {
+            double rescaled_time = time + (old_rate / new_rate) * (event_times.get_key(event_ix) - time);
+            update_event_key(event_ix, rescaled_time);
+        }
+        return;
+    }
+
+    // Returns the rate given an event ID, timing the calculation if instrumentation is enabled
+    double calculate_rate_instrumented(const EventIDType& event_id)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        double rate = this->calculate_rate(event_id);
+        LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
+        return rate;
+    }
+
+    // Generate the list index map for all events, making sure there are no duplicates
+    static std::map<EventIDType, Index> event_to_index_map(const std::vector<EventIDType>& event_id_list)
+    {
+        std::map<EventIDType, Index> index_map;
+        for (std::size_t event_ix = 0; event_ix < event_id_list.size(); ++event_ix)
+        {
+            if (!index_map.emplace(event_id_list[event_ix], static_cast<Index>(event_ix)).second)
+            {
+                throw std::runtime_error("Event IDs must be unique.");
+            }
+        }
+        return index_map;
+    }
+
+    // Friend for testing
+    friend class ::NextReactionEventSelectorTest;
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+
+#endif
@@ -1,10 +1,16 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
+#include "snapshot.hpp"
 #include <cmath>
 #include <cstdint>
+#include <istream>
 #include <limits>
+#include <ostream>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
 namespace lotto
 {
@@ -41,6 +47,16 @@ public:
     /// Returns a random real from the half-open unit interval (0, 1]
     RealType sample_unit_interval() { return unit_interval_distribution(generator); }
 
+    /// Returns a random integer from the Poisson distribution with the given (non-negative) mean
+    UIntType sample_poisson(RealType mean)
+    {
+        if (mean <= 0.0)
+        {
+            return 0;
+        }
+        return std::poisson_distribution<UIntType>(mean)(generator);
+    }
+
     /// Returns the value used to seed the generator
     UIntType get_seed() const { return seed; }
 
@@ -51,6 +67,44 @@ public:
         generator.seed(seed);
     }
 
+    /// Writes the seed and the full generator state to a binary snapshot
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "RNGSTATE");
+        write_snapshot_value(stream, seed);
+        // The standard only exposes the generator state as text, so its words are parsed and written in binary
+        std::stringstream generator_state;
+        generator_state << generator;
+        std::vector<std::mt19937_64::result_type> state_words;
+        std::mt19937_64::result_type state_word;
+        while (generator_state >> state_word)
+        {
+            state_words.push_back(state_word);
+        }
+        write_snapshot_vector(stream, state_words);
+    }
+
+    /// Restores the seed and generator state from a snapshot written by save_state
+    void load_state(std::istream& stream)
+    {
+        check_snapshot_tag(stream, "RNGSTATE");
+        UIntType loaded_seed = read_snapshot_value<UIntType>(stream);
+        std::vector<std::mt19937_64::result_type> state_words =
+            read_snapshot_vector<std::mt19937_64::result_type>(stream);
+        std::stringstream generator_state;
+        for (std::mt19937_64::result_type state_word : state_words)
+        {
+            generator_state << state_word << ' ';
+        }
+        std::mt19937_64 loaded_generator;
+        if (state_words.size() < std::mt19937_64::state_size || !(generator_state >> loaded_generator))
+        {
+            throw std::runtime_error("Snapshot has an invalid generator state.");
+        }
+        seed = loaded_seed;
+        generator = loaded_generator;
+    }
+
 private:
     /// 64-bit Mersenne Twister generator
     std::mt19937_64 generator;
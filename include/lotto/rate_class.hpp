@@ -0,0 +1,422 @@
+#ifndef RATE_CLASS_H
+#define RATE_CLASS_H
+
+#include "event_rate_tree.hpp"
+#include "event_rate_tree_impl.hpp"
+#include "event_selector.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+class RateClassEventSelectorTest;
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Event selector implemented using rejection-free KMC with events grouped into classes of equal rate
+ *
+ * Events with exactly the same rate are stored together in a class, so selection first picks a class,
+ * with probability proportional to its total rate (number of events times rate), and then picks an event
+ * from that class uniformly. Events and classes are located through hash maps, so a change of rate moves the event
+ * from one class to another in O(1) amortized time, plus O(log C) to update the class totals, where C is the number
+ * of classes. Class totals are kept in a sum tree indexed by class slot, so selecting a class also takes O(log C).
+ * A rate not seen before creates a new class, which allocates.
+ * This is most efficient if the number of distinct rates is small, i.e. if rates are highly degenerate.
+ *
+ * Event IDs must be hashable with std::hash.
+ */
+template <typename EventIDType, typename RateCalculatorType>
+class RateClassEventSelector
+    : public EventSelectorBase<EventIDType, RateCalculatorType>,
+      public EventSelectorRunner<RateClassEventSelector<EventIDType, RateCalculatorType>, EventIDType>
+{
+public:
+    // Lookup table from each event to the events whose rates it impacts
+    using ImpactTable = std::map<EventIDType, std::vector<EventIDType>>;
+
+    // Construct given a rate calculator, event ID list, and impact table
+    RateClassEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                           const std::vector<EventIDType>& event_id_list,
+                           const ImpactTable& impact_table)
+        : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
+          impact_table(impact_table),
+          impacted_events_ptr(nullptr)
+    {
+        if (event_id_list.empty())
+        {
+            throw std::runtime_error("Event ID list must not be empty.");
+        }
+        event_locations.reserve(event_id_list.size());
+        for (const EventIDType& event_id : event_id_list)
+        {
+            if (event_locations.find(event_id) != event_locations.end())
+            {
+                throw std::runtime_error("Event IDs must be unique.");
+            }
+            insert_event(event_id, this->calculate_rate(event_id));
+        }
+        rebuild_class_rate_tree(rate_classes.size());
+    }
+
+    // Select an event and return its ID and the time step
+    std::pair<EventIDType, double> select_event() final
+    {
+        LOTTO_INSTRUMENT(UIntType selection_start_cycle = read_cycle_counter());
+
+        // Because this function only selects events and does not process them,
+        // it cannot update any rates impacted by the selected event until the next call.
+        update_impacted_event_rates();
+
+        // Rates should now be updated. Calculate total rate and time step
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        double total_rate = class_rate_tree_ptr->total_rate();
+        double time_step = this->calculate_time_step(total_rate);
+        double query_value = total_rate * this->random_generator.sample_unit_interval();
+        LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+
+        // Pick a class, then pick an event within it
+        LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
+        const RateClass& selected_class = select_class(query_value);
+        LOTTO_INSTRUMENT(instrumentation.tree_query.add_call(start_cycle));
+        LOTTO_INSTRUMENT(instrumentation.n_tree_nodes_touched += class_rate_tree_ptr->path_length());
+        LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
+        const EventIDType& selected_event_id =
+            selected_class.event_ids[this->random_generator.sample_integer_range(selected_class.event_ids.size() - 1)];
+        LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+
+        // Update impacted event list and return
+        set_impacted_events(selected_event_id);
+        LOTTO_INSTRUMENT(instrumentation.selection.add_call(selection_start_cycle));
+        return std::make_pair(selected_event_id, time_step);
+    }
+
+    // Returns the number of distinct rates currently held by events
+    std::size_t n_rate_classes() const { return rate_to_class_index.size(); }
+
+    // Returns the number of calls to, and cycles spent in, each phase of selection, which are only recorded if
+    // LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp). Moving an event to the class for its new
+    // rate counts as a tree update, and selecting a class as a tree query of the tree of class totals.
+    const SelectorInstrumentation& get_instrumentation() const { return instrumentation; }
+
+    // Resets the instrumentation statistics
+    void reset_instrumentation() { instrumentation = SelectorInstrumentation(); }
+
+    // Write the selector's state to a binary snapshot: the random number generator, the runner state, every class
+    // with its events in order, and the events impacted by the last selection whose rates have not yet been updated.
+    // The rate calculator and impact table are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "RATECLS_");
+        this->random_generator.save_state(stream);
+        this->save_runner_state(stream);
+        write_snapshot_value<std::uint64_t>(stream, class_rate_tree_capacity);
+        write_snapshot_value<std::uint64_t>(stream, rate_classes.size());
+        for (const RateClass& rate_class : rate_classes)
+        {
+            write_snapshot_value(stream, rate_class.rate);
+            write_snapshot_vector(stream, rate_class.event_ids);
+        }
+        write_snapshot_vector(stream, empty_class_indices);
+        write_snapshot_vector(stream,
+                              impacted_events_ptr == nullptr ? std::vector<EventIDType>() : *impacted_events_ptr);
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // events. No rates are calculated, and the classes keep their saved order, so selection continues exactly as it
+    // would have if the rate calculator is in the same state as when the snapshot was saved.
+    void load_state(std::istream& stream)
+    {
+        // The whole snapshot is read and checked before any state is restored
+        check_snapshot_tag(stream, "RATECLS_");
+        RandomGenerator loaded_generator = this->random_generator;
+        loaded_generator.load_state(stream);
+        auto loaded_runner_state = this->read_runner_state(stream);
+        std::size_t loaded_capacity = read_snapshot_value<std::uint64_t>(stream);
+        std::vector<RateClass> loaded_rate_classes(read_snapshot_value<std::uint64_t>(stream));
+        for (RateClass& rate_class : loaded_rate_classes)
+        {
+            rate_class.rate = read_snapshot_value<double>(stream);
+            rate_class.event_ids = read_snapshot_vector<EventIDType>(stream);
+        }
+        std::vector<std::size_t> loaded_empty_class_indices = read_snapshot_vector<std::size_t>(stream);
+        std::vector<EventIDType> loaded_impacted_events = read_snapshot_vector<EventIDType>(stream);
+
+        std::unordered_map<double, std::size_t> loaded_rate_to_class_index;
+        std::unordered_map<EventIDType, EventLocation> loaded_event_locations;
+        loaded_event_locations.reserve(event_locations.size());
+        std::size_t n_empty_classes = 0;
+        for (std::size_t class_ix = 0; class_ix < loaded_rate_classes.size(); ++class_ix)
+        {
+            const RateClass& rate_class = loaded_rate_classes[class_ix];
+            if (rate_class.event_ids.empty())
+            {
+                ++n_empty_classes;
+                continue;
+            }
+            if (!loaded_rate_to_class_index.emplace(rate_class.rate, class_ix).second)
+            {
+                throw std::runtime_error("Snapshot has more than one class with the same rate.");
+            }
+            for (std::size_t member_ix = 0; member_ix < rate_class.event_ids.size(); ++member_ix)
+            {
+                const EventIDType& event_id = rate_class.event_ids[member_ix];
+                if (event_locations.find(event_id) == event_locations.end() ||
+                    !loaded_event_locations.emplace(event_id, EventLocation{class_ix, member_ix}).second)
+                {
+                    throw std::runtime_error("Snapshot does not match the selector's events.");
+                }
+            }
+        }
+        if (loaded_event_locations.size() != event_locations.size() ||
+            loaded_empty_class_indices.size() != n_empty_classes || loaded_capacity < loaded_rate_classes.size())
+        {
+            throw std::runtime_error("Snapshot does not match the selector's events.");
+        }
+        for (std::size_t class_ix : loaded_empty_class_indices)
+        {
+            if (class_ix >= loaded_rate_classes.size() || !loaded_rate_classes[class_ix].event_ids.empty())
+            {
+                throw std::runtime_error("Snapshot has an invalid list of empty classes.");
+            }
+        }
+        for (const EventIDType& event_id : loaded_impacted_events)
+        {
+            if (event_locations.find(event_id) == event_locations.end())
+            {
+                throw std::runtime_error("Snapshot does not match the selector's events.");
+            }
+        }
+
+        this->random_generator = loaded_generator;
+        this->restore_runner_state(loaded_runner_state);
+        rate_classes = std::move(loaded_rate_classes);
+        empty_class_indices = std::move(loaded_empty_class_indices);
+        rate_to_class_index = std::move(loaded_rate_to_class_index);
+        event_locations = std::move(loaded_event_locations);
+        rebuild_class_rate_tree(loaded_capacity);
+        restored_impacted_events = std::move(loaded_impacted_events);
+        impacted_events_ptr = restored_impacted_events.empty() ? nullptr : &restored_impacted_events;
+        return;
+    }
+
+private:
+    // Events that all have the same rate
+    struct RateClass
+    {
+        double rate = 0.0;
+        std::vector<EventIDType> event_ids;
+    };
+
+    // Position of an event: its class, and its index within the class
+    struct EventLocation
+    {
+        std::size_t class_ix;
+        std::size_t member_ix;
+    };
+
+    // All classes, some of which may be empty and available for reuse
+    std::vector<RateClass> rate_classes;
+
+    // Indices of empty classes
+    std::vector<std::size_t> empty_class_indices;
+
+    // Given a rate, get the index of the class holding events with that rate
+    std::unordered_map<double, std::size_t> rate_to_class_index;
+
+    // Given an event ID, get its location
+    std::unordered_map<EventIDType, EventLocation> event_locations;
+
+    // Sum tree of the total rate of each class slot (zero for empty slots), with slots beyond the current number
+    // of classes reserved for new ones
+    std::unique_ptr<EventRateTree<std::size_t>> class_rate_tree_ptr;
+
+    // Number of class slots in the tree
+    std::size_t class_rate_tree_capacity = 0;
+
+    // Lookup table indicating, for a given event that is accepted, which events' rates are impacted
+    const ImpactTable impact_table;
+
+    // Pointer to vector of impacted events whose rates have not been updated
+    const std::vector<EventIDType>* impacted_events_ptr;
+
+    // Impacted events restored from a snapshot, pointed to until their rates are updated
+    std::vector<EventIDType> restored_impacted_events;
+
+    // Time spent in each phase of selection, if instrumentation is enabled
+    SelectorInstrumentation instrumentation;
+
+    // Returns the total rate of a class, i.e. the number of events in it times their rate
+    double class_rate(std::size_t class_ix) const
+    {
+        const RateClass& rate_class = rate_classes[class_ix];
+        return rate_class.rate * rate_class.event_ids.size();
+    }
+
+    // Returns the class for which the cumulative rate of classes up to and including it first reaches the query value
+    const RateClass& select_class(double query_value) const
+    {
+        assert(query_value > 0); // query value must be positive
+        std::size_t class_ix = class_rate_tree_ptr->query_tree(query_value);
+        assert(class_rate(class_ix) > 0.0); // classes with no rate should never be selected
+        return rate_classes[class_ix];
+    }
+
+    // Build the tree of class totals anew, with room for at least the given number of class slots
+    void rebuild_class_rate_tree(std::size_t min_capacity)
+    {
+        class_rate_tree_capacity = std::max<std::size_t>(min_capacity, 1);
+        std::vector<std::size_t> class_slots(class_rate_tree_capacity);
+        std::iota(class_slots.begin(), class_slots.end(), 0);
+        std::vector<double> class_rates(class_rate_tree_capacity, 0.0);
+        for (std::size_t class_ix = 0; class_ix < rate_classes.size(); ++class_ix)
+        {
+            class_rates[class_ix] = class_rate(class_ix);
+        }
+        class_rate_tree_ptr = std::make_unique<EventRateTree<std::size_t>>(class_slots, class_rates);
+        return;
+    }
+
+    // Store the current total rate of a class in the tree, making room for the class slot if needed
+    // Does nothing during construction, before the tree has been built
+    void update_class_rate(std::size_t class_ix)
+    {
+        if (class_rate_tree_ptr == nullptr)
+        {
+            return;
+        }
+        if (class_ix >= class_rate_tree_capacity)
+        {
+            // Double the number of slots, so that rebuilding takes amortized constant time per new class
+            rebuild_class_rate_tree(std::max(2 * class_rate_tree_capacity, rate_classes.size()));
+            return;
+        }
+        class_rate_tree_ptr->update_rate(class_ix, class_rate(class_ix));
+        return;
+    }
+
+    // Add an event to the class for its rate, creating the class if needed
+    void insert_event(const EventIDType& event_id, double rate)
+    {
+        auto class_it = rate_to_class_index.find(rate);
+        std::size_t class_ix;
+        if (class_it != rate_to_class_index.end())
+        {
+            class_ix = class_it->second;
+        }
+        else if (!empty_class_indices.empty())
+        {
+            class_ix = empty_class_indices.back();
+            empty_class_indices.pop_back();
+            rate_classes[class_ix].rate = rate;
+            rate_to_class_index[rate] = class_ix;
+        }
+        else
+        {
+            class_ix = rate_classes.size();
+            rate_classes.emplace_back();
+            rate_classes[class_ix].rate = rate;
+            rate_to_class_index[rate] = class_ix;
+        }
+        std::vector<EventIDType>& members = rate_classes[class_ix].event_ids;
+        event_locations[event_id] = EventLocation{class_ix, members.size()};
+        members.push_back(event_id);
+        update_class_rate(class_ix);
+        return;
+    }
+
+    // Remove an event from its class, by swapping it with the last event, and release the class if it becomes empty
+    void remove_event(const EventLocation& location)
+    {
+        RateClass& rate_class = rate_classes[location.class_ix];
+        std::vector<EventIDType>& members = rate_class.event_ids;
+        if (location.member_ix != members.size() - 1)
+        {
+            members[location.member_ix] = members.back();
+            event_locations[members[location.member_ix]].member_ix = location.member_ix;
+        }
+        members.pop_back();
+        if (members.empty())
+        {
+            rate_to_class_index.erase(rate_class.rate);
+            empty_class_indices.push_back(location.class_ix);
+        }
+        update_class_rate(location.class_ix);
+        return;
+    }
+
+    // Move an event to the class for its new rate, if the rate has changed
+    void update_rate(const EventIDType& event_id, double new_rate)
+    {
+        EventLocation location = event_locations.at(event_id);
+        if (rate_classes[location.class_ix].rate == new_rate)
+        {
+            return;
+        }
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        remove_event(location);
+        insert_event(event_id, new_rate);
+        LOTTO_INSTRUMENT(instrumentation.tree_update.add_call(start_cycle));
+        LOTTO_INSTRUMENT(instrumentation.n_tree_nodes_touched += 2 * class_rate_tree_ptr->path_length());
+        return;
+    }
+
+    // Set the impact events pointer based on an accepted event ID
+    void set_impacted_events(const EventIDType& accepted_event_id)
+    {
+        assert(impacted_events_ptr == nullptr); // pointer should be null before proceeding
+        auto impact_it = impact_table.find(accepted_event_id);
+        if (impact_it != impact_table.end())
+        {
+            impacted_events_ptr = &impact_it->second;
+        }
+        return;
+    }
+
+    // Update the stored rates for impacted events, skipping any the rate calculator reports as unchanged
+    void update_impacted_event_rates()
+    {
+        if (impacted_events_ptr != nullptr)
+        {
+            LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+            LOTTO_INSTRUMENT(instrumentation.n_impacted_events += impacted_events_ptr->size());
+            for (const EventIDType& event_id : *impacted_events_ptr)
+            {
+                if (this->is_rate_update_needed(event_id))
+                {
+                    update_rate(event_id, calculate_rate_instrumented(event_id));
+                }
+            }
+            impacted_events_ptr = nullptr;
+            LOTTO_INSTRUMENT(instrumentation.impact_update.add_call(start_cycle));
+        }
+        return;
+    }
+
+    // Returns the rate given an event ID, timing the calculation if instrumentation is enabled
+    double calculate_rate_instrumented(const EventIDType& event_id)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        double rate = this->calculate_rate(event_id);
+        LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
+        return rate;
+    }
+
+    // Friend for testing
+    friend class ::RateClassEventSelectorTest;
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+
+#endif
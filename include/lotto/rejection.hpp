@@ -2,72 +2,287 @@
 #define REJECTION_H
 
 #include "event_selector.hpp"
+#include "instrumentation.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <functional>
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class RejectionEventSelectorTest;
 
 namespace lotto
 {
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Counters describing the acceptance behavior of a rejection event selector
+ */
+struct RejectionStatistics
+{
+    // Total number of attempted events
+    UIntType n_attempts = 0;
+
+    // Total number of accepted events (equal to the number of selections)
+    UIntType n_acceptances = 0;
+
+    // Largest number of attempts needed for a single selection
+    UIntType max_attempts_per_selection = 0;
+
+    // Fraction of attempts that were accepted (zero if nothing has been attempted)
+    double acceptance_ratio() const
+    {
+        return n_attempts == 0 ? 0.0 : static_cast<double>(n_acceptances) / static_cast<double>(n_attempts);
+    }
+};
+
 /*
  * Event selector implemented using rejection KMC algorithm
+ *
+ * Event IDs must be unique, and hashable with std::hash, which indexes events so that they can be added or removed.
+ * Uniqueness is checked when the index is first built (by add_event, remove_event or contains_event), rather than
+ * on construction or load_state, so that selectors with a fixed list never pay for it.
  */
 template <typename EventIDType, typename RateCalculatorType>
-class RejectionEventSelector : public EventSelectorBase<EventIDType, RateCalculatorType>
+class RejectionEventSelector
+    : public EventSelectorBase<EventIDType, RateCalculatorType>,
+      public EventSelectorRunner<RejectionEventSelector<EventIDType, RateCalculatorType>, EventIDType>
 {
 public:
+    // Construct given a rate calculator, rate upper bound, and event ID list
+    // The list is stored by the selector, so pass it as an rvalue (e.g. with std::move) to avoid copying it
     RejectionEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
                            double rate_upper_bound,
-                           const std::vector<EventIDType>& event_id_list)
+                           std::vector<EventIDType> event_id_list)
         : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
           rate_upper_bound(rate_upper_bound),
-          event_id_list(event_id_list)
+          event_id_list(std::move(event_id_list)),
+          rejection_limit(0)
     {
         // Make sure that provided parameters make sense
         if (rate_upper_bound <= 0.0)
         {
             throw std::runtime_error("Rate upper bound must be positive.");
         }
-        if (event_id_list.empty())
+        if (this->event_id_list.empty())
         {
             throw std::runtime_error("Event ID list must not be empty.");
         }
     }
 
     // Attempts events, repeats until an event is accepted and returns the ID of selected event and accumulated time step
-    std::pair<EventIDType, double> select_event()
+    // This could loop forever if all rates are (close to) zero, see set_rejection_limit to guard against this
+    std::pair<EventIDType, double> select_event() final
     {
+        if (event_id_list.empty())
+        {
+            throw std::runtime_error("Cannot select an event, no events remain.");
+        }
+        LOTTO_INSTRUMENT(UIntType selection_start_cycle = read_cycle_counter());
         EventIDType selected_event_id;
         double accumulated_time_step = 0;
         double total_rate = rate_upper_bound * event_id_list.size();
-        // This could loop forever, but I don't think it makes sense to impose a limit or ask the user to do so
-        // TODO: Make note in documentation about this
-        // TODO: Give warning after a certain number of iterations (every N iterations)
+        UIntType n_rejections = 0;
         while (true)
         {
+            LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
             accumulated_time_step += this->calculate_time_step(total_rate);
             EventIDType candidate_event_id = event_id_list[this->random_generator.sample_integer_range(event_id_list.size() - 1)];
+            double acceptance_value = this->random_generator.sample_unit_interval();
+            LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+
+            LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
             double rate = this->calculate_rate(candidate_event_id);
+            LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
             assert(rate <= rate_upper_bound); // rate cannot exceed upper bound
-            if (rate / rate_upper_bound >= this->random_generator.sample_unit_interval())
+            ++statistics.n_attempts;
+            if (rate / rate_upper_bound >= acceptance_value)
             {
                 selected_event_id = candidate_event_id;
                 break;
             }
+            ++n_rejections;
+            if (rejection_limit != 0 && n_rejections % rejection_limit == 0)
+            {
+                handle_rejection_limit(n_rejections);
+            }
         }
+        ++statistics.n_acceptances;
+        statistics.max_attempts_per_selection = std::max(statistics.max_attempts_per_selection, n_rejections + 1);
+        LOTTO_INSTRUMENT(instrumentation.selection.add_call(selection_start_cycle));
         return std::make_pair(selected_event_id, accumulated_time_step);
     }
 
+    // Adds a new event to the list of candidates, which must not already be present
+    void add_event(const EventIDType& event_id)
+    {
+        build_event_to_list_index();
+        if (!event_to_list_index.emplace(event_id, event_id_list.size()).second)
+        {
+            throw std::runtime_error("Event ID is already present.");
+        }
+        event_id_list.push_back(event_id);
+        return;
+    }
+
+    // Removes an event from the list of candidates, by swapping it with the last event
+    void remove_event(const EventIDType& event_id)
+    {
+        build_event_to_list_index();
+        auto removed_it = event_to_list_index.find(event_id);
+        if (removed_it == event_to_list_index.end())
+        {
+            throw std::runtime_error("Event ID is not present.");
+        }
+        std::size_t removed_ix = removed_it->second;
+        event_to_list_index.erase(removed_it);
+        if (removed_ix != event_id_list.size() - 1)
+        {
+            event_id_list[removed_ix] = event_id_list.back();
+            event_to_list_index[event_id_list[removed_ix]] = removed_ix;
+        }
+        event_id_list.pop_back();
+        return;
+    }
+
+    // Returns true if an event is currently a candidate for selection
+    bool contains_event(const EventIDType& event_id) const
+    {
+        build_event_to_list_index();
+        return event_to_list_index.find(event_id) != event_to_list_index.end();
+    }
+
+    // Returns the number of events that are currently candidates for selection
+    std::size_t n_events() const { return event_id_list.size(); }
+
+    // Returns the attempt and acceptance counters accumulated since construction (or the last reset)
+    const RejectionStatistics& get_statistics() const { return statistics; }
+
+    // Resets the attempt and acceptance counters
+    void reset_statistics() { statistics = RejectionStatistics(); }
+
+    // Returns the time spent in each phase of selection since construction (or the last reset), which is only
+    // recorded if LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp)
+    const SelectorInstrumentation& get_instrumentation() const { return instrumentation; }
+
+    // Resets the instrumentation statistics
+    void reset_instrumentation() { instrumentation = SelectorInstrumentation(); }
+
+    // Sets a limit on the number of consecutive rejections within a single selection.
+    // Each time the limit is reached (and every multiple of it thereafter), the callback is invoked
+    // with the number of consecutive rejections so far. If no callback is given, an exception is thrown instead.
+    // A limit of zero disables the guard.
+    void set_rejection_limit(UIntType max_consecutive_rejections,
+                             const std::function<void(UIntType)>& callback = nullptr)
+    {
+        rejection_limit = max_consecutive_rejections;
+        rejection_limit_callback = callback;
+        return;
+    }
+
+    // Write the selector's state to a binary snapshot: the random number generator, the runner state, the current
+    // candidate events, and the statistics. The rate calculator, rate upper bound and rejection limit are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "REJECT__");
+        this->random_generator.save_state(stream);
+        this->save_runner_state(stream);
+        write_snapshot_vector(stream, event_id_list);
+        write_snapshot_value(stream, statistics.n_attempts);
+        write_snapshot_value(stream, statistics.n_acceptances);
+        write_snapshot_value(stream, statistics.max_attempts_per_selection);
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, including events added or removed since
+    // construction
+    void load_state(std::istream& stream)
+    {
+        // The whole snapshot is read before any state is restored, so a snapshot that fails to load has no effect
+        check_snapshot_tag(stream, "REJECT__");
+        RandomGenerator loaded_generator = this->random_generator;
+        loaded_generator.load_state(stream);
+        auto loaded_runner_state = this->read_runner_state(stream);
+        std::vector<EventIDType> loaded_event_id_list = read_snapshot_vector<EventIDType>(stream);
+        if (loaded_event_id_list.empty())
+        {
+            throw std::runtime_error("Event ID list must not be empty.");
+        }
+        RejectionStatistics loaded_statistics;
+        loaded_statistics.n_attempts = read_snapshot_value<UIntType>(stream);
+        loaded_statistics.n_acceptances = read_snapshot_value<UIntType>(stream);
+        loaded_statistics.max_attempts_per_selection = read_snapshot_value<UIntType>(stream);
+
+        this->random_generator = loaded_generator;
+        this->restore_runner_state(loaded_runner_state);
+        event_id_list = std::move(loaded_event_id_list);
+        event_to_list_index.clear();
+        statistics = loaded_statistics;
+        return;
+    }
+
 private:
     // Upper bound on event rates
     const double rate_upper_bound;
 
-    // List of IDs of all possible events
-    const std::vector<EventIDType> event_id_list;
+    // List of IDs of all possible events, in no particular order
+    std::vector<EventIDType> event_id_list;
+
+    // Given an event ID, get the corresponding index into the event ID list
+    // Only built once events are added, removed or looked up, so that selectors with a fixed list do not pay for it
+    mutable std::unordered_map<EventIDType, std::size_t> event_to_list_index;
+
+    // Attempt and acceptance counters
+    RejectionStatistics statistics;
+
+    // Time spent in each phase of selection, if instrumentation is enabled
+    SelectorInstrumentation instrumentation;
+
+    // Number of consecutive rejections after which the callback is invoked (zero for no limit)
+    UIntType rejection_limit;
+
+    // Function to call when the rejection limit is reached, throws if empty
+    std::function<void(UIntType)> rejection_limit_callback;
+
+    // Generate the list index map for all events, if it has not been built yet,
+    // throwing (and leaving it unbuilt) if any event ID appears more than once
+    void build_event_to_list_index() const
+    {
+        if (!event_to_list_index.empty() || event_id_list.empty())
+        {
+            return;
+        }
+        event_to_list_index.reserve(event_id_list.size());
+        for (std::size_t list_ix = 0; list_ix < event_id_list.size(); ++list_ix)
+        {
+            if (!event_to_list_index.emplace(event_id_list[list_ix], list_ix).second)
+            {
+                event_to_list_index.clear();
+                throw std::runtime_error("Event IDs must be unique.");
+            }
+        }
+        return;
+    }
+
+    // Either notify the callback or throw, once the rejection limit has been reached
+    void handle_rejection_limit(UIntType n_rejections) const
+    {
+        if (!rejection_limit_callback)
+        {
+            throw std::runtime_error("Exceeded limit on consecutive rejections, rates may be too small.");
+        }
+        rejection_limit_callback(n_rejections);
+        return;
+    }
 
     // Friend for testing
     friend class ::RejectionEventSelectorTest;
 };
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
 } // namespace lotto
 #endif
@@ -1,108 +1,605 @@
 #ifndef REJECTION_FREE_H
 #define REJECTION_FREE_H
 
+#include "concurrent_event_rate_tree.hpp"
 #include "event_rate_tree.hpp"
 #include "event_rate_tree_impl.hpp"
 #include "event_selector.hpp"
+#include "impact_provider.hpp"
+#include "instrumentation.hpp"
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
 #include <cassert>
+#include <cmath>
+#include <istream>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
+#include <ostream>
+#include <set>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 class RejectionFreeEventSelectorTest;
 
 namespace lotto
 {
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+
+/*
+ * Events selected together over a single time leap
+ */
+template <typename EventIDType>
+struct EventLeap
+{
+    // Distinct events selected, each with the number of times it occurs, ordered by event ID
+    std::vector<std::pair<EventIDType, UIntType>> event_counts;
+
+    // Pairs of selected events where the first impacts the rate of the second,
+    // including an event paired with itself if it occurs more than once and impacts its own rate
+    std::vector<std::pair<EventIDType, EventIDType>> conflicts;
+
+    // Length of the leap, which may be shorter than requested
+    double time_step = 0.0;
+};
 
 /*
  * Event selector implemented using rejection-free KMC algorithm
+ *
+ * Impacted events are given by an impact provider (see impact_provider.hpp), by default a lookup table
+ *
+ * Rates are stored in an EventRateTree by default. With a ConcurrentEventRateTree (see concurrent_event_rate_tree.hpp)
+ * instead, the rates of impacted events are both calculated and applied to the tree on the worker threads, if
+ * enabled with set_n_threads, so that tree updates are no longer made one at a time on the calling thread.
  */
-template <typename EventIDType, typename RateCalculatorType>
-class RejectionFreeEventSelector : public EventSelectorBase<EventIDType, RateCalculatorType>
+template <typename EventIDType,
+          typename RateCalculatorType,
+          typename ImpactProviderType = MapImpactProvider<EventIDType>,
+          typename EventRateTreeType = EventRateTree<EventIDType>>
+class RejectionFreeEventSelector
+    : public EventSelectorBase<EventIDType, RateCalculatorType>,
+      public EventSelectorRunner<
+          RejectionFreeEventSelector<EventIDType, RateCalculatorType, ImpactProviderType, EventRateTreeType>,
+          EventIDType>
 {
 public:
+    // Lookup table from each event to the events whose rates it impacts
+    using ImpactTable = typename MapImpactProvider<EventIDType>::ImpactTable;
+
     // Construct given a rate calculator, event ID list, and impact table
     RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
                                const std::vector<EventIDType>& event_id_list,
-                               const std::map<EventIDType, std::vector<EventIDType>>& impact_table)
+                               const ImpactTable& impact_table)
+        : RejectionFreeEventSelector(rate_calculator_ptr, event_id_list, std::make_shared<const ImpactTable>(impact_table))
+    {
+    }
+
+    // Construct given a rate calculator, event ID list, and an impact table that is moved into the selector,
+    // rather than copied
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               ImpactTable&& impact_table)
+        : RejectionFreeEventSelector(rate_calculator_ptr,
+                                     event_id_list,
+                                     std::make_shared<const ImpactTable>(std::move(impact_table)))
+    {
+    }
+
+    // Construct given a rate calculator, event ID list, and an impact table that may be shared with other selectors
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               const std::shared_ptr<const ImpactTable>& impact_table_ptr)
+        : RejectionFreeEventSelector(rate_calculator_ptr, event_id_list, ImpactProviderType(impact_table_ptr))
+    {
+    }
+
+    // Construct given a rate calculator, event ID list, and impact provider
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               const ImpactProviderType& impact_provider)
+        : RejectionFreeEventSelector(rate_calculator_ptr, event_id_list.begin(), event_id_list.end(), impact_provider)
+    {
+    }
+
+    // Construct given a rate calculator, a range of event IDs, and impact provider
+    // The range may be any forward iterators (e.g. pointers into an event catalog, see catalog.hpp), and the tree is
+    // built from it directly, calculating each rate once, so no copies of the events or their rates are made
+    template <typename EventIDIterType>
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               EventIDIterType event_ids_begin,
+                               EventIDIterType event_ids_end,
+                               const ImpactProviderType& impact_provider)
         : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
-          event_rate_tree(event_id_list, this->calculate_rates(event_id_list)),
-          impact_table(fill_impact_table(impact_table, event_id_list)),
-          impacted_events_ptr(nullptr)
+          event_rate_tree(validated_event_ids_begin(event_ids_begin, event_ids_end),
+                          event_ids_end,
+                          CalculatedRateIterator<EventIDIterType>(this, event_ids_begin)),
+          impact_provider(impact_provider),
+          use_pending_impacted_events(false),
+          max_leap_size(std::numeric_limits<double>::infinity())
+    {
+    }
+
+    // Construct given a rate calculator, a range of event IDs, impact provider, and the event index of another
+    // selector built from the same event IDs in the same order (see event_index), which is shared rather than rebuilt
+    // (unless it is null)
+    template <typename EventIDIterType>
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               EventIDIterType event_ids_begin,
+                               EventIDIterType event_ids_end,
+                               const ImpactProviderType& impact_provider,
+                               const std::shared_ptr<const std::map<EventIDType, Index>>& shared_event_index)
+        : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
+          event_rate_tree(validated_event_ids_begin(event_ids_begin, event_ids_end),
+                          event_ids_end,
+                          CalculatedRateIterator<EventIDIterType>(this, event_ids_begin),
+                          shared_event_index),
+          impact_provider(impact_provider),
+          use_pending_impacted_events(false),
+          max_leap_size(std::numeric_limits<double>::infinity())
+    {
+    }
+
+    // Construct given a rate calculator, event ID list, the initial rates of those events, and impact provider,
+    // e.g. rates stored in an event catalog (see catalog.hpp), so that no rates are calculated on construction
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               const std::vector<double>& initial_rates,
+                               const ImpactProviderType& impact_provider)
+        : RejectionFreeEventSelector(rate_calculator_ptr,
+                                     event_id_list.begin(),
+                                     event_id_list.end(),
+                                     initial_rates.begin(),
+                                     initial_rates.end(),
+                                     impact_provider)
+    {
+    }
+
+    // Construct given a rate calculator, a range of event IDs, a range of their initial rates, and impact provider
+    // Both ranges may be any forward iterators, and no rates are calculated on construction
+    template <typename EventIDIterType, typename RateIterType>
+    RejectionFreeEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               EventIDIterType event_ids_begin,
+                               EventIDIterType event_ids_end,
+                               RateIterType initial_rates_begin,
+                               RateIterType initial_rates_end,
+                               const ImpactProviderType& impact_provider)
+        : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
+          event_rate_tree(event_ids_begin,
+                          event_ids_end,
+                          validated_initial_rates_begin(
+                              event_ids_begin, event_ids_end, initial_rates_begin, initial_rates_end)),
+          impact_provider(impact_provider),
+          use_pending_impacted_events(false),
+          max_leap_size(std::numeric_limits<double>::infinity())
     {
-        if (event_id_list.empty())
-        {
-            throw std::runtime_error("Event ID list must not be empty.");
-        }
     }
 
     // Select an event and return its ID and the time step
-    std::pair<EventIDType, double> select_event()
+    std::pair<EventIDType, double> select_event() final
     {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+
         // Because this function only selects events and does not process them,
         // it cannot update any rates impacted by the selected event until the next call.
+        std::pair<EventIDType, double> event_and_time = select();
+        commit(event_and_time.first);
+        LOTTO_INSTRUMENT(instrumentation.selection.add_call(start_cycle));
+        return event_and_time;
+    }
+
+    // Select an event and return its ID and the time step, without assuming it will be carried out
+    // Rates impacted by all events committed since the last selection are updated first
+    std::pair<EventIDType, double> select()
+    {
         update_impacted_event_rates();
 
         // Rates should now be updated. Calculate total rate and time step
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
         double total_rate = event_rate_tree.total_rate();
         double time_step = this->calculate_time_step(total_rate);
+        double query_value = total_rate * this->random_generator.sample_unit_interval();
+        LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
 
         // Query tree to select event
-        double query_value = total_rate * this->random_generator.sample_unit_interval();
+        LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
         EventIDType selected_event_id = event_rate_tree.query_tree(query_value);
-
-        // Update impacted event list and return
-        set_impacted_events(selected_event_id);
+        LOTTO_INSTRUMENT(instrumentation.tree_query.add_call(start_cycle));
+        LOTTO_INSTRUMENT(instrumentation.n_tree_nodes_touched += event_rate_tree.path_length());
         return std::make_pair(selected_event_id, time_step);
     }
 
+    // Report that a selected event has been carried out, so that the rates it impacts are updated on the next
+    // selection. Several events may be committed before then, in which case their impacted events are merged,
+    // and each impacted rate is only updated once.
+    void commit(const EventIDType& event_id)
+    {
+        stash_impacted_events();
+        add_impacted_events(impact_provider.impacted_events(event_id));
+        return;
+    }
+
+    // Report that a selected event will not be carried out. Selection leaves no state behind that needs to be dropped,
+    // so rejecting an event only means not committing it: no rates are updated on its account. Calling this is
+    // optional, and documents the decision at the call site.
+    void reject([[maybe_unused]] const EventIDType& event_id) { return; }
+
+    // Select all events that occur over a time leap of length tau, approximating every rate as constant
+    // over the leap (tau-leaping). The number of events is drawn from the Poisson distribution with mean
+    // total_rate * tau, and each is selected in proportion to its rate. If that mean exceeds the leap size
+    // limit, the leap is shortened to match. Selected events whose rates impact each other are reported as
+    // conflicts, since carrying them all out is only a good approximation if such conflicts are rare.
+    // All selected events are committed, so rates impacted by any of them are updated on the next selection.
+    EventLeap<EventIDType> select_events_leap(double tau)
+    {
+        if (!(tau > 0.0 && std::isfinite(tau)))
+        {
+            throw std::runtime_error("Leap time must be positive and finite.");
+        }
+        update_impacted_event_rates();
+
+        EventLeap<EventIDType> leap;
+        double total_rate = event_rate_tree.total_rate();
+        leap.time_step = tau;
+        if (total_rate * tau > max_leap_size)
+        {
+            leap.time_step = max_leap_size / total_rate;
+        }
+
+        // Draw and aggregate events
+        std::map<EventIDType, UIntType> event_count_map;
+        UIntType n_events = this->random_generator.sample_poisson(total_rate * leap.time_step);
+        for (UIntType event_ix = 0; event_ix < n_events; ++event_ix)
+        {
+            double query_value = total_rate * this->random_generator.sample_unit_interval();
+            ++event_count_map[event_rate_tree.query_tree(query_value)];
+        }
+        leap.event_counts.assign(event_count_map.begin(), event_count_map.end());
+
+        // Find conflicts and commit all events
+        for (const auto& event_and_count : leap.event_counts)
+        {
+            stash_impacted_events();
+            ImpactedEvents<EventIDType> impacted_events_of_event =
+                impact_provider.impacted_events(event_and_count.first);
+            add_impacted_events(impacted_events_of_event);
+            for (const EventIDType& impacted_event_id : impacted_events_of_event)
+            {
+                auto count_it = event_count_map.find(impacted_event_id);
+                if (count_it != event_count_map.end() &&
+                    (impacted_event_id != event_and_count.first || event_and_count.second > 1))
+                {
+                    leap.conflicts.emplace_back(event_and_count.first, impacted_event_id);
+                }
+            }
+        }
+        return leap;
+    }
+
+    // Limit the expected number of events in a single leap, by shortening leaps that would exceed it
+    void set_max_leap_size(double max_expected_events)
+    {
+        if (max_expected_events <= 0.0)
+        {
+            throw std::runtime_error("Leap size limit must be positive.");
+        }
+        max_leap_size = max_expected_events;
+        return;
+    }
+
+    // Returns the sum of all stored rates, which does not yet include updates due to the last selection
+    double total_rate() const { return event_rate_tree.total_rate(); }
+
+    // Returns the index from each event ID to its leaf in the tree, which is read-only, so that selectors built from
+    // the same event IDs in the same order can share it
+    const std::shared_ptr<const std::map<EventIDType, Index>>& event_index() const
+    {
+        return event_rate_tree.event_index();
+    }
+
+    // Returns the statistics recorded since construction (or the last reset), which are only recorded if
+    // LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp)
+    const SelectorInstrumentation& get_instrumentation() const { return instrumentation; }
+
+    // Resets the instrumentation statistics
+    void reset_instrumentation() { instrumentation = SelectorInstrumentation(); }
+
+    // Recalculate the rates of the given events, for changes to the rate calculator that the impact table does not
+    // capture. Any pending updates from the last selection are applied first.
+    void recalculate_rates(const std::vector<EventIDType>& event_ids)
+    {
+        update_impacted_event_rates();
+        for (const EventIDType& event_id : event_ids)
+        {
+            update_tree_rate(event_id, calculate_rate_instrumented(event_id));
+        }
+        return;
+    }
+
+    // Calculate the rates of impacted events in parallel, on a pool of the given number of worker threads.
+    // Tree updates are applied in order on the calling thread, unless the selector's tree is a ConcurrentEventRateTree,
+    // in which case the workers apply them. Either way, the sums are the same once all updates are applied, so
+    // selection is unaffected.
+    // The rate calculator must be safe to call concurrently (a CachedRateCalculator is not). Use zero or one thread
+    // to calculate serially.
+    void set_n_threads(std::size_t n_threads)
+    {
+        if (n_threads <= 1)
+        {
+            thread_pool_ptr.reset();
+        }
+        else
+        {
+            thread_pool_ptr = std::make_unique<ThreadPool>(n_threads);
+        }
+        return;
+    }
+
+    // Write the selector's state to a binary snapshot: the random number generator, the runner state, the stored
+    // rates, and the events impacted by committed events whose rates have not yet been updated. The rate calculator,
+    // impact provider and settings are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "REJFREE_");
+        this->random_generator.save_state(stream);
+        this->save_runner_state(stream);
+        event_rate_tree.save_state(stream);
+        ImpactedEvents<EventIDType> impacted_events = current_impacted_events();
+        write_snapshot_vector(stream, std::vector<EventIDType>(impacted_events.begin(), impacted_events.end()));
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // events. No rates are calculated, and if the rate calculator is in the same state as when the snapshot was
+    // saved, selection continues exactly as it would have. To avoid calculating rates on construction as well,
+    // construct the selector with initial rates (which are overwritten, so may be all zero).
+    void load_state(std::istream& stream)
+    {
+        // The whole snapshot is read before any state is restored, so a snapshot that fails to load has no effect
+        check_snapshot_tag(stream, "REJFREE_");
+        RandomGenerator loaded_generator = this->random_generator;
+        loaded_generator.load_state(stream);
+        auto loaded_runner_state = this->read_runner_state(stream);
+        std::vector<double> loaded_rates = event_rate_tree.read_state(stream);
+        std::vector<EventIDType> loaded_impacted_events = read_snapshot_vector<EventIDType>(stream);
+
+        this->random_generator = loaded_generator;
+        this->restore_runner_state(loaded_runner_state);
+        event_rate_tree.restore_state(loaded_rates);
+        pending_impacted_events = std::move(loaded_impacted_events);
+        pending_impacted_event_set.clear();
+        pending_impacted_event_set.insert(pending_impacted_events.begin(), pending_impacted_events.end());
+        unapplied_impacted_events = ImpactedEvents<EventIDType>();
+        use_pending_impacted_events = !pending_impacted_events.empty();
+        return;
+    }
+
 private:
     // Tree storing event IDs and their corresponding rates
-    EventRateTree<EventIDType> event_rate_tree;
+    EventRateTreeType event_rate_tree;
+
+    // Provider indicating, for a given event that is accepted, which events' rates are impacted
+    ImpactProviderType impact_provider;
+
+    // Impacted events of the only event committed since the last selection, whose rates have not been updated
+    // Refers to storage of the impact provider, and is only used if the pending impacted events are not
+    ImpactedEvents<EventIDType> unapplied_impacted_events;
+
+    // True if more than one event has been committed since the last selection, so that their impacted events
+    // have been merged into the pending impacted events
+    bool use_pending_impacted_events;
+
+    // Events impacted by all events committed since the last selection, without duplicates
+    std::vector<EventIDType> pending_impacted_events;
+    std::set<EventIDType> pending_impacted_event_set;
+
+    // Largest expected number of events in a single leap
+    double max_leap_size;
+
+    // Worker threads for calculating impacted rates, if enabled
+    std::unique_ptr<ThreadPool> thread_pool_ptr;
+
+    // Newly calculated rates of impacted events (negative if no update is needed), when calculating in parallel
+    std::vector<double> impacted_event_rates;
+
+    // Time spent in each phase of selection, if instrumentation is enabled
+    SelectorInstrumentation instrumentation;
+
+    // Iterator over the rates of a range of events, calculating each rate only when dereferenced,
+    // so that the tree can be built without an intermediate list of rates
+    template <typename EventIDIterType>
+    class CalculatedRateIterator
+    {
+    public:
+        CalculatedRateIterator(const RejectionFreeEventSelector* selector_ptr, EventIDIterType event_id_it)
+            : selector_ptr(selector_ptr), event_id_it(event_id_it)
+        {
+        }
+
+        double operator*() const { return selector_ptr->calculate_rate(*event_id_it); }
+
+        CalculatedRateIterator& operator++()
+        {
+            ++event_id_it;
+            return *this;
+        }
+
+    private:
+        const RejectionFreeEventSelector* selector_ptr;
+        EventIDIterType event_id_it;
+    };
+
+    // Returns the start of a range of event IDs, after checking that it is not empty
+    template <typename EventIDIterType>
+    static EventIDIterType validated_event_ids_begin(EventIDIterType event_ids_begin, EventIDIterType event_ids_end)
+    {
+        if (event_ids_begin == event_ids_end)
+        {
+            throw std::runtime_error("Event ID list must not be empty.");
+        }
+        return event_ids_begin;
+    }
 
-    // Lookup table indicating, for a given event that is accepted, which events' rates are impacted
-    const std::map<EventIDType, std::vector<EventIDType>> impact_table;
+    // Returns the start of a range of initial rates, after checking that it matches the range of event IDs
+    template <typename EventIDIterType, typename RateIterType>
+    static RateIterType validated_initial_rates_begin(EventIDIterType event_ids_begin,
+                                                      EventIDIterType event_ids_end,
+                                                      RateIterType initial_rates_begin,
+                                                      RateIterType initial_rates_end)
+    {
+        validated_event_ids_begin(event_ids_begin, event_ids_end);
+        if (std::distance(initial_rates_begin, initial_rates_end) != std::distance(event_ids_begin, event_ids_end))
+        {
+            throw std::runtime_error("Number of initial rates must match number of events.");
+        }
+        return initial_rates_begin;
+    }
 
-    // Pointer to vector of impacted events whose rates have not been updated
-    mutable const std::vector<EventIDType>* impacted_events_ptr;
+    // Move the impacted events of a single committed event into the pending impacted events,
+    // before calling the impact provider again, since it may reuse the storage they are held in
+    void stash_impacted_events()
+    {
+        if (!use_pending_impacted_events && !unapplied_impacted_events.empty())
+        {
+            add_pending_impacted_events(unapplied_impacted_events);
+            unapplied_impacted_events = ImpactedEvents<EventIDType>();
+            use_pending_impacted_events = true;
+        }
+        return;
+    }
 
-    // Set the impact events pointer based on an accepted event ID
-    void set_impacted_events(const EventIDType& accepted_event_id)
+    // Record the impacted events of a committed event, without copying them if no other events are pending
+    void add_impacted_events(const ImpactedEvents<EventIDType>& impacted_events_of_event)
     {
-        assert(impacted_events_ptr == nullptr); // pointer should be null before proceeding
-        impacted_events_ptr = &impact_table.at(accepted_event_id);
+        if (impacted_events_of_event.empty())
+        {
+            return;
+        }
+        if (!use_pending_impacted_events && unapplied_impacted_events.empty())
+        {
+            unapplied_impacted_events = impacted_events_of_event;
+            return;
+        }
+        add_pending_impacted_events(impacted_events_of_event);
+        use_pending_impacted_events = true;
         return;
     }
 
-    // Update the stored rates for impacted events
+    // Returns the impacted events whose rates have not been updated
+    ImpactedEvents<EventIDType> current_impacted_events() const
+    {
+        return use_pending_impacted_events ? ImpactedEvents<EventIDType>(pending_impacted_events)
+                                           : unapplied_impacted_events;
+    }
+
+    // Add events to the pending impacted events, skipping any already present
+    void add_pending_impacted_events(const ImpactedEvents<EventIDType>& impacted_events)
+    {
+        for (const EventIDType& event_id : impacted_events)
+        {
+            if (pending_impacted_event_set.insert(event_id).second)
+            {
+                pending_impacted_events.push_back(event_id);
+            }
+        }
+        return;
+    }
+
+    // Update the stored rates for impacted events, skipping any the rate calculator reports as unchanged
     void update_impacted_event_rates()
     {
-        if (impacted_events_ptr != nullptr)
+        ImpactedEvents<EventIDType> impacted_events = current_impacted_events();
+        if (!impacted_events.empty())
         {
-            for (const EventIDType& event_id : *impacted_events_ptr)
+            LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+            LOTTO_INSTRUMENT(instrumentation.n_impacted_events += impacted_events.size());
+            if (thread_pool_ptr != nullptr && impacted_events.size() > 1)
+            {
+                update_impacted_event_rates_in_parallel(impacted_events);
+            }
+            else
             {
-                event_rate_tree.update_rate(event_id, this->calculate_rate(event_id));
+                for (const EventIDType& event_id : impacted_events)
+                {
+                    if (this->is_rate_update_needed(event_id))
+                    {
+                        update_tree_rate(event_id, calculate_rate_instrumented(event_id));
+                    }
+                }
             }
-            impacted_events_ptr = nullptr;
+            LOTTO_INSTRUMENT(instrumentation.impact_update.add_call(start_cycle));
+            unapplied_impacted_events = ImpactedEvents<EventIDType>();
+            use_pending_impacted_events = false;
+            pending_impacted_events.clear();
+            pending_impacted_event_set.clear();
         }
         return;
     }
 
-    // Add missing event IDs to an impact table (with empty vectors as values) and return it
-    std::map<EventIDType, std::vector<EventIDType>> fill_impact_table(std::map<EventIDType, std::vector<EventIDType>> table_to_fill,
-                                                                      std::vector<EventIDType> event_id_list)
+    // Calculate the rates for impacted events on the worker threads, then update the tree with all of them
+    void update_impacted_event_rates_in_parallel(const ImpactedEvents<EventIDType>& impacted_events)
     {
-        for (const EventIDType& event_id : event_id_list)
+        // Calculations on the worker threads are timed together, as a single call
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        if constexpr (std::is_same<EventRateTreeType, ConcurrentEventRateTree<EventIDType>>::value)
         {
-            table_to_fill[event_id];
+            // The tree takes updates from several threads at once, so the workers also apply the rates they calculate,
+            // and every update is complete once the loop returns. Tree updates are counted with the calculations.
+            thread_pool_ptr->parallel_for(impacted_events.size(), [&](std::size_t impacted_ix) {
+                const EventIDType& event_id = impacted_events[impacted_ix];
+                if (this->is_rate_update_needed(event_id))
+                {
+                    event_rate_tree.update_rate(event_id, this->calculate_rate(event_id));
+                }
+            });
+            LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
         }
-        return table_to_fill;
+        else
+        {
+            impacted_event_rates.resize(impacted_events.size());
+            thread_pool_ptr->parallel_for(impacted_events.size(), [&](std::size_t impacted_ix) {
+                const EventIDType& event_id = impacted_events[impacted_ix];
+                impacted_event_rates[impacted_ix] =
+                    this->is_rate_update_needed(event_id) ? this->calculate_rate(event_id) : -1.0;
+            });
+            LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
+            for (std::size_t impacted_ix = 0; impacted_ix < impacted_events.size(); ++impacted_ix)
+            {
+                if (impacted_event_rates[impacted_ix] >= 0.0)
+                {
+                    update_tree_rate(impacted_events[impacted_ix], impacted_event_rates[impacted_ix]);
+                }
+            }
+        }
+        return;
+    }
+
+    // Returns the rate given an event ID, timing the calculation if instrumentation is enabled
+    double calculate_rate_instrumented(const EventIDType& event_id)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        double rate = this->calculate_rate(event_id);
+        LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
+        return rate;
+    }
+
+    // Update the rate of an event in the tree, timing the update if instrumentation is enabled
+    void update_tree_rate(const EventIDType& event_id, double new_rate)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        [[maybe_unused]] bool is_rate_changed = event_rate_tree.update_rate(event_id, new_rate);
+        LOTTO_INSTRUMENT(instrumentation.tree_update.add_call(start_cycle));
+        LOTTO_INSTRUMENT(instrumentation.n_tree_nodes_touched += is_rate_changed ? event_rate_tree.path_length() : 0);
+        return;
     }
 
     // Friend for testing
     friend class ::RejectionFreeEventSelectorTest;
 };
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
 } // namespace lotto
 
 #endif
@@ -0,0 +1,109 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "event_selector.hpp"
+#include "random.hpp"
+#include "trajectory.hpp"
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace lotto
+{
+/*
+ * Event selector that replays a trajectory recorded by a trajectory recorder (see trajectory.hpp), streaming it from
+ * the file, so that a run can be analysed again without calculating any rates
+ *
+ * Optionally, the replay can be checked against a rate calculator reflecting the state of the replayed system:
+ * every given number of selections, the rate of the replayed event is calculated, and if it is zero, the event could
+ * not have occurred, meaning the replayed system has diverged from the recorded one.
+ */
+template <typename EventIDType>
+class ReplayEventSelector : public EventSelectorRunner<ReplayEventSelector<EventIDType>, EventIDType>
+{
+public:
+    // Construct given the path of a trajectory file
+    explicit ReplayEventSelector(const std::string& file_path)
+        : reader(file_path), n_selections(0), verification_interval(0)
+    {
+        read_next_event();
+    }
+
+    // Return the ID and time step of the next recorded event, throwing if the trajectory has ended
+    std::pair<EventIDType, double> select_event()
+    {
+        if (!has_next_event)
+        {
+            throw std::runtime_error("Cannot select an event, trajectory has ended.");
+        }
+        std::pair<EventIDType, double> event_and_time = next_event_and_time;
+        ++n_selections;
+        if (verification_interval != 0 && n_selections % verification_interval == 0)
+        {
+            verify_event(event_and_time.first);
+        }
+        read_next_event();
+        return event_and_time;
+    }
+
+    // Returns true if events remain to be replayed
+    bool has_events_left() const { return has_next_event; }
+
+    // Returns the number of events replayed so far
+    UIntType get_n_selections() const { return n_selections; }
+
+    // Check every given number of selections that the replayed event has a positive rate according to the rate
+    // calculator, throwing if not. The calculator is only called for these checks. Use an interval of zero to stop.
+    template <typename RateCalculatorType>
+    void set_verification(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr, UIntType interval)
+    {
+        if (interval != 0 && rate_calculator_ptr == nullptr)
+        {
+            throw std::runtime_error("Rate calculator must not be null.");
+        }
+        verification_interval = interval;
+        calculate_rate = [rate_calculator_ptr](const EventIDType& event_id) {
+            return rate_calculator_ptr->calculate_rate(event_id);
+        };
+        return;
+    }
+
+private:
+    // Reader streaming the trajectory
+    TrajectoryReader<EventIDType> reader;
+
+    // Next recorded event, read ahead so that the end of the trajectory is known
+    std::pair<EventIDType, double> next_event_and_time;
+    bool has_next_event;
+
+    // Number of events replayed so far
+    UIntType n_selections;
+
+    // Number of selections between checks against the rate calculator (zero for none)
+    UIntType verification_interval;
+
+    // Rate calculator used for checks
+    std::function<double(const EventIDType&)> calculate_rate;
+
+    // Read the next recorded event, if any
+    void read_next_event()
+    {
+        has_next_event = reader.read_event(next_event_and_time.first, next_event_and_time.second);
+        return;
+    }
+
+    // Throw if the replayed event has zero rate
+    void verify_event(const EventIDType& event_id) const
+    {
+        if (!(calculate_rate(event_id) > 0.0))
+        {
+            throw std::runtime_error("Replay has diverged from the recorded trajectory at selection " +
+                                     std::to_string(n_selections) + ", replayed event has zero rate.");
+        }
+        return;
+    }
+};
+} // namespace lotto
+#endif
@@ -0,0 +1,100 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace lotto
+{
+/*
+ * Helpers for binary snapshots of selector state, as written by save_state and read by load_state
+ *
+ * Values are written in native byte order, so snapshots are only meant to be read back on the same kind of
+ * machine, by a program built with the same event ID type. Each part of a snapshot starts with a tag naming
+ * the type that wrote it, so that mismatched snapshots are detected.
+ */
+
+// Write a trivially copyable value
+template <typename ValueType>
+void write_snapshot_value(std::ostream& stream, const ValueType& value)
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value, "Snapshot values must be trivially copyable.");
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(ValueType));
+    return;
+}
+
+// Read a trivially copyable value, throwing if the stream ends first
+template <typename ValueType>
+ValueType read_snapshot_value(std::istream& stream)
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value, "Snapshot values must be trivially copyable.");
+    ValueType value;
+    if (!stream.read(reinterpret_cast<char*>(&value), sizeof(ValueType)))
+    {
+        throw std::runtime_error("Snapshot is truncated.");
+    }
+    return value;
+}
+
+// Write a vector of trivially copyable values, preceded by its size
+template <typename ValueType>
+void write_snapshot_vector(std::ostream& stream, const std::vector<ValueType>& values)
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value, "Snapshot values must be trivially copyable.");
+    write_snapshot_value<std::uint64_t>(stream, values.size());
+    stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(ValueType));
+    return;
+}
+
+// Read a vector of trivially copyable values written by write_snapshot_vector
+// The stored size is not trusted: values are read in bounded chunks, so a corrupt size makes the read fail once
+// the stream ends, rather than allocating memory for values that are not there
+template <typename ValueType>
+std::vector<ValueType> read_snapshot_vector(std::istream& stream)
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value, "Snapshot values must be trivially copyable.");
+    constexpr std::uint64_t chunk_size = 1 << 16;
+    std::uint64_t n_values = read_snapshot_value<std::uint64_t>(stream);
+    std::vector<ValueType> values;
+    while (values.size() < n_values)
+    {
+        std::size_t n_read = values.size();
+        values.resize(n_read + std::min(chunk_size, n_values - n_read));
+        if (!stream.read(reinterpret_cast<char*>(values.data() + n_read), (values.size() - n_read) * sizeof(ValueType)))
+        {
+            throw std::runtime_error("Snapshot is truncated.");
+        }
+    }
+    return values;
+}
+
+// Write the tag naming the type whose state follows, which must have eight characters
+inline void write_snapshot_tag(std::ostream& stream, const char* tag)
+{
+    stream.write(tag, 8);
+    return;
+}
+
+// Read a tag, throwing unless it matches the given one
+inline void check_snapshot_tag(std::istream& stream, const char* tag)
+{
+    char read_tag[8];
+    if (!stream.read(read_tag, 8))
+    {
+        throw std::runtime_error("Snapshot is truncated.");
+    }
+    if (std::memcmp(read_tag, tag, 8) != 0)
+    {
+        throw std::runtime_error("Snapshot was not written by " + std::string(tag, 8) + ".");
+    }
+    return;
+}
+} // namespace lotto
+#endif
@@ -0,0 +1,353 @@
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include "event_rate_tree.hpp"
+#include "event_rate_tree_impl.hpp"
+#include "event_selector.hpp"
+#include "instrumentation.hpp"
+#include <cassert>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+class SplitEventSelectorTest;
+
+namespace lotto
+{
+inline namespace LOTTO_INSTRUMENTATION_NAMESPACE
+{
+/*
+ * Group of events that share a selection algorithm within a split event selector
+ */
+template <typename EventIDType>
+struct EventFamily
+{
+    // IDs of the events in this family
+    std::vector<EventIDType> event_ids;
+
+    // If positive, events in this family are selected by rejection against this upper bound on their rates,
+    // otherwise their rates are stored in a tree and they are selected without rejection
+    double rate_upper_bound = 0.0;
+};
+
+/*
+ * Event selector that splits events into families, each with its own selection algorithm and data structures
+ *
+ * A family is first chosen in proportion to its weight, then an event is chosen within it. The weight of a
+ * tree family is its total rate, and its events are always accepted. The weight of a rejection family is its
+ * upper bound times its number of events, and a candidate event is only accepted with probability equal to its
+ * rate over the upper bound. If rejected, no event occurs, time still advances, and the family choice is repeated.
+ *
+ * Updating the rates of impacted events only touches the tree of the family each event belongs to, and events
+ * in rejection families need no updates at all. So for example a family of fast events with uniform rates can use
+ * rejection, and its frequent updates never touch the tree holding a family of slow events with diverse rates.
+ */
+template <typename EventIDType, typename RateCalculatorType>
+class SplitEventSelector
+    : public EventSelectorBase<EventIDType, RateCalculatorType>,
+      public EventSelectorRunner<SplitEventSelector<EventIDType, RateCalculatorType>, EventIDType>
+{
+public:
+    // Lookup table from each event to the events whose rates it impacts
+    using ImpactTable = std::map<EventIDType, std::vector<EventIDType>>;
+
+    // Construct given a rate calculator, families of events, and impact table
+    SplitEventSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                       const std::vector<EventFamily<EventIDType>>& event_families,
+                       const ImpactTable& impact_table)
+        : EventSelectorBase<EventIDType, RateCalculatorType>(rate_calculator_ptr),
+          impact_table(impact_table),
+          impacted_events_ptr(nullptr)
+    {
+        if (event_families.empty())
+        {
+            throw std::runtime_error("Event family list must not be empty.");
+        }
+        families.reserve(event_families.size());
+        for (const EventFamily<EventIDType>& event_family : event_families)
+        {
+            if (event_family.event_ids.empty())
+            {
+                throw std::runtime_error("Event families must not be empty.");
+            }
+            for (const EventIDType& event_id : event_family.event_ids)
+            {
+                if (!event_to_family_index.emplace(event_id, families.size()).second)
+                {
+                    throw std::runtime_error("Event IDs must be unique across all families.");
+                }
+            }
+            families.emplace_back();
+            Family& family = families.back();
+            family.rate_upper_bound = event_family.rate_upper_bound;
+            if (family.is_rejection())
+            {
+                family.event_ids = event_family.event_ids;
+            }
+            else
+            {
+                family.event_rate_tree_ptr = std::make_unique<EventRateTree<EventIDType>>(
+                    event_family.event_ids, this->calculate_rates(event_family.event_ids));
+            }
+        }
+    }
+
+    // Select an event and return its ID and the time step, which includes any time spent on rejected attempts
+    std::pair<EventIDType, double> select_event() final
+    {
+        LOTTO_INSTRUMENT(UIntType selection_start_cycle = read_cycle_counter());
+
+        // Because this function only selects events and does not process them,
+        // it cannot update any rates impacted by the selected event until the next call.
+        update_impacted_event_rates();
+
+        double accumulated_time_step = 0.0;
+        while (true)
+        {
+            double total_weight = 0.0;
+            for (const Family& family : families)
+            {
+                total_weight += family.weight();
+            }
+            LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+            accumulated_time_step += this->calculate_time_step(total_weight);
+            double family_query_value = total_weight * this->random_generator.sample_unit_interval();
+            LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+
+            const Family& family = select_family(family_query_value);
+            if (!family.is_rejection())
+            {
+                const EventRateTree<EventIDType>& tree = *family.event_rate_tree_ptr;
+                LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
+                double query_value = tree.total_rate() * this->random_generator.sample_unit_interval();
+                LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+                LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
+                const EventIDType& selected_event_id = tree.query_tree(query_value);
+                LOTTO_INSTRUMENT(instrumentation.tree_query.add_call(start_cycle));
+                LOTTO_INSTRUMENT(instrumentation.n_tree_nodes_touched += tree.path_length());
+                set_impacted_events(selected_event_id);
+                LOTTO_INSTRUMENT(instrumentation.selection.add_call(selection_start_cycle));
+                return std::make_pair(selected_event_id, accumulated_time_step);
+            }
+
+            LOTTO_INSTRUMENT(start_cycle = read_cycle_counter());
+            const EventIDType& candidate_event_id =
+                family.event_ids[this->random_generator.sample_integer_range(family.event_ids.size() - 1)];
+            double acceptance_value = this->random_generator.sample_unit_interval();
+            LOTTO_INSTRUMENT(instrumentation.random_sampling.add_call(start_cycle));
+            double rate = calculate_rate_instrumented(candidate_event_id);
+            assert(rate <= family.rate_upper_bound); // rate cannot exceed upper bound
+            if (rate / family.rate_upper_bound >= acceptance_value)
+            {
+                set_impacted_events(candidate_event_id);
+                LOTTO_INSTRUMENT(instrumentation.selection.add_call(selection_start_cycle));
+                return std::make_pair(candidate_event_id, accumulated_time_step);
+            }
+        }
+    }
+
+    // Returns the number of families
+    std::size_t n_families() const { return families.size(); }
+
+    // Returns the weight with which a family is currently chosen, not yet including updates due to the last selection
+    double family_weight(std::size_t family_ix) const { return families.at(family_ix).weight(); }
+
+    // Returns the number of calls to, and cycles spent in, each phase of selection, which are only recorded if
+    // LOTTO_ENABLE_INSTRUMENTATION is defined (see instrumentation.hpp). Rate calculations include those of candidate
+    // events in rejection families, and tree updates and queries those of the trees of all tree families.
+    const SelectorInstrumentation& get_instrumentation() const { return instrumentation; }
+
+    // Resets the instrumentation statistics
+    void reset_instrumentation() { instrumentation = SelectorInstrumentation(); }
+
+    // Write the selector's state to a binary snapshot: the random number generator, the runner state, the rates
+    // stored for tree families, and the events impacted by the last selection whose rates have not yet been updated.
+    // The rate calculator, families and impact table are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "SPLIT___");
+        this->random_generator.save_state(stream);
+        this->save_runner_state(stream);
+        write_snapshot_value<std::uint64_t>(stream, families.size());
+        for (const Family& family : families)
+        {
+            if (!family.is_rejection())
+            {
+                family.event_rate_tree_ptr->save_state(stream);
+            }
+        }
+        write_snapshot_vector(stream,
+                              impacted_events_ptr == nullptr ? std::vector<EventIDType>() : *impacted_events_ptr);
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // families. No rates are calculated, so selection continues exactly as it would have if the rate calculator is
+    // in the same state as when the snapshot was saved.
+    void load_state(std::istream& stream)
+    {
+        // The whole snapshot is read and checked before any state is restored
+        check_snapshot_tag(stream, "SPLIT___");
+        RandomGenerator loaded_generator = this->random_generator;
+        loaded_generator.load_state(stream);
+        auto loaded_runner_state = this->read_runner_state(stream);
+        if (read_snapshot_value<std::uint64_t>(stream) != families.size())
+        {
+            throw std::runtime_error("Snapshot does not match the number of families.");
+        }
+        std::vector<std::vector<double>> loaded_family_rates(families.size());
+        for (std::size_t family_ix = 0; family_ix < families.size(); ++family_ix)
+        {
+            if (!families[family_ix].is_rejection())
+            {
+                loaded_family_rates[family_ix] = families[family_ix].event_rate_tree_ptr->read_state(stream);
+            }
+        }
+        std::vector<EventIDType> loaded_impacted_events = read_snapshot_vector<EventIDType>(stream);
+        for (const EventIDType& event_id : loaded_impacted_events)
+        {
+            if (event_to_family_index.find(event_id) == event_to_family_index.end())
+            {
+                throw std::runtime_error("Snapshot does not match the selector's events.");
+            }
+        }
+
+        this->random_generator = loaded_generator;
+        this->restore_runner_state(loaded_runner_state);
+        for (std::size_t family_ix = 0; family_ix < families.size(); ++family_ix)
+        {
+            if (!families[family_ix].is_rejection())
+            {
+                families[family_ix].event_rate_tree_ptr->restore_state(loaded_family_rates[family_ix]);
+            }
+        }
+        restored_impacted_events = std::move(loaded_impacted_events);
+        impacted_events_ptr = restored_impacted_events.empty() ? nullptr : &restored_impacted_events;
+        return;
+    }
+
+private:
+    // Events of one family, and the data structures used to select them
+    struct Family
+    {
+        // Upper bound on rates if selected by rejection, otherwise zero
+        double rate_upper_bound = 0.0;
+
+        // Event IDs, for rejection families only
+        std::vector<EventIDType> event_ids;
+
+        // Tree of event rates, for tree families only
+        std::unique_ptr<EventRateTree<EventIDType>> event_rate_tree_ptr;
+
+        bool is_rejection() const { return rate_upper_bound > 0.0; }
+
+        double weight() const
+        {
+            return is_rejection() ? rate_upper_bound * event_ids.size() : event_rate_tree_ptr->total_rate();
+        }
+    };
+
+    // All families, in the order given
+    std::vector<Family> families;
+
+    // Given an event ID, get the index of its family
+    std::map<EventIDType, std::size_t> event_to_family_index;
+
+    // Lookup table indicating, for a given event that is accepted, which events' rates are impacted
+    const ImpactTable impact_table;
+
+    // Pointer to vector of impacted events whose rates have not been updated
+    const std::vector<EventIDType>* impacted_events_ptr;
+
+    // Impacted events restored from a snapshot, pointed to until their rates are updated
+    std::vector<EventIDType> restored_impacted_events;
+
+    // Time spent in each phase of selection, if instrumentation is enabled
+    SelectorInstrumentation instrumentation;
+
+    // Returns the family for which the cumulative weight of families up to and including it first reaches the query
+    const Family& select_family(double query_value) const
+    {
+        for (const Family& family : families)
+        {
+            double weight = family.weight();
+            if (weight > 0.0 && query_value <= weight)
+            {
+                return family;
+            }
+            query_value -= weight;
+        }
+        // Only reached if rounding leaves the query value slightly above the total weight
+        for (auto family_it = families.rbegin(); family_it != families.rend(); ++family_it)
+        {
+            if (family_it->weight() > 0.0)
+            {
+                return *family_it;
+            }
+        }
+        assert(false); // at least one family must have positive weight
+        return families.back();
+    }
+
+    // Set the impact events pointer based on an accepted event ID
+    void set_impacted_events(const EventIDType& accepted_event_id)
+    {
+        assert(impacted_events_ptr == nullptr); // pointer should be null before proceeding
+        auto impact_it = impact_table.find(accepted_event_id);
+        if (impact_it != impact_table.end())
+        {
+            impacted_events_ptr = &impact_it->second;
+        }
+        return;
+    }
+
+    // Update the stored rates for impacted events in tree families, skipping any the rate calculator reports as unchanged
+    void update_impacted_event_rates()
+    {
+        if (impacted_events_ptr != nullptr)
+        {
+            LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+            LOTTO_INSTRUMENT(instrumentation.n_impacted_events += impacted_events_ptr->size());
+            for (const EventIDType& event_id : *impacted_events_ptr)
+            {
+                Family& family = families[event_to_family_index.at(event_id)];
+                if (!family.is_rejection() && this->is_rate_update_needed(event_id))
+                {
+                    update_tree_rate(*family.event_rate_tree_ptr, event_id, calculate_rate_instrumented(event_id));
+                }
+            }
+            impacted_events_ptr = nullptr;
+            LOTTO_INSTRUMENT(instrumentation.impact_update.add_call(start_cycle));
+        }
+        return;
+    }
+
+    // Returns the rate given an event ID, timing the calculation if instrumentation is enabled
+    double calculate_rate_instrumented(const EventIDType& event_id)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        double rate = this->calculate_rate(event_id);
+        LOTTO_INSTRUMENT(instrumentation.rate_calculation.add_call(start_cycle));
+        return rate;
+    }
+
+    // Update the rate of an event in the tree of its family, timing the update if instrumentation is enabled
+    void update_tree_rate(EventRateTree<EventIDType>& tree, const EventIDType& event_id, double new_rate)
+    {
+        LOTTO_INSTRUMENT(UIntType start_cycle = read_cycle_counter());
+        [[maybe_unused]] bool is_rate_changed = tree.update_rate(event_id, new_rate);
+        LOTTO_INSTRUMENT(instrumentation.tree_update.add_call(start_cycle));
+        LOTTO_INSTRUMENT(instrumentation.n_tree_nodes_touched += is_rate_changed ? tree.path_length() : 0);
+        return;
+    }
+
+    // Friend for testing
+    friend class ::SplitEventSelectorTest;
+};
+} // namespace LOTTO_INSTRUMENTATION_NAMESPACE
+} // namespace lotto
+#endif
@@ -0,0 +1,447 @@
+#ifndef SUBLATTICE_PARALLEL_H
+#define SUBLATTICE_PARALLEL_H
+
+#include "event_rate_tree.hpp"
+#include "event_selector.hpp"
+#include "event_rate_tree_impl.hpp"
+#include "impact_provider.hpp"
+#include "random.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class SublatticeParallelSelectorTest;
+
+namespace lotto
+{
+/*
+ * Location of an event for parallel selection: the spatial domain that owns it,
+ * and the sublattice it belongs to within that domain
+ */
+struct SublatticeLocation
+{
+    Index domain;
+    Index sublattice;
+};
+
+/*
+ * Event selector implemented using the synchronous sublattice algorithm for parallel KMC
+ *
+ * Events are partitioned into spatial domains, each of which is further divided into sublattices
+ * (the same number of sublattices in every domain). Each domain has its own rate trees and random
+ * number generator, and is advanced by its own thread. In each cycle, one sublattice is chosen at random
+ * and every domain carries out rejection-free KMC among its events on that sublattice only, until its
+ * local time exceeds the cycle time. Sublattices should be chosen so that events carried out simultaneously
+ * in different domains cannot interact, i.e. active regions of neighboring domains are separated by more
+ * than the range of the impact table.
+ *
+ * Impacted events owned by the same domain are updated immediately. Impacted events owned by other domains
+ * are collected and updated at the end of the cycle, once all domains have finished, by the thread of the
+ * owning domain. An event impacted from several domains is updated only once.
+ *
+ * The rate calculator must be safe to call concurrently for events in different domains,
+ * as must the function used to carry out events. Impacted events are looked up through an impact provider
+ * (see impact_provider.hpp), of which every domain holds its own copy, so that providers generating impacted events
+ * into a buffer can be used; providers sharing their table (or catalog) make these copies cheap.
+ *
+ * The generator of every domain is seeded from the generator choosing sublattices, so a single seed determines the
+ * whole run. Until reseed_generator is called, that seed is taken from std::random_device.
+ *
+ * Event IDs must be hashable with std::hash, which indexes the location of every event.
+ */
+template <typename EventIDType,
+          typename RateCalculatorType,
+          typename ImpactProviderType = MapImpactProvider<EventIDType>>
+class SublatticeParallelSelector
+{
+public:
+    // Lookup table from each event to the events whose rates it impacts
+    using ImpactTable = typename MapImpactProvider<EventIDType>::ImpactTable;
+
+    // Lookup table from each event to its domain and sublattice
+    using LocationMap = std::map<EventIDType, SublatticeLocation>;
+
+    // Construct given a rate calculator, event ID list, impact table, the location of every event, and the number
+    // of threads
+    SublatticeParallelSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               const ImpactTable& impact_table,
+                               const LocationMap& location_map,
+                               std::size_t n_threads)
+        : SublatticeParallelSelector(rate_calculator_ptr,
+                                     event_id_list,
+                                     std::make_shared<const ImpactTable>(impact_table),
+                                     std::make_shared<const LocationMap>(location_map),
+                                     n_threads)
+    {
+    }
+
+    // Construct given a rate calculator, event ID list, and an impact table and locations that may be shared with
+    // other selectors, rather than copied
+    SublatticeParallelSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               const std::shared_ptr<const ImpactTable>& impact_table_ptr,
+                               const std::shared_ptr<const LocationMap>& location_map_ptr,
+                               std::size_t n_threads)
+        : SublatticeParallelSelector(
+              rate_calculator_ptr, event_id_list, ImpactProviderType(impact_table_ptr), location_map_ptr, n_threads)
+    {
+    }
+
+    // Construct given a rate calculator, event ID list, impact provider, locations that may be shared with other
+    // selectors, and the number of threads
+    SublatticeParallelSelector(const std::shared_ptr<RateCalculatorType>& rate_calculator_ptr,
+                               const std::vector<EventIDType>& event_id_list,
+                               const ImpactProviderType& impact_provider,
+                               const std::shared_ptr<const LocationMap>& location_map_ptr,
+                               std::size_t n_threads)
+        : rate_calculator_ptr(rate_calculator_ptr),
+          location_map_ptr(location_map_ptr),
+          thread_pool(n_threads),
+          n_sublattices(0),
+          time(0.0),
+          last_active_sublattice(-1)
+    {
+        if (location_map_ptr == nullptr)
+        {
+            throw std::runtime_error("Location map must not be null.");
+        }
+        if (event_id_list.empty())
+        {
+            throw std::runtime_error("Event ID list must not be empty.");
+        }
+        initialize_domains(event_id_list, impact_provider);
+        reseed_domain_generators();
+    }
+
+    // Carry out one synchronous cycle of the given length. Every selected event is passed to apply_event,
+    // which is called from the worker threads and must carry out the event in the simulation.
+    // Returns the number of events carried out during the cycle.
+    template <typename ApplyEventFunctionType>
+    UIntType run_cycle(double cycle_time, const ApplyEventFunctionType& apply_event)
+    {
+        assert(cycle_time > 0.0); // cycle time must be positive
+        Index active_sublattice = generator.sample_integer_range(n_sublattices - 1);
+        thread_pool.parallel_for(domains.size(), [&](std::size_t domain_ix) {
+            run_domain_cycle(domain_ix, active_sublattice, cycle_time, apply_event);
+        });
+
+        // Exchange impacts across domain boundaries now that no domain is running
+        thread_pool.parallel_for(domains.size(),
+                                 [&](std::size_t domain_ix) { update_boundary_impacted_events(domain_ix); });
+        UIntType n_events = 0;
+        for (const Domain& domain : domains)
+        {
+            n_events += domain.n_events_in_cycle;
+        }
+        time += cycle_time;
+        last_active_sublattice = active_sublattice;
+        return n_events;
+    }
+
+    // Returns the simulated time, accumulated over all cycles
+    double get_time() const { return time; }
+
+    // Returns the sublattice that was active during the most recent cycle
+    Index get_last_active_sublattice() const { return last_active_sublattice; }
+
+    // Returns the number of domains
+    std::size_t n_domains() const { return domains.size(); }
+
+    // Reseeds the generator used to choose sublattices, and derives new seeds for every domain from it
+    void reseed_generator(UIntType new_seed)
+    {
+        generator.reseed_generator(new_seed);
+        reseed_domain_generators();
+        return;
+    }
+
+    // Write the selector's state to a binary snapshot, between cycles: the generator choosing sublattices, the time,
+    // and the generator and rates of every domain. The rate calculator, impact table and locations are not included.
+    void save_state(std::ostream& stream) const
+    {
+        write_snapshot_tag(stream, "SUBLATT_");
+        generator.save_state(stream);
+        write_snapshot_value(stream, time);
+        write_snapshot_value(stream, last_active_sublattice);
+        write_snapshot_value<std::uint64_t>(stream, domains.size());
+        for (const Domain& domain : domains)
+        {
+            domain.generator.save_state(stream);
+            for (const auto& tree_ptr : domain.sublattice_trees)
+            {
+                if (tree_ptr != nullptr)
+                {
+                    tree_ptr->save_state(stream);
+                }
+            }
+        }
+        return;
+    }
+
+    // Restore the selector's state from a snapshot written by save_state, for a selector constructed with the same
+    // events and locations. No rates are calculated.
+    void load_state(std::istream& stream)
+    {
+        // The whole snapshot is read before any state is restored
+        check_snapshot_tag(stream, "SUBLATT_");
+        RandomGenerator loaded_generator = generator;
+        loaded_generator.load_state(stream);
+        double loaded_time = read_snapshot_value<double>(stream);
+        Index loaded_last_active_sublattice = read_snapshot_value<Index>(stream);
+        if (read_snapshot_value<std::uint64_t>(stream) != domains.size())
+        {
+            throw std::runtime_error("Snapshot does not match the number of domains.");
+        }
+        std::vector<RandomGenerator> loaded_domain_generators;
+        std::vector<std::vector<std::vector<double>>> loaded_domain_rates(domains.size());
+        for (std::size_t domain_ix = 0; domain_ix < domains.size(); ++domain_ix)
+        {
+            const Domain& domain = domains[domain_ix];
+            loaded_domain_generators.push_back(domain.generator);
+            loaded_domain_generators.back().load_state(stream);
+            loaded_domain_rates[domain_ix].resize(domain.sublattice_trees.size());
+            for (std::size_t sublattice_ix = 0; sublattice_ix < domain.sublattice_trees.size(); ++sublattice_ix)
+            {
+                if (domain.sublattice_trees[sublattice_ix] != nullptr)
+                {
+                    loaded_domain_rates[domain_ix][sublattice_ix] =
+                        domain.sublattice_trees[sublattice_ix]->read_state(stream);
+                }
+            }
+        }
+
+        generator = loaded_generator;
+        time = loaded_time;
+        last_active_sublattice = loaded_last_active_sublattice;
+        for (std::size_t domain_ix = 0; domain_ix < domains.size(); ++domain_ix)
+        {
+            Domain& domain = domains[domain_ix];
+            domain.generator = loaded_domain_generators[domain_ix];
+            for (std::size_t sublattice_ix = 0; sublattice_ix < domain.sublattice_trees.size(); ++sublattice_ix)
+            {
+                EventRateTree<EventIDType>* tree_ptr = domain.sublattice_trees[sublattice_ix].get();
+                if (tree_ptr != nullptr)
+                {
+                    tree_ptr->restore_state(loaded_domain_rates[domain_ix][sublattice_ix]);
+                }
+            }
+        }
+        return;
+    }
+
+private:
+    // Events, rates, and random number generator owned by a single domain
+    struct Domain
+    {
+        explicit Domain(const ImpactProviderType& impact_provider) : impact_provider(impact_provider) {}
+
+        // Rate tree for each sublattice, null if the domain has no events on that sublattice
+        std::vector<std::unique_ptr<EventRateTree<EventIDType>>> sublattice_trees;
+
+        // Generator for selecting events in this domain
+        RandomGenerator generator;
+
+        // Copy of the impact provider used by this domain's thread
+        ImpactProviderType impact_provider;
+
+        // Events impacted during the current cycle that are owned by other domains, with their sublattice,
+        // indexed by owning domain
+        std::vector<std::vector<std::pair<EventIDType, Index>>> boundary_impacted_events;
+
+        // Number of events carried out during the current cycle
+        UIntType n_events_in_cycle = 0;
+    };
+
+    // Pointer to rate calculator
+    const std::shared_ptr<RateCalculatorType> rate_calculator_ptr;
+
+    // Domain and sublattice of every event, which may be shared with other selectors
+    const std::shared_ptr<const LocationMap> location_map_ptr;
+
+    // All domains, indexed by domain index
+    std::vector<Domain> domains;
+
+    // Worker threads, domains are always advanced by the same thread
+    ThreadPool thread_pool;
+
+    // Number of sublattices in every domain
+    Index n_sublattices;
+
+    // Generator for choosing the active sublattice
+    RandomGenerator generator;
+
+    // Simulated time
+    double time;
+
+    // Sublattice chosen in the most recent cycle
+    Index last_active_sublattice;
+
+    // Domain and sublattice of every event, indexed for constant time lookup of impacted events
+    std::unordered_map<EventIDType, SublatticeLocation> event_locations;
+
+    // Returns the rate given an event ID
+    double calculate_rate(const EventIDType& event_id) const
+    {
+        return calculate_checked_rate(*rate_calculator_ptr, event_id);
+    }
+
+    // Seed the generator of every domain from the generator choosing sublattices
+    void reseed_domain_generators()
+    {
+        for (Domain& domain : domains)
+        {
+            domain.generator.reseed_generator(generator.sample_integer_range(std::numeric_limits<UIntType>::max()));
+        }
+        return;
+    }
+
+    // Recalculate the rate of an event and store it in the tree of the domain and sublattice that own it
+    void update_rate(const EventIDType& event_id, const SublatticeLocation& location)
+    {
+        domains[location.domain].sublattice_trees[location.sublattice]->update_rate(event_id, calculate_rate(event_id));
+        return;
+    }
+
+    // Advance a single domain through one cycle, on its active sublattice
+    template <typename ApplyEventFunctionType>
+    void run_domain_cycle(Index domain_ix,
+                          Index active_sublattice,
+                          double cycle_time,
+                          const ApplyEventFunctionType& apply_event)
+    {
+        Domain& domain = domains[domain_ix];
+        domain.n_events_in_cycle = 0;
+        EventRateTree<EventIDType>* tree_ptr = domain.sublattice_trees[active_sublattice].get();
+        if (tree_ptr == nullptr)
+        {
+            return;
+        }
+
+        double local_time = 0.0;
+        while (true)
+        {
+            double total_rate = tree_ptr->total_rate();
+            if (total_rate <= 0.0)
+            {
+                break;
+            }
+            local_time += -std::log(domain.generator.sample_unit_interval()) / total_rate;
+            if (local_time > cycle_time)
+            {
+                break;
+            }
+            const EventIDType& selected_event_id =
+                tree_ptr->query_tree(total_rate * domain.generator.sample_unit_interval());
+            apply_event(selected_event_id);
+            ++domain.n_events_in_cycle;
+
+            for (const EventIDType& impacted_event_id : domain.impact_provider.impacted_events(selected_event_id))
+            {
+                const SublatticeLocation& location = event_locations.at(impacted_event_id);
+                if (location.domain == domain_ix)
+                {
+                    update_rate(impacted_event_id, location);
+                }
+                else
+                {
+                    domain.boundary_impacted_events[location.domain].emplace_back(impacted_event_id,
+                                                                                  location.sublattice);
+                }
+            }
+        }
+        return;
+    }
+
+    // Update the events owned by a single domain that other domains impacted during the cycle, each only once
+    void update_boundary_impacted_events(Index domain_ix)
+    {
+        std::vector<std::pair<EventIDType, Index>> impacted_events;
+        for (Domain& impacting_domain : domains)
+        {
+            std::vector<std::pair<EventIDType, Index>>& domain_impacted_events =
+                impacting_domain.boundary_impacted_events[domain_ix];
+            impacted_events.insert(impacted_events.end(), domain_impacted_events.begin(), domain_impacted_events.end());
+            domain_impacted_events.clear();
+        }
+        std::sort(impacted_events.begin(), impacted_events.end());
+        impacted_events.erase(std::unique(impacted_events.begin(), impacted_events.end()), impacted_events.end());
+        for (const auto& [event_id, sublattice] : impacted_events)
+        {
+            update_rate(event_id, {domain_ix, sublattice});
+        }
+        return;
+    }
+
+    // Sort events into domains and sublattices, and construct a rate tree for each
+    void initialize_domains(const std::vector<EventIDType>& event_id_list, const ImpactProviderType& impact_provider)
+    {
+        Index n_domains = 0;
+        event_locations.reserve(event_id_list.size());
+        for (const EventIDType& event_id : event_id_list)
+        {
+            auto location_it = location_map_ptr->find(event_id);
+            if (location_it == location_map_ptr->end())
+            {
+                throw std::runtime_error("Every event must be assigned a domain and sublattice.");
+            }
+            const SublatticeLocation& location = location_it->second;
+            if (location.domain < 0 || location.sublattice < 0)
+            {
+                throw std::runtime_error("Domain and sublattice indices must be non-negative.");
+            }
+            n_domains = std::max(n_domains, location.domain + 1);
+            n_sublattices = std::max(n_sublattices, location.sublattice + 1);
+            event_locations.emplace(event_id, location);
+        }
+
+        std::vector<std::vector<std::vector<EventIDType>>> event_ids_by_location(
+            n_domains, std::vector<std::vector<EventIDType>>(n_sublattices));
+        for (const EventIDType& event_id : event_id_list)
+        {
+            const SublatticeLocation& location = event_locations.at(event_id);
+            event_ids_by_location[location.domain][location.sublattice].push_back(event_id);
+        }
+
+        domains.reserve(n_domains);
+        for (Index domain_ix = 0; domain_ix < n_domains; ++domain_ix)
+        {
+            domains.emplace_back(impact_provider);
+            domains[domain_ix].sublattice_trees.resize(n_sublattices);
+            domains[domain_ix].boundary_impacted_events.resize(n_domains);
+            for (Index sublattice_ix = 0; sublattice_ix < n_sublattices; ++sublattice_ix)
+            {
+                const std::vector<EventIDType>& event_ids = event_ids_by_location[domain_ix][sublattice_ix];
+                if (event_ids.empty())
+                {
+                    continue;
+                }
+                std::vector<double> rates;
+                rates.reserve(event_ids.size());
+                for (const EventIDType& event_id : event_ids)
+                {
+                    rates.push_back(calculate_rate(event_id));
+                }
+                domains[domain_ix].sublattice_trees[sublattice_ix] =
+                    std::make_unique<EventRateTree<EventIDType>>(event_ids, rates);
+            }
+        }
+        return;
+    }
+
+    // Friend for testing
+    friend class ::SublatticeParallelSelectorTest;
+};
+} // namespace lotto
+#endif
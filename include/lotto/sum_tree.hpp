@@ -80,6 +80,9 @@ public:
     /// Change values of a leaf and resum the tree
     void update(int leaf_idx, const NodeType& val);
 
+    /// Resum every node above the leaves, level by level, after the values of many leaves have been changed
+    void resum();
+
     /// Change updates values of a leaf and resum the tree
     // void update_internals(int leaf_idx);
 private:
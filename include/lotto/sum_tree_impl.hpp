@@ -88,6 +88,32 @@ void InvertedBinarySumTree<NodeType>::update(int leaf_idx, const NodeType& val)
   }
 */
 
+template <typename NodeType>
+void InvertedBinarySumTree<NodeType>::resum()
+{
+    // Siblings are adjacent within each level, so every parent appears in a single run of consecutive nodes
+    std::vector<Node*> current_level;
+    current_level.reserve(m_leaves.size());
+    for (const auto& leaf_ptr : m_leaves)
+    {
+        current_level.push_back(leaf_ptr.get());
+    }
+    while (current_level.size() > 1)
+    {
+        std::vector<Node*> parent_level;
+        parent_level.reserve(current_level.size() / 2 + 1);
+        for (Node* node_ptr : current_level)
+        {
+            if (parent_level.empty() || parent_level.back() != node_ptr->parent.get())
+            {
+                parent_level.push_back(_resum_parent(node_ptr));
+            }
+        }
+        current_level = std::move(parent_level);
+    }
+    return;
+}
+
 template <typename NodeType>
 void InvertedBinarySumTree<NodeType>::_resum_to_top(int leaf_idx)
 {
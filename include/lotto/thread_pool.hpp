@@ -0,0 +1,198 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lotto
+{
+/*
+ * Fixed-size pool of worker threads for running loops in parallel
+ *
+ * Loop indices are assigned to workers statically (index i always runs on worker i % size()),
+ * so that repeated loops over the same range touch the same data from the same threads.
+ * Workers may optionally be pinned to CPUs, in which case memory they allocate and touch first is
+ * placed on their local NUMA node by the operating system, and stays local as long as the same
+ * indices keep running on the same workers.
+ */
+class ThreadPool
+{
+public:
+    // Construct with a given number of worker threads, optionally pinning each one to a different CPU
+    // (cycling through the CPUs available to the process). Pinning is only supported on Linux, and is
+    // silently skipped elsewhere.
+    explicit ThreadPool(std::size_t n_threads, bool pin_threads = false)
+        : current_task(nullptr), n_tasks(0), generation(0), n_busy_workers(0), is_stopping(false)
+    {
+        if (n_threads == 0)
+        {
+            throw std::runtime_error("Thread pool must have at least one thread.");
+        }
+        workers.reserve(n_threads);
+        for (std::size_t worker_ix = 0; worker_ix < n_threads; ++worker_ix)
+        {
+            workers.emplace_back(&ThreadPool::work, this, worker_ix);
+        }
+        if (pin_threads)
+        {
+            pin_workers();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Stops and joins all worker threads
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_stopping = true;
+        }
+        start_condition.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    // Returns the number of worker threads
+    std::size_t size() const { return workers.size(); }
+
+    // Calls task(i) for every i in [0, n_tasks) across the workers, and blocks until all calls have returned
+    // If any call throws, the first exception caught is rethrown here once all workers are done
+    void parallel_for(std::size_t n_tasks, const std::function<void(std::size_t)>& task)
+    {
+        if (n_tasks == 0)
+        {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        current_task = &task;
+        this->n_tasks = n_tasks;
+        n_busy_workers = workers.size();
+        first_exception = nullptr;
+        ++generation;
+        start_condition.notify_all();
+        finish_condition.wait(lock, [this] { return n_busy_workers == 0; });
+        current_task = nullptr;
+        if (first_exception)
+        {
+            std::rethrow_exception(first_exception);
+        }
+        return;
+    }
+
+private:
+    // Worker threads
+    std::vector<std::thread> workers;
+
+    // Guards all of the shared state below
+    std::mutex mutex;
+
+    // Signals workers that a new loop is available, or that the pool is stopping
+    std::condition_variable start_condition;
+
+    // Signals the caller that all workers have finished the current loop
+    std::condition_variable finish_condition;
+
+    // Loop body and range for the current loop
+    const std::function<void(std::size_t)>* current_task;
+    std::size_t n_tasks;
+
+    // Incremented for every loop, so that workers can tell a new loop from a spurious wakeup
+    std::size_t generation;
+
+    // Number of workers that have not yet finished the current loop
+    std::size_t n_busy_workers;
+
+    // Set when the pool is being destroyed
+    bool is_stopping;
+
+    // First exception thrown during the current loop, if any
+    std::exception_ptr first_exception;
+
+    // Pin each worker to one of the CPUs the process is allowed to run on
+    void pin_workers()
+    {
+#ifdef __linux__
+        cpu_set_t available_cpus;
+        if (sched_getaffinity(0, sizeof(available_cpus), &available_cpus) != 0)
+        {
+            return;
+        }
+        std::vector<int> cpu_ids;
+        for (int cpu_id = 0; cpu_id < CPU_SETSIZE; ++cpu_id)
+        {
+            if (CPU_ISSET(cpu_id, &available_cpus))
+            {
+                cpu_ids.push_back(cpu_id);
+            }
+        }
+        for (std::size_t worker_ix = 0; worker_ix < workers.size() && !cpu_ids.empty(); ++worker_ix)
+        {
+            cpu_set_t worker_cpu;
+            CPU_ZERO(&worker_cpu);
+            CPU_SET(cpu_ids[worker_ix % cpu_ids.size()], &worker_cpu);
+            pthread_setaffinity_np(workers[worker_ix].native_handle(), sizeof(worker_cpu), &worker_cpu);
+        }
+#endif
+        return;
+    }
+
+    // Worker thread main loop: wait for a loop, run its share of indices, report back
+    void work(std::size_t worker_ix)
+    {
+        std::size_t last_generation = 0;
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_condition.wait(lock, [&] { return is_stopping || generation != last_generation; });
+            if (is_stopping)
+            {
+                return;
+            }
+            last_generation = generation;
+            const std::function<void(std::size_t)>& task = *current_task;
+            std::size_t stride = workers.size();
+            std::size_t n_tasks = this->n_tasks;
+            lock.unlock();
+
+            std::exception_ptr exception;
+            try
+            {
+                for (std::size_t task_ix = worker_ix; task_ix < n_tasks; task_ix += stride)
+                {
+                    task(task_ix);
+                }
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            if (exception && !first_exception)
+            {
+                first_exception = exception;
+            }
+            if (--n_busy_workers == 0)
+            {
+                finish_condition.notify_one();
+            }
+        }
+    }
+};
+} // namespace lotto
+#endif
@@ -0,0 +1,471 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "event_selector.hpp"
+#include "random.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lotto
+{
+/*
+ * Binary file format for trajectories, i.e. the sequence of (event ID, time step) pairs returned by a selector
+ *
+ * All fixed-size values are stored in native byte order:
+ *     header       magic "LOTTOTRJ" (8 bytes), version (uint32_t), size in bytes of the event ID type (uint32_t)
+ *     chunks       any number of chunks, each consisting of
+ *                      number of records (uint64_t), number of bytes of record data (uint64_t), record data
+ *
+ * Record data holds, for each record, the difference between its event ID and that of the previous record in the
+ * chunk (or zero, for the first record) as a zigzag-encoded variable-length integer (7 bits per byte, least
+ * significant first, high bit set on all but the last byte), followed by the time step as a double. Since nearby
+ * events usually have nearby IDs, most records take one or two bytes plus the time step. Chunks can be decoded
+ * independently of each other.
+ *
+ * Event IDs must be integers of at most 64 bits.
+ */
+struct TrajectoryFormat
+{
+    static constexpr char magic[8] = {'L', 'O', 'T', 'T', 'O', 'T', 'R', 'J'};
+    static constexpr std::uint32_t version = 1;
+
+    // Smallest and largest number of bytes of record data per record (an event ID takes one to ten bytes)
+    static constexpr std::uint64_t min_record_size = 1 + sizeof(double);
+    static constexpr std::uint64_t max_record_size = 10 + sizeof(double);
+
+    // Append the encoding of the difference between two event IDs
+    template <typename EventIDType>
+    static void encode_event_id(std::vector<char>& data, EventIDType event_id, EventIDType previous_event_id)
+    {
+        std::uint64_t difference =
+            static_cast<std::uint64_t>(event_id) - static_cast<std::uint64_t>(previous_event_id);
+        std::uint64_t zigzag = (difference << 1) ^ (0 - (difference >> 63));
+        while (zigzag >= 0x80)
+        {
+            data.push_back(static_cast<char>((zigzag & 0x7f) | 0x80));
+            zigzag >>= 7;
+        }
+        data.push_back(static_cast<char>(zigzag));
+        return;
+    }
+
+    // Decode an event ID given the previous one, advancing the position past it, and throwing if data runs out
+    template <typename EventIDType>
+    static EventIDType decode_event_id(const std::vector<char>& data,
+                                       std::size_t& position,
+                                       EventIDType previous_event_id)
+    {
+        std::uint64_t zigzag = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            if (position == data.size() || shift > 63)
+            {
+                throw std::runtime_error("Trajectory file is corrupt.");
+            }
+            std::uint64_t byte = static_cast<unsigned char>(data[position++]);
+            zigzag |= (byte & 0x7f) << shift;
+            if (byte < 0x80)
+            {
+                break;
+            }
+        }
+        std::uint64_t difference = (zigzag >> 1) ^ (0 - (zigzag & 1));
+        return static_cast<EventIDType>(static_cast<std::uint64_t>(previous_event_id) + difference);
+    }
+};
+
+/*
+ * Writes trajectories to a file in the background, so that recording costs the stepping thread little more than
+ * encoding each record into memory
+ *
+ * Records are collected in one chunk while a background thread writes the previous one, so memory use is bounded by
+ * two chunks. Recording only waits for the writer if it falls a whole chunk behind, i.e. if the disk cannot keep up.
+ */
+template <typename EventIDType>
+class TrajectoryRecorder
+{
+public:
+    static_assert(std::is_integral<EventIDType>::value && sizeof(EventIDType) <= 8,
+                  "Trajectories can only be recorded for integer event IDs.");
+
+    // Create (or overwrite) a trajectory file, writing chunks of the given number of records
+    explicit TrajectoryRecorder(const std::string& file_path, std::size_t chunk_size = 65536)
+        : file(file_path, std::ios::binary | std::ios::trunc),
+          chunk_size(chunk_size),
+          n_records(0),
+          previous_event_id(0),
+          is_chunk_pending(false),
+          is_stopping(false),
+          has_write_failed(false)
+    {
+        if (!file)
+        {
+            throw std::runtime_error("Could not open trajectory file for writing: " + file_path);
+        }
+        if (chunk_size == 0)
+        {
+            throw std::runtime_error("Chunk size must be positive.");
+        }
+        std::uint32_t id_size = sizeof(EventIDType);
+        file.write(TrajectoryFormat::magic, sizeof(TrajectoryFormat::magic));
+        file.write(reinterpret_cast<const char*>(&TrajectoryFormat::version), sizeof(std::uint32_t));
+        file.write(reinterpret_cast<const char*>(&id_size), sizeof(std::uint32_t));
+        writer = std::thread(&TrajectoryRecorder::write_chunks, this);
+    }
+
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    // Writes any remaining records and stops the background thread
+    ~TrajectoryRecorder()
+    {
+        hand_off_active_chunk();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_stopping = true;
+        }
+        condition.notify_all();
+        writer.join();
+    }
+
+    // Record an event and its time step
+    void record(const EventIDType& event_id, double time_step)
+    {
+        TrajectoryFormat::encode_event_id(active_chunk.data, event_id, previous_event_id);
+        const char* time_step_bytes = reinterpret_cast<const char*>(&time_step);
+        active_chunk.data.insert(active_chunk.data.end(), time_step_bytes, time_step_bytes + sizeof(double));
+        previous_event_id = event_id;
+        ++active_chunk.n_records;
+        ++n_records;
+        if (active_chunk.n_records == chunk_size)
+        {
+            hand_off_active_chunk();
+        }
+        return;
+    }
+
+    // Write all records so far to the file, waiting until they are written, and throw if any write has failed
+    void flush()
+    {
+        hand_off_active_chunk();
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !is_chunk_pending; });
+        if (has_write_failed)
+        {
+            throw std::runtime_error("Could not write trajectory file.");
+        }
+        return;
+    }
+
+    // Returns the number of records so far
+    UIntType get_n_records() const { return n_records; }
+
+private:
+    // Records encoded in memory
+    struct Chunk
+    {
+        std::uint64_t n_records = 0;
+        std::vector<char> data;
+    };
+
+    // File being written, only accessed by the background thread after construction
+    std::ofstream file;
+
+    // Number of records per chunk
+    const std::size_t chunk_size;
+
+    // Number of records so far
+    UIntType n_records;
+
+    // Chunk being filled by the recording thread, and the ID of the last record in it
+    Chunk active_chunk;
+    EventIDType previous_event_id;
+
+    // Chunk handed to the background thread, owned by it while pending
+    Chunk pending_chunk;
+
+    // Background thread and its synchronization
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool is_chunk_pending;
+    bool is_stopping;
+    bool has_write_failed;
+
+    // Hand the active chunk to the background thread, once it has finished writing the previous one,
+    // and start a new chunk reusing the memory of the previous one
+    void hand_off_active_chunk()
+    {
+        if (active_chunk.n_records == 0)
+        {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return !is_chunk_pending; });
+            std::swap(active_chunk, pending_chunk);
+            is_chunk_pending = true;
+        }
+        condition.notify_all();
+        active_chunk.n_records = 0;
+        active_chunk.data.clear();
+        previous_event_id = 0;
+        return;
+    }
+
+    // Write chunks as they are handed off, until stopped
+    void write_chunks()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            condition.wait(lock, [this] { return is_chunk_pending || is_stopping; });
+            if (!is_chunk_pending)
+            {
+                return;
+            }
+            lock.unlock();
+            std::uint64_t n_bytes = pending_chunk.data.size();
+            file.write(reinterpret_cast<const char*>(&pending_chunk.n_records), sizeof(std::uint64_t));
+            file.write(reinterpret_cast<const char*>(&n_bytes), sizeof(std::uint64_t));
+            file.write(pending_chunk.data.data(), n_bytes);
+            file.flush();
+            bool is_written = file.good();
+            lock.lock();
+            has_write_failed = has_write_failed || !is_written;
+            is_chunk_pending = false;
+            condition.notify_all();
+        }
+    }
+};
+
+/*
+ * Reads a trajectory file written by a trajectory recorder, one chunk at a time
+ */
+template <typename EventIDType>
+class TrajectoryReader
+{
+public:
+    static_assert(std::is_integral<EventIDType>::value && sizeof(EventIDType) <= 8,
+                  "Trajectories can only be read for integer event IDs.");
+
+    // Open a trajectory file, throwing if it cannot be read or does not match the event ID type
+    explicit TrajectoryReader(const std::string& file_path)
+        : file(file_path, std::ios::binary),
+          chunk_position(0),
+          n_chunk_records_left(0),
+          previous_event_id(0),
+          file_size(0)
+    {
+        if (!file)
+        {
+            throw std::runtime_error("Could not open trajectory file: " + file_path);
+        }
+        file.seekg(0, std::ios::end);
+        file_size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        char magic[sizeof(TrajectoryFormat::magic)];
+        std::uint32_t version;
+        std::uint32_t id_size;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&version), sizeof(std::uint32_t));
+        file.read(reinterpret_cast<char*>(&id_size), sizeof(std::uint32_t));
+        if (!file || std::memcmp(magic, TrajectoryFormat::magic, sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("Not a trajectory file: " + file_path);
+        }
+        if (version != TrajectoryFormat::version)
+        {
+            throw std::runtime_error("Unsupported trajectory version: " + file_path);
+        }
+        if (id_size != sizeof(EventIDType))
+        {
+            throw std::runtime_error("Trajectory was written with a different event ID type: " + file_path);
+        }
+    }
+
+    // Read the next record into event_id and time_step, returning false if the trajectory has ended
+    bool read_event(EventIDType& event_id, double& time_step)
+    {
+        if (n_chunk_records_left == 0 && !read_chunk())
+        {
+            return false;
+        }
+        event_id = TrajectoryFormat::decode_event_id(chunk_data, chunk_position, previous_event_id);
+        if (chunk_data.size() - chunk_position < sizeof(double))
+        {
+            throw std::runtime_error("Trajectory file is corrupt.");
+        }
+        std::memcpy(&time_step, chunk_data.data() + chunk_position, sizeof(double));
+        chunk_position += sizeof(double);
+        previous_event_id = event_id;
+        --n_chunk_records_left;
+        return true;
+    }
+
+private:
+    // File being read
+    std::ifstream file;
+
+    // Record data of the current chunk, and the position of the next record in it
+    std::vector<char> chunk_data;
+    std::size_t chunk_position;
+
+    // Number of records of the current chunk not yet read, and the ID of the last record read
+    std::uint64_t n_chunk_records_left;
+    EventIDType previous_event_id;
+
+    // Size of the file in bytes, when it was opened
+    std::uint64_t file_size;
+
+    // Number of bytes of the file after the current read position
+    std::uint64_t remaining_file_size()
+    {
+        std::uint64_t position = file.tellg();
+        return position < file_size ? file_size - position : 0;
+    }
+
+    // Read the next non-empty chunk, returning false at the end of the file
+    bool read_chunk()
+    {
+        while (n_chunk_records_left == 0)
+        {
+            std::uint64_t n_records;
+            if (!file.read(reinterpret_cast<char*>(&n_records), sizeof(std::uint64_t)))
+            {
+                if (file.gcount() != 0)
+                {
+                    throw std::runtime_error("Trajectory file is truncated.");
+                }
+                return false;
+            }
+            std::uint64_t n_bytes;
+            if (!file.read(reinterpret_cast<char*>(&n_bytes), sizeof(std::uint64_t)))
+            {
+                throw std::runtime_error("Trajectory file is truncated.");
+            }
+            // Lengths are checked before allocating, so that a corrupt chunk header cannot force a huge allocation
+            if (n_records > n_bytes / TrajectoryFormat::min_record_size ||
+                n_bytes > n_records * TrajectoryFormat::max_record_size || n_bytes > remaining_file_size())
+            {
+                throw std::runtime_error("Trajectory file is corrupt.");
+            }
+            chunk_data.resize(n_bytes);
+            if (!file.read(chunk_data.data(), n_bytes))
+            {
+                throw std::runtime_error("Trajectory file is truncated.");
+            }
+            n_chunk_records_left = n_records;
+        }
+        chunk_position = 0;
+        previous_event_id = 0;
+        return true;
+    }
+};
+
+/*
+ * Event selector that passes on the selections of another event selector, recording each one to a trajectory
+ *
+ * Events selected with select_event are recorded as they are selected, so the caller must carry out each of them.
+ * Events selected by run_steps or run_until are recorded only as they are carried out: the event held by run_until
+ * is not recorded until a later call carries it out, so the trajectory never contains an event that did not happen.
+ */
+template <typename SelectorType, typename EventIDType>
+class RecordingEventSelector
+    : public EventSelectorRunner<RecordingEventSelector<SelectorType, EventIDType>, EventIDType>
+{
+    using RunnerType = EventSelectorRunner<RecordingEventSelector<SelectorType, EventIDType>, EventIDType>;
+
+public:
+    RecordingEventSelector(const std::shared_ptr<SelectorType>& selector_ptr,
+                           const std::shared_ptr<TrajectoryRecorder<EventIDType>>& recorder_ptr)
+        : selector_ptr(selector_ptr), recorder_ptr(recorder_ptr), is_recording_selections(true)
+    {
+        if (selector_ptr == nullptr || recorder_ptr == nullptr)
+        {
+            throw std::runtime_error("Selector and recorder must not be null.");
+        }
+    }
+
+    // Select an event using the underlying selector, record it (unless called by run_steps or run_until),
+    // and return its ID and the time step
+    std::pair<EventIDType, double> select_event()
+    {
+        std::pair<EventIDType, double> event_and_time = selector_ptr->select_event();
+        if (is_recording_selections)
+        {
+            recorder_ptr->record(event_and_time.first, event_and_time.second);
+        }
+        return event_and_time;
+    }
+
+    // Select and carry out a given number of events, as EventSelectorRunner::run_steps, recording each event as it is
+    // carried out
+    template <typename ApplyEventFunctionType>
+    void run_steps(UIntType n_steps, ApplyEventFunctionType&& apply_event)
+    {
+        RecordingScope recording_scope(*this);
+        RunnerType::run_steps(n_steps, recording_apply_event(apply_event));
+        return;
+    }
+
+    // Select and carry out events until the next event would take the elapsed time past max_time,
+    // as EventSelectorRunner::run_until, recording each event as it is carried out, but not the held event
+    template <typename ApplyEventFunctionType>
+    UIntType run_until(double max_time,
+                       ApplyEventFunctionType&& apply_event,
+                       UIntType max_steps = std::numeric_limits<UIntType>::max())
+    {
+        RecordingScope recording_scope(*this);
+        return RunnerType::run_until(max_time, recording_apply_event(apply_event), max_steps);
+    }
+
+private:
+    // Turns off recording of selections while the runner methods record carried out events instead,
+    // turning it back on when they return or throw
+    class RecordingScope
+    {
+    public:
+        explicit RecordingScope(RecordingEventSelector& selector) : selector(selector)
+        {
+            selector.is_recording_selections = false;
+        }
+
+        ~RecordingScope() { selector.is_recording_selections = true; }
+
+    private:
+        RecordingEventSelector& selector;
+    };
+
+    // Returns a function that records an event and then passes it on to apply_event
+    template <typename ApplyEventFunctionType>
+    auto recording_apply_event(ApplyEventFunctionType& apply_event)
+    {
+        return [this, &apply_event](const EventIDType& event_id, double time_step) {
+            recorder_ptr->record(event_id, time_step);
+            apply_event(event_id, time_step);
+        };
+    }
+
+    // Selector making the selections
+    const std::shared_ptr<SelectorType> selector_ptr;
+
+    // Recorder writing the trajectory
+    const std::shared_ptr<TrajectoryRecorder<EventIDType>> recorder_ptr;
+
+    // False while the runner methods are selecting events, which are recorded only once carried out
+    bool is_recording_selections;
+};
+} // namespace lotto
+#endif
@@ -0,0 +1,72 @@
+#ifndef BENCHMARK_PARAMETERS_H
+#define BENCHMARK_PARAMETERS_H
+
+#include "../../unit/lotto/rate_calculators.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Fixed seed for random number generators
+#define BENCHMARK_SEED 0
+
+// Number of events of the largest benchmarks, which by default are kept to a size that fits in a few GB
+// Set the environment variable LOTTO_BENCHMARK_MAX_EVENTS to change it, up to 10^8
+long int max_n_events()
+{
+    const char* max_n_events_value = std::getenv("LOTTO_BENCHMARK_MAX_EVENTS");
+    return max_n_events_value == nullptr ? 1000000 : std::atol(max_n_events_value);
+}
+
+// Run a benchmark for each power of ten from 10^3 events up to the given limit
+void add_event_counts(benchmark::internal::Benchmark* benchmark, long int limit)
+{
+    for (long int n_events = 1000; n_events <= limit && n_events <= 100000000; n_events *= 10)
+    {
+        benchmark->Arg(n_events);
+    }
+    return;
+}
+
+// Run a benchmark for each power of ten from 10^3 events up to the largest size
+void event_counts(benchmark::internal::Benchmark* benchmark) { add_event_counts(benchmark, max_n_events()); }
+
+// Run a benchmark for each power of ten from 10^3 up to 10^5 events, for benchmarks whose cost per step grows
+// linearly with the number of events
+void small_event_counts(benchmark::internal::Benchmark* benchmark) { add_event_counts(benchmark, 100000); }
+
+// Returns the event IDs 0, 1, ..., n_events - 1
+std::vector<int> event_id_sequence(long int n_events)
+{
+    std::vector<int> event_ids(n_events);
+    for (long int event_ix = 0; event_ix < n_events; ++event_ix)
+    {
+        event_ids[event_ix] = event_ix;
+    }
+    return event_ids;
+}
+
+// Rate calculators for each distribution of rates benchmarked, all with rates of at most one:
+// uniform, skewed over six orders of magnitude, and one-hot (only the first event has a nonzero rate)
+template <typename RateCalculatorType>
+std::shared_ptr<RateCalculatorType> make_rate_calculator();
+
+template <>
+std::shared_ptr<UniformRateCalculator<int>> make_rate_calculator()
+{
+    return std::make_shared<UniformRateCalculator<int>>(1.0);
+}
+
+template <>
+std::shared_ptr<SkewedRateCalculator> make_rate_calculator()
+{
+    return std::make_shared<SkewedRateCalculator>(6);
+}
+
+template <>
+std::shared_ptr<OneHotRateCalculator<int>> make_rate_calculator()
+{
+    return std::make_shared<OneHotRateCalculator<int>>(0);
+}
+
+#endif
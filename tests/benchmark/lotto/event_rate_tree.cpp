@@ -0,0 +1,76 @@
+#include "benchmark_parameters.hpp"
+#include <benchmark/benchmark.h>
+#include <lotto/event_rate_tree.hpp>
+#include <lotto/event_rate_tree_impl.hpp>
+#include <lotto/random.hpp>
+#include <vector>
+
+// Returns the rate of each event from a rate calculator
+template <typename RateCalculatorType>
+std::vector<double> calculate_rates(const std::vector<int>& event_ids)
+{
+    auto rate_calculator_ptr = make_rate_calculator<RateCalculatorType>();
+    std::vector<double> rates;
+    rates.reserve(event_ids.size());
+    for (int event_id : event_ids)
+    {
+        rates.push_back(rate_calculator_ptr->calculate_rate(event_id));
+    }
+    return rates;
+}
+
+template <typename RateCalculatorType>
+void BM_TreeConstruct(benchmark::State& state)
+{
+    // Construct a tree from event IDs and rates
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    std::vector<double> rates = calculate_rates<RateCalculatorType>(event_ids);
+    for (auto _ : state)
+    {
+        lotto::EventRateTree<int> tree(event_ids, rates);
+        benchmark::DoNotOptimize(tree.total_rate());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename RateCalculatorType>
+void BM_TreeQuery(benchmark::State& state)
+{
+    // Query a tree with uniformly distributed values
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    lotto::EventRateTree<int> tree(event_ids, calculate_rates<RateCalculatorType>(event_ids));
+    lotto::RandomGenerator generator;
+    generator.reseed_generator(BENCHMARK_SEED);
+    double total_rate = tree.total_rate();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(tree.query_tree(total_rate * generator.sample_unit_interval()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename RateCalculatorType>
+void BM_TreeUpdateRate(benchmark::State& state)
+{
+    // Update the rates of uniformly chosen events
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    lotto::EventRateTree<int> tree(event_ids, calculate_rates<RateCalculatorType>(event_ids));
+    lotto::RandomGenerator generator;
+    generator.reseed_generator(BENCHMARK_SEED);
+    for (auto _ : state)
+    {
+        int event_id = generator.sample_integer_range(event_ids.size() - 1);
+        tree.update_rate(event_id, generator.sample_unit_interval());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_TreeConstruct, UniformRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_TreeConstruct, SkewedRateCalculator)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_TreeQuery, UniformRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_TreeQuery, SkewedRateCalculator)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_TreeQuery, OneHotRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_TreeUpdateRate, UniformRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_TreeUpdateRate, SkewedRateCalculator)->Apply(event_counts);
+
+BENCHMARK_MAIN();
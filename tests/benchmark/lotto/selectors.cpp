@@ -0,0 +1,130 @@
+#include "benchmark_parameters.hpp"
+#include <benchmark/benchmark.h>
+#include <lotto/event_selector.hpp>
+#include <lotto/impact_provider.hpp>
+#include <lotto/rejection.hpp>
+#include <lotto/rejection_free.hpp>
+#include <map>
+#include <vector>
+
+// Returns an impact table in which each event impacts itself and the next event
+std::map<int, std::vector<int>> neighbor_impact_table(const std::vector<int>& event_ids)
+{
+    std::map<int, std::vector<int>> impact_table;
+    for (std::size_t event_ix = 0; event_ix < event_ids.size(); ++event_ix)
+    {
+        impact_table[event_ids[event_ix]] = {event_ids[event_ix], event_ids[(event_ix + 1) % event_ids.size()]};
+    }
+    return impact_table;
+}
+
+template <typename RateCalculatorType>
+void BM_RejectionFreeConstruct(benchmark::State& state)
+{
+    // Construct a rejection-free selector with a neighbor impact table, calculating all rates
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    auto impact_table = neighbor_impact_table(event_ids);
+    auto rate_calculator_ptr = make_rate_calculator<RateCalculatorType>();
+    for (auto _ : state)
+    {
+        lotto::RejectionFreeEventSelector<int, RateCalculatorType> selector(rate_calculator_ptr, event_ids,
+                                                                            impact_table);
+        benchmark::DoNotOptimize(selector.total_rate());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename RateCalculatorType>
+void BM_RejectionFreeSelectEvent(benchmark::State& state)
+{
+    // Select events with a rejection-free selector and a neighbor impact table
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    lotto::RejectionFreeEventSelector<int, RateCalculatorType> selector(
+        make_rate_calculator<RateCalculatorType>(), event_ids, neighbor_impact_table(event_ids));
+    selector.reseed_generator(BENCHMARK_SEED);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(selector.select_event());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename RateCalculatorType>
+void BM_RejectionFreeSelectEventCompleteImpacts(benchmark::State& state)
+{
+    // Select events with a rejection-free selector where every event impacts all others,
+    // generated on demand since a complete impact table grows quadratically
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    auto complete_impact_provider = lotto::make_function_impact_provider<int>(
+        [&event_ids]([[maybe_unused]] const int& event_id, std::vector<int>& impacted_events) {
+            impacted_events.insert(impacted_events.end(), event_ids.begin(), event_ids.end());
+        });
+    lotto::RejectionFreeEventSelector<int, RateCalculatorType, decltype(complete_impact_provider)> selector(
+        make_rate_calculator<RateCalculatorType>(), event_ids, complete_impact_provider);
+    selector.reseed_generator(BENCHMARK_SEED);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(selector.select_event());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename RateCalculatorType>
+void BM_RejectionSelectEvent(benchmark::State& state)
+{
+    // Select events with a rejection selector, with a rate upper bound of one
+    lotto::RejectionEventSelector<int, RateCalculatorType> selector(make_rate_calculator<RateCalculatorType>(), 1.0,
+                                                                    event_id_sequence(state.range(0)));
+    selector.reseed_generator(BENCHMARK_SEED);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(selector.select_event());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_SelectEventVirtual(benchmark::State& state)
+{
+    // Select events through a pointer to the selector base class, which the compiler cannot see through
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    lotto::RejectionFreeEventSelector<int, UniformRateCalculator<int>> selector(
+        make_rate_calculator<UniformRateCalculator<int>>(), event_ids, neighbor_impact_table(event_ids));
+    selector.reseed_generator(BENCHMARK_SEED);
+    lotto::EventSelectorBase<int, UniformRateCalculator<int>>* selector_ptr = &selector;
+    benchmark::DoNotOptimize(selector_ptr);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(selector_ptr->select_event());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_SelectEventStatic(benchmark::State& state)
+{
+    // Select the same events through the selector type, where select_event is bound statically
+    std::vector<int> event_ids = event_id_sequence(state.range(0));
+    lotto::RejectionFreeEventSelector<int, UniformRateCalculator<int>> selector(
+        make_rate_calculator<UniformRateCalculator<int>>(), event_ids, neighbor_impact_table(event_ids));
+    selector.reseed_generator(BENCHMARK_SEED);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(selector.select_event());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_RejectionFreeConstruct, UniformRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionFreeConstruct, SkewedRateCalculator)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionFreeSelectEvent, UniformRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionFreeSelectEvent, SkewedRateCalculator)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionFreeSelectEvent, OneHotRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionFreeSelectEventCompleteImpacts, UniformRateCalculator<int>)->Apply(small_event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionFreeSelectEventCompleteImpacts, SkewedRateCalculator)->Apply(small_event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionSelectEvent, UniformRateCalculator<int>)->Apply(event_counts);
+BENCHMARK_TEMPLATE(BM_RejectionSelectEvent, SkewedRateCalculator)->Apply(event_counts);
+// With a single nonzero rate, each rejection selection takes as many attempts as there are events on average
+BENCHMARK_TEMPLATE(BM_RejectionSelectEvent, OneHotRateCalculator<int>)->Apply(small_event_counts);
+BENCHMARK(BM_SelectEventVirtual)->Apply(event_counts);
+BENCHMARK(BM_SelectEventStatic)->Apply(event_counts);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,147 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/cached_rate_calculator.hpp>
+#include <lotto/rejection_free.hpp>
+#include <memory>
+#include <stdexcept>
+
+class CachedRateCalculatorTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        event_ids = hashed_sequence(n_events);
+        inner_calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_environments);
+        cached_calculator_ptr =
+            std::make_shared<lotto::CachedRateCalculator<EnvironmentRateCalculator>>(inner_calculator_ptr, capacity);
+    }
+
+    // Event ID list
+    int n_events = 1000;
+    std::vector<ID> event_ids;
+
+    // Number of distinct environments, and cache capacity (enough to hold all of them)
+    int n_environments = 10;
+    std::size_t capacity = 100;
+
+    // Rate calculator pointers
+    std::shared_ptr<EnvironmentRateCalculator> inner_calculator_ptr;
+    std::shared_ptr<lotto::CachedRateCalculator<EnvironmentRateCalculator>> cached_calculator_ptr;
+};
+
+/*
+ * Rate calculator whose environment is the event id, which throws when calculating the rate of one failing event id
+ */
+class FailingRateCalculator
+{
+public:
+    FailingRateCalculator(int failing_id) : failing_id(failing_id) {}
+    double calculate_rate(const int& event_id) const
+    {
+        if (event_id == failing_id)
+        {
+            throw std::runtime_error("Rate calculation failed.");
+        }
+        return 1.0 + event_id;
+    }
+    unsigned long environment_key(const int& event_id) const { return event_id; }
+    void set_failing_id(int new_failing_id) { failing_id = new_failing_id; }
+
+private:
+    int failing_id;
+};
+
+TEST_F(CachedRateCalculatorTest, Construct)
+{
+    // Checks construction, capacity should be rounded up to a power of two
+    EXPECT_EQ(cached_calculator_ptr->capacity(), 128);
+    EXPECT_THROW(lotto::CachedRateCalculator<EnvironmentRateCalculator>(inner_calculator_ptr, 0), std::runtime_error);
+}
+
+TEST_F(CachedRateCalculatorTest, CorrectRates)
+{
+    // Checks that cached rates are the same as those of the inner calculator
+    for (int repeat = 0; repeat < 2; ++repeat)
+    {
+        for (const ID& id : event_ids)
+        {
+            EXPECT_EQ(cached_calculator_ptr->calculate_rate(id), 1.0 + id % n_environments);
+        }
+    }
+}
+
+TEST_F(CachedRateCalculatorTest, HitsAndMisses)
+{
+    // Checks that the inner calculator is only called once per environment
+    for (const ID& id : event_ids)
+    {
+        cached_calculator_ptr->calculate_rate(id);
+    }
+    const auto& statistics = cached_calculator_ptr->get_statistics();
+    EXPECT_EQ(inner_calculator_ptr->get_n_calculations(), statistics.n_misses);
+    EXPECT_EQ(statistics.n_hits + statistics.n_misses, n_events);
+    EXPECT_GE(statistics.n_misses, n_environments);
+    EXPECT_LT(statistics.n_misses, n_events);
+
+    // After clearing, the inner calculator should be called again
+    cached_calculator_ptr->reset_statistics();
+    cached_calculator_ptr->clear();
+    cached_calculator_ptr->calculate_rate(event_ids[0]);
+    EXPECT_EQ(cached_calculator_ptr->get_statistics().n_misses, 1);
+    EXPECT_EQ(cached_calculator_ptr->get_statistics().n_hits, 0);
+}
+
+TEST_F(CachedRateCalculatorTest, BoundedCapacity)
+{
+    // Checks that rates are still correct when there are more environments than cache slots
+    auto many_environment_calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_events);
+    lotto::CachedRateCalculator<EnvironmentRateCalculator> small_cache(many_environment_calculator_ptr, 4);
+    for (const ID& id : event_ids)
+    {
+        EXPECT_EQ(small_cache.calculate_rate(id), 1.0 + id % n_events);
+    }
+    EXPECT_EQ(small_cache.capacity(), 4);
+}
+
+TEST_F(CachedRateCalculatorTest, ThrowingInnerCalculator)
+{
+    // Checks that a slot is left unchanged if the inner calculator throws while replacing its rate
+    auto failing_calculator_ptr = std::make_shared<FailingRateCalculator>(1);
+    lotto::CachedRateCalculator<FailingRateCalculator> single_slot_cache(failing_calculator_ptr, 1);
+    EXPECT_EQ(single_slot_cache.calculate_rate(0), 1.0);
+    EXPECT_THROW(single_slot_cache.calculate_rate(1), std::runtime_error);
+    EXPECT_EQ(single_slot_cache.calculate_rate(0), 1.0);
+    EXPECT_EQ(single_slot_cache.get_statistics().n_hits, 1);
+
+    // Once the inner calculator succeeds, the new environment gets its own rate
+    failing_calculator_ptr->set_failing_id(-1);
+    EXPECT_EQ(single_slot_cache.calculate_rate(1), 2.0);
+}
+
+TEST_F(CachedRateCalculatorTest, EventSelection)
+{
+    // Checks that the cached calculator can be used with an event selector
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    for (int i = 0; i < n_events; ++i)
+    {
+        neighbor_impact_table[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+    }
+    lotto::RejectionFreeEventSelector<ID, lotto::CachedRateCalculator<EnvironmentRateCalculator>> selector(
+        cached_calculator_ptr, event_ids, neighbor_impact_table);
+    int n_selections = 100;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        selector.select_event();
+    }
+    EXPECT_GT(cached_calculator_ptr->get_statistics().hit_ratio(), 0.5);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
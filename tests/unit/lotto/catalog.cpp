@@ -0,0 +1,212 @@
+#include "rate_calculators.hpp"
+#include "test_parameters.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <lotto/catalog.hpp>
+#include <lotto/rejection_free.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EventCatalogTest : public testing::Test
+{
+protected:
+    using ID = int;
+    using ImpactTable = std::map<ID, std::vector<ID>>;
+
+    void SetUp() override
+    {
+        // Events listed in decreasing order, with rates proportional to their IDs
+        for (ID id = n_events - 1; id >= 0; --id)
+        {
+            event_id_list.push_back(id);
+            rates.push_back(id + 1.0);
+            if (id != n_events - 1)
+            {
+                impact_table[id] = {(id + n_events - 1) % n_events, id, (id + 1) % n_events};
+            }
+        }
+        file_path = testing::TempDir() + "lotto_event_catalog_test.bin";
+    }
+
+    void TearDown() override
+    {
+        std::remove(file_path.c_str());
+        return;
+    }
+
+    int n_events = 20;
+    std::vector<ID> event_id_list;
+    std::vector<double> rates;
+    ImpactTable impact_table;
+    std::string file_path;
+};
+
+TEST_F(EventCatalogTest, RoundTrip)
+{
+    // Checks that event IDs are stored sorted, with rates in matching order and impacted events unchanged
+    lotto::write_event_catalog(file_path, event_id_list, impact_table, rates);
+    lotto::EventCatalog<ID> catalog(file_path);
+    EXPECT_EQ(catalog.n_events(), n_events);
+    EXPECT_TRUE(catalog.has_rates());
+
+    std::vector<ID> catalog_event_ids = catalog.event_id_list();
+    std::vector<double> catalog_rates = catalog.initial_rates();
+    for (ID id = 0; id < n_events; ++id)
+    {
+        EXPECT_EQ(catalog_event_ids[id], id);
+        EXPECT_EQ(catalog_rates[id], id + 1.0);
+        auto impacted_range = catalog.impacted_events(id);
+        std::vector<ID> impacted_events(impacted_range.first, impacted_range.second);
+        EXPECT_EQ(impacted_events, impact_table.count(id) ? impact_table[id] : std::vector<ID>());
+    }
+    auto missing_range = catalog.impacted_events(n_events);
+    EXPECT_EQ(missing_range.first, missing_range.second);
+}
+
+TEST_F(EventCatalogTest, NoRates)
+{
+    // Checks that a catalog may be written without rates
+    lotto::write_event_catalog(file_path, event_id_list, impact_table);
+    lotto::EventCatalog<ID> catalog(file_path);
+    EXPECT_FALSE(catalog.has_rates());
+    EXPECT_TRUE(catalog.initial_rates().empty());
+}
+
+TEST_F(EventCatalogTest, InvalidFiles)
+{
+    // Checks that invalid input and files that do not match the event ID type are rejected
+    EXPECT_THROW(lotto::write_event_catalog(file_path, event_id_list, impact_table, std::vector<double>(1, 1.0)),
+                 std::runtime_error);
+    EXPECT_THROW(lotto::write_event_catalog(file_path, std::vector<ID>{1, 1}, impact_table), std::runtime_error);
+    EXPECT_THROW(lotto::write_event_catalog(file_path, event_id_list, ImpactTable{{0, {n_events}}}),
+                 std::runtime_error);
+    EXPECT_THROW(lotto::EventCatalog<ID>(testing::TempDir() + "lotto_missing_event_catalog.bin"), std::runtime_error);
+
+    lotto::write_event_catalog(file_path, event_id_list, impact_table, rates);
+    EXPECT_THROW(lotto::EventCatalog<long int>{file_path}, std::runtime_error);
+
+    std::ofstream(file_path, std::ios::binary | std::ios::trunc) << "not an event catalog, but long enough to check";
+    EXPECT_THROW(lotto::EventCatalog<ID>{file_path}, std::runtime_error);
+}
+
+TEST_F(EventCatalogTest, CorruptOffsets)
+{
+    // Checks that offsets which are out of range or not monotonic are rejected when the file is opened
+    lotto::write_event_catalog(file_path, event_id_list, impact_table, rates);
+    lotto::EventCatalogHeader header;
+    std::ifstream(file_path, std::ios::binary).read(reinterpret_cast<char*>(&header), sizeof(header));
+    lotto::EventCatalogLayout layout(header);
+
+    for (std::uint64_t corrupt_offset : {header.n_impacts + 1000, std::uint64_t(0)})
+    {
+        lotto::write_event_catalog(file_path, event_id_list, impact_table, rates);
+        std::fstream file(file_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(layout.offsets_offset + 5 * sizeof(std::uint64_t));
+        file.write(reinterpret_cast<const char*>(&corrupt_offset), sizeof(corrupt_offset));
+        file.close();
+        EXPECT_THROW(lotto::EventCatalog<ID>{file_path}, std::runtime_error);
+    }
+}
+
+TEST_F(EventCatalogTest, CorruptNeighbors)
+{
+    // Checks that an impacted event which is not a catalog event is rejected when the file is opened
+    lotto::write_event_catalog(file_path, event_id_list, impact_table, rates);
+    lotto::EventCatalogHeader header;
+    std::ifstream(file_path, std::ios::binary).read(reinterpret_cast<char*>(&header), sizeof(header));
+    lotto::EventCatalogLayout layout(header);
+
+    ID missing_event_id = n_events;
+    std::fstream file(file_path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(layout.neighbors_offset + (header.n_impacts - 1) * sizeof(ID));
+    file.write(reinterpret_cast<const char*>(&missing_event_id), sizeof(missing_event_id));
+    file.close();
+    EXPECT_THROW(lotto::EventCatalog<ID>{file_path}, std::runtime_error);
+}
+
+TEST_F(EventCatalogTest, SelectorFromCatalog)
+{
+    // Checks that a selector built from a catalog selects the same events as one built from the original table
+    auto rate_calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+    for (ID id = 0; id < n_events; ++id)
+    {
+        rate_calculator_ptr->set_rate(id, id + 1.0);
+    }
+    lotto::write_event_catalog(file_path, event_id_list, impact_table, rates);
+    auto catalog_ptr = std::make_shared<const lotto::EventCatalog<ID>>(file_path);
+
+    // Both selectors need events in the same order, which for the catalog is sorted
+    // The catalog selector is built from the events and rates in place, without copying them
+    lotto::RejectionFreeEventSelector<ID, ListedRateCalculator<ID>> table_selector(
+        rate_calculator_ptr, catalog_ptr->event_id_list(), impact_table);
+    auto catalog_event_ids = catalog_ptr->event_id_range();
+    auto catalog_rates = catalog_ptr->initial_rate_range();
+    lotto::RejectionFreeEventSelector<ID, ListedRateCalculator<ID>, lotto::CatalogImpactProvider<ID>>
+        catalog_selector(rate_calculator_ptr,
+                         catalog_event_ids.first,
+                         catalog_event_ids.second,
+                         catalog_rates.first,
+                         catalog_rates.second,
+                         lotto::CatalogImpactProvider<ID>(catalog_ptr));
+    EXPECT_EQ(catalog_selector.total_rate(), table_selector.total_rate());
+
+    table_selector.reseed_generator(TEST_SEED);
+    catalog_selector.reseed_generator(TEST_SEED);
+    for (int step = 0; step < 1000; ++step)
+    {
+        if (step == 500)
+        {
+            // Change a rate, which both selectors pick up once an event impacting it is selected
+            rate_calculator_ptr->set_rate(3, 50.0);
+        }
+        auto table_event_and_time = table_selector.select_event();
+        auto catalog_event_and_time = catalog_selector.select_event();
+        ASSERT_EQ(catalog_event_and_time.first, table_event_and_time.first);
+        ASSERT_EQ(catalog_event_and_time.second, table_event_and_time.second);
+    }
+    EXPECT_THROW((lotto::RejectionFreeEventSelector<ID, ListedRateCalculator<ID>, lotto::CatalogImpactProvider<ID>>(
+                     rate_calculator_ptr, catalog_ptr->event_id_list(), std::vector<double>(),
+                     lotto::CatalogImpactProvider<ID>(catalog_ptr))),
+                 std::runtime_error);
+}
+
+TEST_F(EventCatalogTest, SelectorFromCatalogWithoutRates)
+{
+    // Checks that a selector can be built from the event IDs of a catalog storing no rates, calculating them instead
+    auto rate_calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+    for (ID id = 0; id < n_events; ++id)
+    {
+        rate_calculator_ptr->set_rate(id, id + 1.0);
+    }
+    lotto::write_event_catalog(file_path, event_id_list, impact_table);
+    auto catalog_ptr = std::make_shared<const lotto::EventCatalog<ID>>(file_path);
+    EXPECT_EQ(catalog_ptr->initial_rate_range().first, catalog_ptr->initial_rate_range().second);
+
+    auto catalog_event_ids = catalog_ptr->event_id_range();
+    lotto::RejectionFreeEventSelector<ID, ListedRateCalculator<ID>, lotto::CatalogImpactProvider<ID>> selector(
+        rate_calculator_ptr,
+        catalog_event_ids.first,
+        catalog_event_ids.second,
+        lotto::CatalogImpactProvider<ID>(catalog_ptr));
+    EXPECT_DOUBLE_EQ(selector.total_rate(), n_events * (n_events + 1) / 2.0);
+
+    auto catalog_rates = catalog_ptr->initial_rate_range();
+    EXPECT_THROW((lotto::RejectionFreeEventSelector<ID, ListedRateCalculator<ID>, lotto::CatalogImpactProvider<ID>>(
+                     rate_calculator_ptr,
+                     catalog_event_ids.first,
+                     catalog_event_ids.second,
+                     catalog_rates.first,
+                     catalog_rates.second,
+                     lotto::CatalogImpactProvider<ID>(catalog_ptr))),
+                 std::runtime_error);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
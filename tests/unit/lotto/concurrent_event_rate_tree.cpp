@@ -0,0 +1,193 @@
+#include "lotto/random.hpp"
+#include "sequences.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/concurrent_event_rate_tree.hpp>
+#include <lotto/event_rate_tree.hpp>
+#include <lotto/event_rate_tree_impl.hpp>
+#include <list>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+class ConcurrentEventRateTreeTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        // Reseed generator for testing
+        generator.reseed_generator(TEST_SEED);
+
+        // Set up event IDs
+        init_ids = hashed_sequence(n_events);
+
+        // Set up initial rates
+        for (int i = 0; i < n_events; ++i)
+        {
+            init_rates.push_back(generator.sample_unit_interval());
+        }
+
+        // Set up tree
+        tree_ptr = std::make_unique<lotto::ConcurrentEventRateTree<ID>>(init_ids, init_rates);
+    }
+
+    // Random generator
+    lotto::RandomGenerator generator;
+
+    // Pointer to event rate tree
+    std::unique_ptr<lotto::ConcurrentEventRateTree<ID>> tree_ptr;
+
+    // Number of events (deliberately not a power of two), initial IDs and rates
+    int n_events = 1000;
+    std::vector<ID> init_ids;
+    std::vector<double> init_rates;
+
+    // Returns the number of leaves including padding
+    lotto::Index n_padded_leaves() const { return tree_ptr->n_padded_leaves; }
+
+    // Checks that every internal node is exactly the sum of its children
+    void check_consistency() const
+    {
+        for (lotto::Index node_ix = 1; node_ix < tree_ptr->n_padded_leaves; ++node_ix)
+        {
+            EXPECT_EQ(tree_ptr->node_rates[node_ix].load(), tree_ptr->summed_children_rate(node_ix));
+        }
+    }
+};
+
+TEST_F(ConcurrentEventRateTreeTest, Construct)
+{
+    // Checks construction and data correctness
+    EXPECT_EQ(n_padded_leaves(), 1024);
+    for (int i = 0; i < n_events; ++i)
+    {
+        EXPECT_EQ(tree_ptr->get_rate(init_ids[i]), init_rates[i]);
+    }
+    check_consistency();
+    EXPECT_THROW(lotto::ConcurrentEventRateTree<ID>({}, {}), std::runtime_error);
+    EXPECT_THROW(lotto::ConcurrentEventRateTree<ID>({1, 2}, {1.0}), std::runtime_error);
+}
+
+TEST_F(ConcurrentEventRateTreeTest, SingleEvent)
+{
+    // Checks that a tree with a single event works
+    lotto::ConcurrentEventRateTree<ID> single_tree({5}, {2.0});
+    EXPECT_EQ(single_tree.total_rate(), 2.0);
+    EXPECT_EQ(single_tree.query_tree(1.0), 5);
+    single_tree.update_rate(5, 3.0);
+    EXPECT_EQ(single_tree.total_rate(), 3.0);
+}
+
+TEST_F(ConcurrentEventRateTreeTest, TotalRate)
+{
+    // Checks that the total rate is identical to that of the serial tree
+    lotto::EventRateTree<ID> serial_tree(init_ids, init_rates);
+    EXPECT_EQ(tree_ptr->total_rate(), serial_tree.total_rate());
+    double rate_sum = std::accumulate(init_rates.begin(), init_rates.end(), 0.0);
+    EXPECT_DOUBLE_EQ(tree_ptr->total_rate(), rate_sum);
+}
+
+TEST_F(ConcurrentEventRateTreeTest, RandomQuery)
+{
+    // Checks that querying the tree returns the same event as the serial tree
+    lotto::EventRateTree<ID> serial_tree(init_ids, init_rates);
+    double total_rate = tree_ptr->total_rate();
+    int n_queries = 1000;
+    for (int i = 0; i < n_queries; ++i)
+    {
+        double query_value = total_rate * generator.sample_unit_interval();
+        EXPECT_EQ(tree_ptr->query_tree(query_value), serial_tree.query_tree(query_value));
+    }
+}
+
+TEST_F(ConcurrentEventRateTreeTest, ZeroRateNeverSelected)
+{
+    // Checks that events with zero rate are never selected, even at the largest query value
+    for (int i = 1; i < n_events; ++i)
+    {
+        tree_ptr->update_rate(init_ids[i], 0.0);
+    }
+    EXPECT_EQ(tree_ptr->query_tree(tree_ptr->total_rate()), init_ids[0]);
+    tree_ptr->update_rate(init_ids[0], 0.0);
+    tree_ptr->update_rate(init_ids[n_events - 1], 1.0);
+    EXPECT_EQ(tree_ptr->query_tree(1.0), init_ids[n_events - 1]);
+}
+
+TEST_F(ConcurrentEventRateTreeTest, ConcurrentUpdates)
+{
+    // Checks that updating disjoint events from several threads leaves a consistent tree
+    // with the same sums as the serial tree given the same updates
+    int n_threads = 8;
+    int n_rounds = 20;
+    lotto::EventRateTree<ID> serial_tree(init_ids, init_rates);
+    for (int round = 0; round < n_rounds; ++round)
+    {
+        std::vector<double> new_rates(n_events);
+        for (int i = 0; i < n_events; ++i)
+        {
+            new_rates[i] = generator.sample_unit_interval();
+            serial_tree.update_rate(init_ids[i], new_rates[i]);
+        }
+
+        std::vector<std::thread> threads;
+        for (int thread_ix = 0; thread_ix < n_threads; ++thread_ix)
+        {
+            threads.emplace_back([&, thread_ix] {
+                for (int i = thread_ix; i < n_events; i += n_threads)
+                {
+                    tree_ptr->update_rate(init_ids[i], new_rates[i]);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        tree_ptr->synchronize();
+
+        check_consistency();
+        EXPECT_EQ(tree_ptr->total_rate(), serial_tree.total_rate());
+    }
+}
+
+TEST_F(ConcurrentEventRateTreeTest, SameInterfaceAsSerialTree)
+{
+    // Checks the parts of the interface shared with EventRateTree: construction from ranges with a shared index,
+    // reporting unchanged rates, the path length, and snapshots readable by either tree
+    lotto::EventRateTree<ID> serial_tree(init_ids, init_rates);
+    std::list<ID> id_list(init_ids.begin(), init_ids.end());
+    lotto::ConcurrentEventRateTree<ID> range_tree(id_list.begin(), id_list.end(), init_rates.data(),
+                                                  tree_ptr->event_index());
+    EXPECT_EQ(range_tree.event_index(), tree_ptr->event_index());
+    EXPECT_EQ(range_tree.total_rate(), serial_tree.total_rate());
+    EXPECT_EQ(range_tree.path_length(), serial_tree.path_length());
+    EXPECT_THROW(lotto::ConcurrentEventRateTree<ID>(init_ids.begin(), init_ids.end() - 1, init_rates.begin(),
+                                                    tree_ptr->event_index()),
+                 std::runtime_error);
+
+    EXPECT_FALSE(range_tree.update_rate(init_ids[0], init_rates[0]));
+    EXPECT_TRUE(range_tree.update_rate(init_ids[0], 2.0));
+    serial_tree.update_rate(init_ids[0], 2.0);
+
+    std::stringstream snapshot;
+    range_tree.save_state(snapshot);
+    tree_ptr->load_state(snapshot);
+    EXPECT_EQ(tree_ptr->get_rate(init_ids[0]), 2.0);
+    EXPECT_EQ(tree_ptr->total_rate(), serial_tree.total_rate());
+    check_consistency();
+
+    std::stringstream serial_snapshot;
+    serial_tree.save_state(serial_snapshot);
+    lotto::ConcurrentEventRateTree<ID> small_tree({1, 2}, {1.0, 1.0});
+    EXPECT_THROW(small_tree.load_state(serial_snapshot), std::runtime_error);
+    EXPECT_EQ(small_tree.total_rate(), 2.0);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "test_parameters.hpp"
+#include <cmath>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <limits>
+#include <lotto/catalog.hpp>
+#include <lotto/ensemble.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class EnsembleRunnerTest : public testing::Test
+{
+protected:
+    using ID = int;
+    using Ensemble = lotto::EnsembleRunner<ID, UniformRateCalculator<ID>>;
+
+    void SetUp() override
+    {
+        auto event_ids = hashed_sequence(n_events);
+        auto impact_table = std::make_shared<std::map<ID, std::vector<ID>>>();
+        for (int i = 0; i < n_events; ++i)
+        {
+            (*impact_table)[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+        }
+        event_id_list_ptr = std::make_shared<const std::vector<ID>>(event_ids);
+        impact_table_ptr = impact_table;
+    }
+
+    // Shared event IDs and impact table
+    int n_events = 100;
+    std::shared_ptr<const std::vector<ID>> event_id_list_ptr;
+    std::shared_ptr<const std::map<ID, std::vector<ID>>> impact_table_ptr;
+
+    // Makes an ensemble in which replica i has all rates equal to i + 1
+    std::unique_ptr<Ensemble> make_ensemble(std::size_t n_replicas, std::size_t n_threads)
+    {
+        auto ensemble_ptr = std::make_unique<Ensemble>(
+            n_replicas,
+            [](std::size_t replica_ix) { return std::make_shared<UniformRateCalculator<ID>>(replica_ix + 1.0); },
+            event_id_list_ptr, impact_table_ptr, n_threads);
+        ensemble_ptr->reseed_generators(TEST_SEED);
+        return ensemble_ptr;
+    }
+
+    // Returns the selector of a replica
+    const Ensemble::SelectorType& get_selector(const Ensemble& ensemble, std::size_t replica_ix) const
+    {
+        return ensemble.replicas[replica_ix]->selector;
+    }
+
+    // Runs an ensemble and returns the events selected by each replica
+    std::vector<std::vector<ID>> record_events(Ensemble& ensemble, lotto::UIntType max_steps, double max_time)
+    {
+        std::vector<std::vector<ID>> events_by_replica(ensemble.n_replicas());
+        ensemble.run(max_steps, max_time, [&](std::size_t replica_ix, const ID& event_id, double) {
+            events_by_replica[replica_ix].push_back(event_id);
+        });
+        return events_by_replica;
+    }
+};
+
+TEST_F(EnsembleRunnerTest, Construct)
+{
+    // Checks construction, and that each replica has its own calculator while sharing the impact table
+    auto ensemble_ptr = make_ensemble(5, 2);
+    EXPECT_EQ(ensemble_ptr->n_replicas(), 5);
+    for (std::size_t replica_ix = 0; replica_ix < 5; ++replica_ix)
+    {
+        EXPECT_EQ(ensemble_ptr->get_rate_calculator(replica_ix)->get_rate(), replica_ix + 1.0);
+    }
+    EXPECT_EQ(impact_table_ptr.use_count(), 1 + 5);
+
+    // Every replica shares the event index of the first
+    for (std::size_t replica_ix = 1; replica_ix < 5; ++replica_ix)
+    {
+        EXPECT_EQ(get_selector(*ensemble_ptr, replica_ix).event_index(), get_selector(*ensemble_ptr, 0).event_index());
+    }
+}
+
+TEST_F(EnsembleRunnerTest, CatalogImpactProvider)
+{
+    // Checks that replicas sharing a catalog of impacted events follow the same trajectories as with the impact table
+    std::string file_path = testing::TempDir() + "lotto_ensemble_catalog_test.bin";
+    lotto::write_event_catalog(file_path, *event_id_list_ptr, *impact_table_ptr);
+    auto catalog_ptr = std::make_shared<const lotto::EventCatalog<ID>>(file_path);
+    using CatalogEnsemble =
+        lotto::EnsembleRunner<ID, UniformRateCalculator<ID>, lotto::CatalogImpactProvider<ID>>;
+    CatalogEnsemble catalog_ensemble(
+        3,
+        [](std::size_t replica_ix) { return std::make_shared<UniformRateCalculator<ID>>(replica_ix + 1.0); },
+        event_id_list_ptr,
+        lotto::CatalogImpactProvider<ID>(catalog_ptr),
+        2);
+    catalog_ensemble.reseed_generators(TEST_SEED);
+    EXPECT_EQ(catalog_ptr.use_count(), 1 + 3);
+
+    auto ensemble_ptr = make_ensemble(3, 2);
+    std::vector<std::vector<ID>> catalog_events_by_replica(3);
+    catalog_ensemble.run(100, 10.0, [&](std::size_t replica_ix, const ID& event_id, double) {
+        catalog_events_by_replica[replica_ix].push_back(event_id);
+    });
+    EXPECT_EQ(catalog_events_by_replica, record_events(*ensemble_ptr, 100, 10.0));
+    std::remove(file_path.c_str());
+}
+
+TEST_F(EnsembleRunnerTest, StepBudget)
+{
+    // Checks that every replica carries out the requested number of steps
+    auto ensemble_ptr = make_ensemble(6, 3);
+    lotto::UIntType max_steps = 1000;
+    auto events_by_replica = record_events(*ensemble_ptr, max_steps, std::numeric_limits<double>::infinity());
+    for (std::size_t replica_ix = 0; replica_ix < 6; ++replica_ix)
+    {
+        EXPECT_EQ(ensemble_ptr->get_n_steps(replica_ix), max_steps);
+        EXPECT_EQ(events_by_replica[replica_ix].size(), max_steps);
+
+        // Total rate is n_events * (i + 1), so the time reached should be close to the expected value
+        double expected_time = max_steps / (n_events * (replica_ix + 1.0));
+        EXPECT_NEAR(ensemble_ptr->get_time(replica_ix), expected_time, TEST_SIGMA * expected_time / std::sqrt(max_steps));
+    }
+
+    // Replicas should follow different trajectories
+    EXPECT_NE(events_by_replica[0], events_by_replica[1]);
+}
+
+TEST_F(EnsembleRunnerTest, TimeBudget)
+{
+    // Checks that no replica goes past the time budget, and that running again continues from where it stopped
+    auto ensemble_ptr = make_ensemble(4, 2);
+    double max_time = 1.0;
+    record_events(*ensemble_ptr, std::numeric_limits<lotto::UIntType>::max(), max_time);
+    for (std::size_t replica_ix = 0; replica_ix < 4; ++replica_ix)
+    {
+        EXPECT_LE(ensemble_ptr->get_time(replica_ix), max_time);
+        EXPECT_GT(ensemble_ptr->get_n_steps(replica_ix), 0);
+    }
+    lotto::UIntType n_steps = ensemble_ptr->get_n_steps(0);
+    record_events(*ensemble_ptr, n_steps + 10, 2 * max_time);
+    EXPECT_EQ(ensemble_ptr->get_n_steps(0), n_steps + 10);
+}
+
+TEST_F(EnsembleRunnerTest, RunInParts)
+{
+    // Checks that running up to a time in two calls gives the same trajectories as a single call
+    auto full_ensemble_ptr = make_ensemble(3, 2);
+    auto split_ensemble_ptr = make_ensemble(3, 2);
+    lotto::UIntType max_steps = std::numeric_limits<lotto::UIntType>::max();
+    double max_time = 1.0;
+    auto full_events_by_replica = record_events(*full_ensemble_ptr, max_steps, max_time);
+    auto split_events_by_replica = record_events(*split_ensemble_ptr, max_steps, max_time / 2);
+    auto second_half_events_by_replica = record_events(*split_ensemble_ptr, max_steps, max_time);
+    for (std::size_t replica_ix = 0; replica_ix < 3; ++replica_ix)
+    {
+        split_events_by_replica[replica_ix].insert(split_events_by_replica[replica_ix].end(),
+                                                   second_half_events_by_replica[replica_ix].begin(),
+                                                   second_half_events_by_replica[replica_ix].end());
+        EXPECT_EQ(split_ensemble_ptr->get_n_steps(replica_ix), full_ensemble_ptr->get_n_steps(replica_ix));
+        EXPECT_EQ(split_ensemble_ptr->get_time(replica_ix), full_ensemble_ptr->get_time(replica_ix));
+    }
+    EXPECT_EQ(split_events_by_replica, full_events_by_replica);
+}
+
+TEST_F(EnsembleRunnerTest, SaveAndLoadState)
+{
+    // Checks that an ensemble restored from a snapshot taken while events are held carries out the same events as the
+    // original, and that a snapshot that fails to load part way through leaves it unchanged
+    auto ensemble_ptr = make_ensemble(3, 2);
+    lotto::UIntType max_steps = std::numeric_limits<lotto::UIntType>::max();
+    double max_time = 1.0;
+    record_events(*ensemble_ptr, max_steps, max_time / 2);
+    std::stringstream snapshot;
+    ensemble_ptr->save_state(snapshot);
+    auto events_by_replica = record_events(*ensemble_ptr, max_steps, max_time);
+    std::stringstream final_snapshot;
+    ensemble_ptr->save_state(final_snapshot);
+
+    auto restored_ensemble_ptr = make_ensemble(3, 1);
+    restored_ensemble_ptr->load_state(snapshot);
+    std::string final_snapshot_data = final_snapshot.str();
+    std::stringstream truncated_snapshot(final_snapshot_data.substr(0, final_snapshot_data.size() - 1));
+    EXPECT_THROW(restored_ensemble_ptr->load_state(truncated_snapshot), std::runtime_error);
+    EXPECT_EQ(record_events(*restored_ensemble_ptr, max_steps, max_time), events_by_replica);
+    for (std::size_t replica_ix = 0; replica_ix < 3; ++replica_ix)
+    {
+        EXPECT_EQ(restored_ensemble_ptr->get_n_steps(replica_ix), ensemble_ptr->get_n_steps(replica_ix));
+        EXPECT_EQ(restored_ensemble_ptr->get_time(replica_ix), ensemble_ptr->get_time(replica_ix));
+    }
+}
+
+TEST_F(EnsembleRunnerTest, IndependentOfThreadCount)
+{
+    // Checks that trajectories do not depend on the number of threads
+    auto serial_ensemble_ptr = make_ensemble(4, 1);
+    auto parallel_ensemble_ptr = make_ensemble(4, 3);
+    EXPECT_EQ(record_events(*serial_ensemble_ptr, 100, 10.0), record_events(*parallel_ensemble_ptr, 100, 10.0));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -4,8 +4,10 @@
 #include <gtest/gtest.h>
 #include <lotto/event_rate_tree.hpp>
 #include <lotto/event_rate_tree_impl.hpp>
+#include <list>
 #include <memory>
 #include <numeric>
+#include <sstream>
 
 class EventRateNodeDataTest : public testing::Test
 {
@@ -109,13 +111,15 @@ protected:
     std::vector<double> init_rates;
 
     // Gets map from event ID to index in the tree leaves
-    const std::map<ID, lotto::Index>& event_to_leaf_index() const { return tree_ptr->event_to_leaf_index; }
+    const std::map<ID, lotto::Index>& event_to_leaf_index() const { return *tree_ptr->event_to_leaf_index; }
 
     // Returns the event IDs of the tree leaves
-    std::vector<ID> get_leaf_ids() const { return tree_ptr->leaf_ids(); }
+    std::vector<ID> get_leaf_ids() const { return get_leaf_ids(*tree_ptr); }
+    std::vector<ID> get_leaf_ids(const lotto::EventRateTree<ID>& tree) const { return tree.leaf_ids(); }
 
     // Returns the rates of the tree leaves
-    std::vector<double> get_leaf_rates() const { return tree_ptr->leaf_rates(); }
+    std::vector<double> get_leaf_rates() const { return get_leaf_rates(*tree_ptr); }
+    std::vector<double> get_leaf_rates(const lotto::EventRateTree<ID>& tree) const { return tree.leaf_rates(); }
 
     // Returns the cumulative rates of the tree leaves
     std::vector<double> get_cumulative_leaf_rates() const
@@ -146,6 +150,42 @@ TEST_F(EventRateTreeTest, Construct)
     }
 }
 
+TEST_F(EventRateTreeTest, ConstructFromRange)
+{
+    // Checks that a tree built from iterator ranges that are not vectors matches one built from vectors
+    std::list<ID> id_list(init_ids.begin(), init_ids.end());
+    lotto::EventRateTree<ID> range_tree(id_list.begin(), id_list.end(), init_rates.data());
+    EXPECT_EQ(get_leaf_ids(range_tree), get_leaf_ids());
+    EXPECT_EQ(get_leaf_rates(range_tree), get_leaf_rates());
+    EXPECT_EQ(range_tree.total_rate(), tree_ptr->total_rate());
+    for (const ID& id : init_ids)
+    {
+        EXPECT_EQ(range_tree.get_rate(id), tree_ptr->get_rate(id));
+    }
+}
+
+TEST_F(EventRateTreeTest, SharedEventIndex)
+{
+    // Checks that a tree sharing the event index of another tree uses the same index, but keeps its own rates
+    std::vector<double> other_rates(n_events, 1.0);
+    lotto::EventRateTree<ID> shared_tree(init_ids.begin(), init_ids.end(), other_rates.begin(),
+                                         tree_ptr->event_index());
+    EXPECT_EQ(shared_tree.event_index(), tree_ptr->event_index());
+    EXPECT_DOUBLE_EQ(shared_tree.total_rate(), n_events);
+    shared_tree.update_rate(init_ids[0], 2.0);
+    EXPECT_EQ(shared_tree.get_rate(init_ids[0]), 2.0);
+    EXPECT_EQ(tree_ptr->get_rate(init_ids[0]), init_rates[0]);
+
+    EXPECT_THROW(lotto::EventRateTree<ID>(init_ids.begin(), init_ids.end() - 1, other_rates.begin(),
+                                          tree_ptr->event_index()),
+                 std::runtime_error);
+
+    // A null index is built anew
+    lotto::EventRateTree<ID> unshared_tree(init_ids.begin(), init_ids.end(), other_rates.begin(), nullptr);
+    EXPECT_NE(unshared_tree.event_index(), tree_ptr->event_index());
+    EXPECT_EQ(*unshared_tree.event_index(), *tree_ptr->event_index());
+}
+
 TEST_F(EventRateTreeTest, TotalRate)
 {
     // Checks that the total rate returned is correct
@@ -167,11 +207,34 @@ TEST_F(EventRateTreeTest, UpdateRate)
 
         tree_ptr->update_rate(id_to_update, new_rate);
         EXPECT_EQ(new_rate, get_leaf_rates()[leaf_ix]);
+        EXPECT_EQ(new_rate, tree_ptr->get_rate(id_to_update));
         double new_total_rate = tree_ptr->total_rate();
         EXPECT_DOUBLE_EQ(new_total_rate, old_total_rate + delta_rate);
     }
 }
 
+TEST_F(EventRateTreeTest, UnchangedRate)
+{
+    // Checks that updating an event to its current rate leaves the tree unchanged
+    double old_total_rate = tree_ptr->total_rate();
+    for (int i = 0; i < n_events; ++i)
+    {
+        EXPECT_FALSE(tree_ptr->update_rate(init_ids[i], init_rates[i]));
+        EXPECT_EQ(tree_ptr->get_rate(init_ids[i]), init_rates[i]);
+    }
+    EXPECT_EQ(tree_ptr->total_rate(), old_total_rate);
+    EXPECT_TRUE(tree_ptr->update_rate(init_ids[0], init_rates[0] + 1.0));
+}
+
+TEST_F(EventRateTreeTest, PathLength)
+{
+    // Checks that the path from a leaf to the root has one node per level, for any number of events
+    EXPECT_EQ(tree_ptr->path_length(), 11);
+    EXPECT_EQ(lotto::EventRateTree<ID>({1}, {1.0}).path_length(), 1);
+    EXPECT_EQ(lotto::EventRateTree<ID>({1, 2}, {1.0, 1.0}).path_length(), 2);
+    EXPECT_EQ(lotto::EventRateTree<ID>({1, 2, 3}, {1.0, 1.0, 1.0}).path_length(), 3);
+}
+
 TEST_F(EventRateTreeTest, RandomQuery)
 {
     // Check thats querying the tree returns the correct event ID, based on the cumulative rates
@@ -212,6 +275,44 @@ TEST_F(EventRateTreeTest, EdgeQuery)
     }
 }
 
+TEST_F(EventRateTreeTest, ZeroRateSubtreeQuery)
+{
+    // Checks that a query value rounded past the rate of a left child is not passed to a right subtree with no rate,
+    // so an event with zero rate is never selected
+    // Querying the total rate goes right at the root, where 0.1 + 0.2 - 0.1 rounds to just above 0.2
+    lotto::EventRateTree<ID> tree({1, 2, 3, 4}, {0.1, 0.0, 0.2, 0.0});
+    ASSERT_GT(tree.total_rate() - 0.1, 0.2);
+    EXPECT_EQ(tree.query_tree(tree.total_rate()), 3);
+}
+
+TEST_F(EventRateTreeTest, SaveAndLoadState)
+{
+    // Checks that a tree restored from a snapshot has the same rates and sums, and answers queries the same way
+    for (int i = 0; i < n_events; i += 3)
+    {
+        tree_ptr->update_rate(init_ids[i], generator.sample_unit_interval());
+    }
+    std::stringstream snapshot;
+    tree_ptr->save_state(snapshot);
+
+    lotto::EventRateTree<ID> restored_tree(init_ids, std::vector<double>(n_events, 0.0));
+    restored_tree.load_state(snapshot);
+    EXPECT_EQ(restored_tree.total_rate(), tree_ptr->total_rate());
+    for (const ID& id : init_ids)
+    {
+        EXPECT_EQ(restored_tree.get_rate(id), tree_ptr->get_rate(id));
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        double query_value = tree_ptr->total_rate() * generator.sample_unit_interval();
+        EXPECT_EQ(restored_tree.query_tree(query_value), tree_ptr->query_tree(query_value));
+    }
+
+    std::stringstream small_snapshot;
+    lotto::EventRateTree<ID>({init_ids[0]}, {1.0}).save_state(small_snapshot);
+    EXPECT_THROW(restored_tree.load_state(small_snapshot), std::runtime_error);
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
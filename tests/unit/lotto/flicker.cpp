@@ -0,0 +1,185 @@
+#include "rate_calculators.hpp"
+#include "statistics.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/flicker.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+class FlickerAcceleratedEventSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+    using SelectorType = lotto::FlickerAcceleratedEventSelector<ID, ListedRateCalculator<ID>>;
+
+    void SetUp() override
+    {
+        // Two fast events flicker back and forth, and one slow event escapes
+        calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+        calculator_ptr->set_rate(fast_id_a, fast_rate);
+        calculator_ptr->set_rate(fast_id_b, fast_rate);
+        calculator_ptr->set_rate(slow_id, slow_rate);
+        event_ids = {fast_id_a, fast_id_b, slow_id};
+        for (const ID& id : event_ids)
+        {
+            impact_table[id] = {id};
+        }
+
+        // Only the two fast events together count as trapped, so the slow event is never scaled
+        lotto::FlickerParameters parameters;
+        parameters.window_size = 20;
+        parameters.max_distinct_events = 2;
+        parameters.scale_factor = 0.1;
+        selector_ptr = std::make_unique<SelectorType>(calculator_ptr, event_ids, impact_table, parameters);
+        selector_ptr->reseed_generator(TEST_SEED);
+    }
+
+    // Run until the slow event is selected, returning the number of selections and the time taken
+    std::pair<int, double> run_until_escape(SelectorType& selector)
+    {
+        int n_selections = 0;
+        double time = 0.0;
+        ID selected_event_id = fast_id_a;
+        while (selected_event_id != slow_id)
+        {
+            auto event_and_time = selector.select_event();
+            selected_event_id = event_and_time.first;
+            time += event_and_time.second;
+            ++n_selections;
+        }
+        return std::make_pair(n_selections, time);
+    }
+
+    const ID fast_id_a = 0;
+    const ID fast_id_b = 1;
+    const ID slow_id = 2;
+    const double fast_rate = 1000.0;
+    const double slow_rate = 1.0;
+
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> impact_table;
+    std::shared_ptr<ListedRateCalculator<ID>> calculator_ptr;
+    std::unique_ptr<SelectorType> selector_ptr;
+};
+
+TEST_F(FlickerAcceleratedEventSelectorTest, Construct)
+{
+    // Checks if FlickerAcceleratedEventSelector can be constructed, and rejects invalid parameters
+    lotto::FlickerParameters parameters;
+    parameters.window_size = 0;
+    EXPECT_THROW(SelectorType(calculator_ptr, event_ids, impact_table, parameters), std::runtime_error);
+    parameters = lotto::FlickerParameters();
+    parameters.scale_factor = 2.0;
+    EXPECT_THROW(SelectorType(calculator_ptr, event_ids, impact_table, parameters), std::runtime_error);
+    parameters = lotto::FlickerParameters();
+    parameters.min_scale_factor = 2.0;
+    EXPECT_THROW(SelectorType(calculator_ptr, event_ids, impact_table, parameters), std::runtime_error);
+}
+
+TEST_F(FlickerAcceleratedEventSelectorTest, ScaleAndRestore)
+{
+    // Checks that flickering events have their rates lowered, and that rates are restored after escape
+    lotto::FlickerParameters parameters;
+    parameters.window_size = 10;
+    parameters.max_distinct_events = 2;
+    parameters.scale_factor = 0.5;
+    SelectorType selector(calculator_ptr, event_ids, impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+
+    // The slow event is very unlikely to be selected in the first window
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_NE(selector.select_event().first, slow_id);
+    }
+    EXPECT_EQ(selector.get_n_detections(), 1);
+    EXPECT_EQ(selector.n_scaled_events(), 2);
+    EXPECT_DOUBLE_EQ(selector.get_scale_factor(fast_id_a), 0.5);
+    EXPECT_DOUBLE_EQ(selector.get_scale_factor(fast_id_b), 0.5);
+    EXPECT_DOUBLE_EQ(selector.get_scale_factor(slow_id), 1.0);
+
+    run_until_escape(selector);
+    EXPECT_EQ(selector.get_n_escapes(), 1);
+    EXPECT_EQ(selector.n_scaled_events(), 0);
+    EXPECT_DOUBLE_EQ(selector.get_scale_factor(fast_id_a), 1.0);
+}
+
+TEST_F(FlickerAcceleratedEventSelectorTest, MinimumScaleFactor)
+{
+    // Checks that scale factors never drop below the minimum
+    lotto::FlickerParameters parameters;
+    parameters.window_size = 10;
+    parameters.scale_factor = 0.1;
+    parameters.min_scale_factor = 0.05;
+    calculator_ptr->set_rate(slow_id, 0.0);
+    SelectorType selector(calculator_ptr, event_ids, impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    for (int i = 0; i < 100; ++i)
+    {
+        selector.select_event();
+    }
+    EXPECT_DOUBLE_EQ(selector.get_scale_factor(fast_id_a), 0.05);
+    EXPECT_DOUBLE_EQ(selector.get_scale_factor(fast_id_b), 0.05);
+}
+
+TEST_F(FlickerAcceleratedEventSelectorTest, EscapeTime)
+{
+    // Checks that the time taken to escape still follows the rate of the escape event,
+    // while far fewer selections are needed than without acceleration
+    int n_samples = 2000;
+    std::vector<double> escape_time_samples(n_samples);
+    std::vector<double> n_selection_samples(n_samples);
+    for (int i = 0; i < n_samples; ++i)
+    {
+        auto n_selections_and_time = run_until_escape(*selector_ptr);
+        n_selection_samples[i] = n_selections_and_time.first;
+        escape_time_samples[i] = n_selections_and_time.second;
+    }
+    check_samples_from_log_inverse_distribution(1.0 / slow_rate, escape_time_samples);
+
+    // Without acceleration the expected number of selections would be about fast_rate * 2 / slow_rate
+    EXPECT_LT(mean(n_selection_samples), 0.25 * 2.0 * fast_rate / slow_rate);
+    EXPECT_GT(selector_ptr->get_n_escapes(), 0);
+}
+
+TEST_F(FlickerAcceleratedEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot, taken while rates are lowered and part of a window has been
+    // recorded, carries out the same events as the original
+    lotto::FlickerParameters parameters;
+    parameters.window_size = 10;
+    parameters.max_distinct_events = 2;
+    parameters.scale_factor = 0.5;
+    SelectorType selector(calculator_ptr, event_ids, impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    for (int i = 0; i < 15; ++i)
+    {
+        ASSERT_NE(selector.select_event().first, slow_id);
+    }
+    ASSERT_EQ(selector.n_scaled_events(), 2);
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    SelectorType restored_selector(calculator_ptr, event_ids, impact_table, parameters);
+    restored_selector.load_state(snapshot);
+    EXPECT_DOUBLE_EQ(restored_selector.get_scale_factor(fast_id_a), 0.5);
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.get_n_detections(), selector.get_n_detections());
+    EXPECT_EQ(restored_selector.get_n_escapes(), selector.get_n_escapes());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "statistics.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/hybrid.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+class HybridEventSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        // Set up event ID list
+        event_ids = hashed_sequence(n_events);
+
+        // Set up impact tables
+        std::vector<ID> even_event_ids;
+        for (int i = 0; i < n_events; ++i)
+        {
+            ID id = event_ids[i];
+            neighbor_impact_table[id] = {id, event_ids[(i + 1) % n_events]};
+            if (id % 2 == 0)
+            {
+                even_event_ids.push_back(id);
+            }
+        }
+        for (const ID& id : even_event_ids)
+        {
+            even_only_impact_table[id] = even_event_ids;
+        }
+
+        parameters.evaluation_interval = 100;
+    }
+
+    // Returns whether the stale events of a selector are empty
+    template <typename RateCalculatorType>
+    static bool has_stale_events(const lotto::HybridEventSelector<ID, RateCalculatorType>& selector)
+    {
+        return !selector.stale_events.empty();
+    }
+
+    // Event ID list and impact tables
+    int n_events = 1000;
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    std::map<ID, std::vector<ID>> even_only_impact_table;
+
+    // Switching settings
+    lotto::HybridParameters parameters;
+};
+
+TEST_F(HybridEventSelectorTest, Construct)
+{
+    // Checks if HybridEventSelector can be constructed, and rejects invalid settings
+    auto calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(1.0);
+    lotto::HybridEventSelector<ID, UniformRateCalculator<ID>> selector(calculator_ptr, 1.0, event_ids,
+                                                                       neighbor_impact_table, parameters);
+    EXPECT_FALSE(selector.is_using_rejection());
+    parameters.evaluation_interval = 0;
+    EXPECT_THROW((lotto::HybridEventSelector<ID, UniformRateCalculator<ID>>(calculator_ptr, 1.0, event_ids,
+                                                                            neighbor_impact_table, parameters)),
+                 std::runtime_error);
+}
+
+TEST_F(HybridEventSelectorTest, SwitchToRejection)
+{
+    // Checks that rejection is chosen when every rate equals the upper bound
+    auto calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(1.0);
+    lotto::HybridEventSelector<ID, UniformRateCalculator<ID>> selector(calculator_ptr, 1.0, event_ids,
+                                                                       neighbor_impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    for (lotto::UIntType i = 0; i < 2 * parameters.evaluation_interval; ++i)
+    {
+        selector.select_event();
+    }
+    EXPECT_TRUE(selector.is_using_rejection());
+    EXPECT_EQ(selector.get_n_switches(), 1);
+}
+
+TEST_F(HybridEventSelectorTest, StayRejectionFree)
+{
+    // Checks that rejection-free is kept when only one event has a nonzero rate
+    auto calculator_ptr = std::make_shared<OneHotRateCalculator<ID>>(event_ids[0]);
+    lotto::HybridEventSelector<ID, OneHotRateCalculator<ID>> selector(calculator_ptr, 1.0, event_ids,
+                                                                      neighbor_impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    for (lotto::UIntType i = 0; i < 5 * parameters.evaluation_interval; ++i)
+    {
+        EXPECT_EQ(selector.select_event().first, event_ids[0]);
+    }
+    EXPECT_FALSE(selector.is_using_rejection());
+    EXPECT_EQ(selector.get_n_switches(), 0);
+}
+
+TEST_F(HybridEventSelectorTest, SwitchBackWithStaleRates)
+{
+    // Checks that rates changed while in rejection mode are updated in the tree on switching back
+
+    // Every even event impacts all even events, so rejection is chosen while rates are uniform
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    lotto::HybridEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, 1.0, event_ids,
+                                                                   even_only_impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    while (!selector.is_using_rejection())
+    {
+        selector.select_event();
+    }
+
+    // Select until an even event is accepted in rejection mode, then shut off even events
+    while (selector.select_event().first % 2 != 0)
+    {
+    }
+    ASSERT_TRUE(selector.is_using_rejection());
+    ASSERT_TRUE(has_stale_events(selector));
+    calculator_ptr->set_even_rate(0.0);
+
+    // Half of the attempts are now rejected and no events have impacts, so rejection-free is chosen again
+    while (selector.is_using_rejection())
+    {
+        EXPECT_EQ(selector.select_event().first % 2, 1);
+    }
+    EXPECT_FALSE(has_stale_events(selector));
+    for (lotto::UIntType i = 0; i < 5 * parameters.evaluation_interval; ++i)
+    {
+        EXPECT_EQ(selector.select_event().first % 2, 1);
+    }
+    EXPECT_FALSE(selector.is_using_rejection());
+}
+
+TEST_F(HybridEventSelectorTest, AverageTimeStep)
+{
+    // Checks if the average time step is correct in both modes
+    auto calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(0.5);
+    lotto::HybridEventSelector<ID, UniformRateCalculator<ID>> selector(calculator_ptr, 1.0, event_ids,
+                                                                       neighbor_impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    int n_samples = 10000;
+    std::vector<double> time_step_samples(n_samples);
+    for (int i = 0; i < n_samples; ++i)
+    {
+        time_step_samples[i] = selector.select_event().second;
+    }
+    check_samples_from_log_inverse_distribution(1.0 / (event_ids.size() * 0.5), time_step_samples);
+}
+
+TEST_F(HybridEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot, taken in rejection mode with stale rates, carries out the same
+    // events as the original, and that a snapshot that fails to load part way through leaves it unchanged
+    using SelectorType = lotto::HybridEventSelector<ID, EvenOddRateCalculator>;
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    SelectorType selector(calculator_ptr, 1.0, event_ids, even_only_impact_table, parameters);
+    selector.reseed_generator(TEST_SEED);
+    while (!selector.is_using_rejection())
+    {
+        selector.select_event();
+    }
+    while (selector.select_event().first % 2 != 0)
+    {
+    }
+    ASSERT_TRUE(has_stale_events(selector));
+    calculator_ptr->set_even_rate(0.0);
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    SelectorType restored_selector(calculator_ptr, 1.0, event_ids, even_only_impact_table, parameters);
+    restored_selector.load_state(snapshot);
+    EXPECT_TRUE(restored_selector.is_using_rejection());
+    std::stringstream small_snapshot;
+    SelectorType(calculator_ptr, 1.0, {event_ids[0], event_ids[1]}, even_only_impact_table, parameters)
+        .save_state(small_snapshot);
+    EXPECT_THROW(restored_selector.load_state(small_snapshot), std::runtime_error);
+
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.get_n_switches(), selector.get_n_switches());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <lotto/impact_provider.hpp>
+#include <memory>
+#include <vector>
+
+class ImpactProviderTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        auto impact_table_ptr = std::make_shared<std::map<ID, std::vector<ID>>>();
+        for (ID id = 0; id < n_sites; ++id)
+        {
+            (*impact_table_ptr)[id] = neighbors(id);
+        }
+        map_provider_ptr = std::make_unique<lotto::MapImpactProvider<ID>>(impact_table_ptr);
+    }
+
+    // Site and its nearest neighbors on a periodic chain, except for the last site which impacts nothing
+    std::vector<ID> neighbors(ID id) const
+    {
+        if (id == n_sites - 1)
+        {
+            return {};
+        }
+        return {(id + n_sites - 1) % n_sites, id, (id + 1) % n_sites};
+    }
+
+    int n_sites = 10;
+    std::unique_ptr<lotto::MapImpactProvider<ID>> map_provider_ptr;
+};
+
+TEST_F(ImpactProviderTest, MapImpactProvider)
+{
+    // Checks that impacted events are viewed in place in the table, and that null tables are rejected
+    for (ID id = 0; id < n_sites - 1; ++id)
+    {
+        lotto::ImpactedEvents<ID> impacted_events = map_provider_ptr->impacted_events(id);
+        EXPECT_EQ(std::vector<ID>(impacted_events.begin(), impacted_events.end()), neighbors(id));
+        EXPECT_EQ(impacted_events.data(), map_provider_ptr->impacted_events(id).data());
+    }
+    EXPECT_TRUE(map_provider_ptr->impacted_events(n_sites - 1).empty());
+    EXPECT_TRUE(map_provider_ptr->impacted_events(n_sites).empty());
+    EXPECT_THROW(lotto::MapImpactProvider<ID>(nullptr), std::runtime_error);
+}
+
+TEST_F(ImpactProviderTest, FunctionImpactProvider)
+{
+    // Checks that impacted events are generated by the function, including when there are none
+    auto provider = lotto::make_function_impact_provider<ID>([this](const ID& id, std::vector<ID>& impacted_events) {
+        std::vector<ID> id_neighbors = neighbors(id);
+        impacted_events.insert(impacted_events.end(), id_neighbors.begin(), id_neighbors.end());
+    });
+    for (ID id = 0; id < n_sites - 1; ++id)
+    {
+        lotto::ImpactedEvents<ID> impacted_events = provider.impacted_events(id);
+        ASSERT_EQ(impacted_events.size(), 3);
+        EXPECT_EQ(std::vector<ID>(impacted_events.begin(), impacted_events.end()), neighbors(id));
+    }
+    EXPECT_TRUE(provider.impacted_events(n_sites - 1).empty());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,101 @@
+#include "lotto/random.hpp"
+#include "test_parameters.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <lotto/indexed_priority_queue.hpp>
+#include <memory>
+
+class IndexedPriorityQueueTest : public testing::Test
+{
+protected:
+    using Index = lotto::IndexedPriorityQueue::Index;
+
+    void SetUp() override
+    {
+        // Reseed generator for testing
+        generator.reseed_generator(TEST_SEED);
+
+        // Set up initial keys
+        for (int i = 0; i < n_elements; ++i)
+        {
+            init_keys.push_back(generator.sample_unit_interval());
+        }
+
+        // Set up queue
+        queue_ptr = std::make_unique<lotto::IndexedPriorityQueue>(init_keys);
+    }
+
+    // Random generator
+    lotto::RandomGenerator generator;
+
+    // Pointer to queue
+    std::unique_ptr<lotto::IndexedPriorityQueue> queue_ptr;
+
+    // Number of elements and their initial keys
+    int n_elements = 1000;
+    std::vector<double> init_keys;
+
+    // Checks that the heap order holds and that positions are consistent
+    void check_heap() const
+    {
+        const auto& heap = queue_ptr->heap;
+        for (Index heap_ix = 0; heap_ix < static_cast<Index>(heap.size()); ++heap_ix)
+        {
+            EXPECT_EQ(queue_ptr->heap_positions[heap[heap_ix]], heap_ix);
+            if (heap_ix > 0)
+            {
+                EXPECT_LE(queue_ptr->heap_key(queue_ptr->parent(heap_ix)), queue_ptr->heap_key(heap_ix));
+            }
+        }
+    }
+
+    // Returns the element with the smallest key, found by searching all keys
+    Index smallest_element(const std::vector<double>& keys) const
+    {
+        return std::min_element(keys.begin(), keys.end()) - keys.begin();
+    }
+};
+
+TEST_F(IndexedPriorityQueueTest, Construct)
+{
+    // Checks construction and heap order
+    EXPECT_EQ(queue_ptr->size(), n_elements);
+    for (Index element = 0; element < n_elements; ++element)
+    {
+        EXPECT_EQ(queue_ptr->get_key(element), init_keys[element]);
+    }
+    check_heap();
+    EXPECT_EQ(queue_ptr->top(), smallest_element(init_keys));
+    EXPECT_EQ(queue_ptr->top_key(), init_keys[queue_ptr->top()]);
+}
+
+TEST_F(IndexedPriorityQueueTest, SingleElement)
+{
+    // Checks that a queue with a single element works
+    lotto::IndexedPriorityQueue single_queue({3.0});
+    EXPECT_EQ(single_queue.top(), 0);
+    single_queue.update_key(0, 1.0);
+    EXPECT_EQ(single_queue.top_key(), 1.0);
+}
+
+TEST_F(IndexedPriorityQueueTest, UpdateKey)
+{
+    // Checks that the smallest element is correct after many random updates, including to infinity
+    std::vector<double> keys = init_keys;
+    int n_updates = 10000;
+    for (int i = 0; i < n_updates; ++i)
+    {
+        Index element = generator.sample_integer_range(n_elements - 1);
+        double new_key = (i % 10 == 0) ? std::numeric_limits<double>::infinity() : generator.sample_unit_interval();
+        keys[element] = new_key;
+        queue_ptr->update_key(element, new_key);
+        EXPECT_EQ(queue_ptr->top_key(), keys[smallest_element(keys)]);
+    }
+    check_heap();
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,233 @@
+#define LOTTO_ENABLE_INSTRUMENTATION
+
+#include "rate_calculators.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/flicker.hpp>
+#include <lotto/hybrid.hpp>
+#include <lotto/instrumentation.hpp>
+#include <lotto/next_reaction.hpp>
+#include <lotto/rate_class.hpp>
+#include <lotto/rejection.hpp>
+#include <lotto/rejection_free.hpp>
+#include <lotto/split.hpp>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+class InstrumentationTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        // Set up events, each impacting itself and the next event
+        for (ID id = 0; id < n_events; ++id)
+        {
+            event_ids.push_back(id);
+            impact_table[id] = {id, (id + 1) % n_events};
+        }
+    }
+
+    // Events and impact table
+    int n_events = 100;
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> impact_table;
+
+    // Number of nodes on each path from a leaf to the root, for a tree of 100 events
+    int tree_path_length = 8;
+
+    // Number of selections to make
+    int n_steps = 1000;
+};
+
+TEST_F(InstrumentationTest, Enabled)
+{
+    // Checks that defining the macro before including any header enables instrumentation, and that the selectors
+    // are declared in the instrumented namespace, so their symbols differ from those of uninstrumented builds
+    EXPECT_TRUE(lotto::instrumentation_enabled);
+    EXPECT_TRUE((std::is_same<lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator>,
+                              lotto::instrumented::RejectionFreeEventSelector<ID, EvenOddRateCalculator>>::value));
+}
+
+TEST_F(InstrumentationTest, RejectionFree)
+{
+    // Checks the number of calls recorded for each phase, and the impact and tree node counts
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> selector(
+        std::make_shared<EvenOddRateCalculator>(1.0, 1.0), event_ids, impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.run_steps(n_steps, [](const ID&, double) {});
+
+    // Impacts of the last selection are not updated until the next one
+    const lotto::SelectorInstrumentation& instrumentation = selector.get_instrumentation();
+    int n_impact_updates = n_steps - 1;
+    EXPECT_EQ(instrumentation.selection.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.tree_query.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.random_sampling.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.impact_update.n_calls, n_impact_updates);
+    EXPECT_EQ(instrumentation.rate_calculation.n_calls, 2 * n_impact_updates);
+    EXPECT_EQ(instrumentation.tree_update.n_calls, 2 * n_impact_updates);
+    EXPECT_EQ(instrumentation.n_impacted_events, 2 * n_impact_updates);
+    EXPECT_DOUBLE_EQ(instrumentation.average_impact_length(), 2.0);
+
+    // Rates never change, so only queries touch tree nodes
+    EXPECT_EQ(instrumentation.n_tree_nodes_touched, n_steps * tree_path_length);
+    EXPECT_GT(instrumentation.selection.n_cycles, 0);
+    EXPECT_GE(instrumentation.selection.n_cycles, instrumentation.impact_update.n_cycles);
+    EXPECT_GE(instrumentation.impact_update.n_cycles, instrumentation.rate_calculation.n_cycles);
+
+    selector.reset_instrumentation();
+    EXPECT_EQ(selector.get_instrumentation().selection.n_calls, 0);
+    EXPECT_EQ(selector.get_instrumentation().selection.n_cycles, 0);
+    EXPECT_EQ(selector.get_instrumentation().average_impact_length(), 0.0);
+}
+
+TEST_F(InstrumentationTest, RejectionFreeChangedRates)
+{
+    // Checks that tree updates which change a rate touch every node on the path to the root
+    auto calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+    for (ID id : event_ids)
+    {
+        calculator_ptr->set_rate(id, 1.0);
+    }
+    lotto::RejectionFreeEventSelector<ID, ListedRateCalculator<ID>> selector(calculator_ptr, event_ids,
+                                                                              impact_table);
+    selector.reseed_generator(TEST_SEED);
+    for (ID id : event_ids)
+    {
+        calculator_ptr->set_rate(id, 2.0);
+    }
+    selector.recalculate_rates(event_ids);
+    EXPECT_EQ(selector.get_instrumentation().tree_update.n_calls, n_events);
+    EXPECT_EQ(selector.get_instrumentation().n_tree_nodes_touched, n_events * tree_path_length);
+}
+
+TEST_F(InstrumentationTest, Rejection)
+{
+    // Checks that every attempt is counted as a rate calculation and a random sample
+    lotto::RejectionEventSelector<ID, UniformRateCalculator<ID>> selector(
+        std::make_shared<UniformRateCalculator<ID>>(1.0), 4.0, event_ids);
+    selector.reseed_generator(TEST_SEED);
+    selector.run_steps(n_steps, [](const ID&, double) {});
+
+    const lotto::SelectorInstrumentation& instrumentation = selector.get_instrumentation();
+    EXPECT_EQ(instrumentation.selection.n_calls, n_steps);
+    EXPECT_GT(instrumentation.rate_calculation.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.rate_calculation.n_calls, selector.get_statistics().n_attempts);
+    EXPECT_EQ(instrumentation.random_sampling.n_calls, selector.get_statistics().n_attempts);
+    EXPECT_EQ(instrumentation.tree_query.n_calls, 0);
+    EXPECT_EQ(instrumentation.impact_update.n_calls, 0);
+}
+
+TEST_F(InstrumentationTest, NextReaction)
+{
+    // Checks that updates of the priority queue are counted as tree updates, and finding the earliest event as a query
+    lotto::NextReactionEventSelector<ID, EvenOddRateCalculator> selector(
+        std::make_shared<EvenOddRateCalculator>(1.0, 1.0), event_ids, impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.run_steps(n_steps, [](const ID&, double) {});
+
+    // Every event draws an initial time, then only the last selected event draws a new one, since rates never change
+    const lotto::SelectorInstrumentation& instrumentation = selector.get_instrumentation();
+    int n_impact_updates = n_steps - 1;
+    EXPECT_EQ(instrumentation.selection.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.tree_query.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.impact_update.n_calls, n_impact_updates);
+    EXPECT_EQ(instrumentation.rate_calculation.n_calls, 2 * n_impact_updates);
+    EXPECT_EQ(instrumentation.n_impacted_events, 2 * n_impact_updates);
+    EXPECT_EQ(instrumentation.random_sampling.n_calls, n_events + n_impact_updates);
+    EXPECT_EQ(instrumentation.tree_update.n_calls, n_events + n_impact_updates);
+
+    selector.reset_instrumentation();
+    EXPECT_EQ(selector.get_instrumentation().selection.n_calls, 0);
+}
+
+TEST_F(InstrumentationTest, RateClass)
+{
+    // Checks that selecting a class is counted as a tree query, and that unchanged rates never move events
+    lotto::RateClassEventSelector<ID, EvenOddRateCalculator> selector(
+        std::make_shared<EvenOddRateCalculator>(1.0, 1.0), event_ids, impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.run_steps(n_steps, [](const ID&, double) {});
+
+    const lotto::SelectorInstrumentation& instrumentation = selector.get_instrumentation();
+    int n_impact_updates = n_steps - 1;
+    EXPECT_EQ(instrumentation.selection.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.tree_query.n_calls, n_steps);
+    EXPECT_EQ(instrumentation.random_sampling.n_calls, 2 * n_steps);
+    EXPECT_EQ(instrumentation.impact_update.n_calls, n_impact_updates);
+    EXPECT_EQ(instrumentation.rate_calculation.n_calls, 2 * n_impact_updates);
+    EXPECT_EQ(instrumentation.tree_update.n_calls, 0);
+    EXPECT_EQ(instrumentation.n_tree_nodes_touched,
+              n_steps * lotto::EventRateTree<std::size_t>({0}, {1.0}).path_length());
+
+    selector.reset_instrumentation();
+    EXPECT_EQ(selector.get_instrumentation().tree_query.n_calls, 0);
+}
+
+TEST_F(InstrumentationTest, Split)
+{
+    // Checks the counts for a tree family of even events and a rejection family of odd events
+    lotto::EventFamily<ID> even_family;
+    lotto::EventFamily<ID> odd_family;
+    odd_family.rate_upper_bound = 2.0;
+    for (ID id : event_ids)
+    {
+        (id % 2 == 0 ? even_family : odd_family).event_ids.push_back(id);
+    }
+    lotto::SplitEventSelector<ID, EvenOddRateCalculator> selector(
+        std::make_shared<EvenOddRateCalculator>(1.0, 1.0), {even_family, odd_family}, impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.run_steps(n_steps, [](const ID&, double) {});
+
+    // Every attempt draws two samples, and attempts in the rejection family calculate the candidate's rate
+    // Each selection impacts one event of each family, and only the even one is updated in its tree
+    const lotto::SelectorInstrumentation& instrumentation = selector.get_instrumentation();
+    int n_impact_updates = n_steps - 1;
+    lotto::UIntType n_attempts = instrumentation.random_sampling.n_calls / 2;
+    lotto::UIntType n_rejection_attempts = n_attempts - instrumentation.tree_query.n_calls;
+    EXPECT_EQ(instrumentation.selection.n_calls, n_steps);
+    EXPECT_GT(instrumentation.tree_query.n_calls, 0);
+    EXPECT_GT(n_rejection_attempts, 0);
+    EXPECT_EQ(instrumentation.impact_update.n_calls, n_impact_updates);
+    EXPECT_EQ(instrumentation.n_impacted_events, 2 * n_impact_updates);
+    EXPECT_EQ(instrumentation.tree_update.n_calls, n_impact_updates);
+    EXPECT_EQ(instrumentation.rate_calculation.n_calls, n_impact_updates + n_rejection_attempts);
+
+    selector.reset_instrumentation();
+    EXPECT_EQ(selector.get_instrumentation().random_sampling.n_calls, 0);
+}
+
+TEST_F(InstrumentationTest, HybridAndFlicker)
+{
+    // Checks that composite selectors report the statistics of the selectors they use
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    lotto::HybridParameters hybrid_parameters;
+    hybrid_parameters.evaluation_interval = 100;
+    lotto::HybridEventSelector<ID, EvenOddRateCalculator> hybrid_selector(calculator_ptr, 4.0, event_ids,
+                                                                          impact_table, hybrid_parameters);
+    hybrid_selector.reseed_generator(TEST_SEED);
+    hybrid_selector.run_steps(n_steps, [](const ID&, double) {});
+    lotto::SelectorInstrumentation hybrid_instrumentation = hybrid_selector.get_instrumentation();
+    EXPECT_EQ(hybrid_instrumentation.selection.n_calls, n_steps);
+    EXPECT_GT(hybrid_instrumentation.tree_query.n_calls, 0);
+    hybrid_selector.reset_instrumentation();
+    EXPECT_EQ(hybrid_selector.get_instrumentation().selection.n_calls, 0);
+
+    lotto::FlickerAcceleratedEventSelector<ID, EvenOddRateCalculator> flicker_selector(calculator_ptr, event_ids,
+                                                                                       impact_table);
+    flicker_selector.reseed_generator(TEST_SEED);
+    flicker_selector.run_steps(n_steps, [](const ID&, double) {});
+    EXPECT_EQ(flicker_selector.get_instrumentation().selection.n_calls, n_steps);
+    EXPECT_EQ(flicker_selector.get_instrumentation().tree_query.n_calls, n_steps);
+    flicker_selector.reset_instrumentation();
+    EXPECT_EQ(flicker_selector.get_instrumentation().selection.n_calls, 0);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,245 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "statistics.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/next_reaction.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+class NextReactionEventSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        // Set up event ID list
+        event_ids = hashed_sequence(n_events);
+
+        // Set up impact tables
+        std::map<ID, std::vector<ID>> neighbor_impact_table;
+        std::vector<ID> even_event_ids;
+        for (int i = 0; i < n_events; ++i)
+        {
+            ID id = event_ids[i];
+            complete_impact_table[id] = event_ids;
+            neighbor_impact_table[id] = {id, event_ids[(i + 1) % n_events]};
+            if (id % 2 == 0)
+            {
+                even_event_ids.push_back(id);
+            }
+        }
+        std::map<ID, std::vector<ID>> even_only_impact_table;
+        for (const ID& id : even_event_ids)
+        {
+            even_only_impact_table[id] = even_event_ids;
+        }
+
+        // Set up rate calculators
+        one_hot_calculator_ptr = std::make_shared<OneHotRateCalculator<ID>>(event_ids[0]);
+        uniform_calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(1.0);
+        even_odd_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+
+        // Set up event selectors
+        one_hot_selector_ptr = std::make_unique<lotto::NextReactionEventSelector<ID, OneHotRateCalculator<ID>>>(
+            one_hot_calculator_ptr, event_ids, neighbor_impact_table);
+        uniform_selector_ptr = std::make_unique<lotto::NextReactionEventSelector<ID, UniformRateCalculator<ID>>>(
+            uniform_calculator_ptr, event_ids, complete_impact_table);
+        even_odd_selector_ptr = std::make_unique<lotto::NextReactionEventSelector<ID, EvenOddRateCalculator>>(
+            even_odd_calculator_ptr, event_ids, even_only_impact_table);
+
+        // Reseed selector generators for testing
+        one_hot_selector_ptr->reseed_generator(TEST_SEED);
+        uniform_selector_ptr->reseed_generator(TEST_SEED);
+        even_odd_selector_ptr->reseed_generator(TEST_SEED);
+    }
+
+    // Event ID list and complete impact table
+    int n_events = 1000;
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> complete_impact_table;
+
+    // Rate calculator pointers
+    std::shared_ptr<OneHotRateCalculator<ID>> one_hot_calculator_ptr;
+    std::shared_ptr<UniformRateCalculator<ID>> uniform_calculator_ptr;
+    std::shared_ptr<EvenOddRateCalculator> even_odd_calculator_ptr;
+
+    // Event selectors, stored with pointers because they have no default constructor
+    std::unique_ptr<lotto::NextReactionEventSelector<ID, OneHotRateCalculator<ID>>> one_hot_selector_ptr;
+    std::unique_ptr<lotto::NextReactionEventSelector<ID, UniformRateCalculator<ID>>> uniform_selector_ptr;
+    std::unique_ptr<lotto::NextReactionEventSelector<ID, EvenOddRateCalculator>> even_odd_selector_ptr;
+};
+
+TEST_F(NextReactionEventSelectorTest, Construct)
+{
+    // Checks if NextReactionEventSelector can be constructed
+}
+
+TEST_F(NextReactionEventSelectorTest, CorrectEventSelection)
+{
+    // Checks if the correct event is selected when only one event is allowed
+    for (const ID& expected_event_id : event_ids)
+    {
+        one_hot_calculator_ptr->set_hot_id(expected_event_id);
+        auto event_and_time = one_hot_selector_ptr->select_event();
+        ID selected_event_id = event_and_time.first;
+        EXPECT_EQ(selected_event_id, expected_event_id);
+    }
+}
+
+TEST_F(NextReactionEventSelectorTest, AverageTimeStep)
+{
+    // Checks if the average time step is correct when all events have the same rate
+
+    // Loop over different rates r0
+    int n_rates = 10;
+    double rate_step = 0.5;
+    int n_samples = 10000;
+    for (int i = 1; i <= n_rates; ++i)
+    {
+        double r0 = i * rate_step;
+        uniform_calculator_ptr->set_rate(r0);
+
+        // Sample time steps
+        std::vector<double> time_step_samples(n_samples);
+        for (int j = 0; j < n_samples; ++j)
+        {
+            auto event_and_time = uniform_selector_ptr->select_event();
+            time_step_samples[j] = event_and_time.second;
+        }
+        check_samples_from_log_inverse_distribution(1.0 / (event_ids.size() * r0), time_step_samples);
+    }
+}
+
+TEST_F(NextReactionEventSelectorTest, EvenOddEventSelection)
+{
+    // Checks for expected behavior in case where all events have the same rate
+    // until an even event ID is chosen, at which point the rates of the even
+    // events are set to zero
+
+    // Select events until an even one is selected
+    ID selected_event_id = 1;
+    while (selected_event_id % 2 != 0)
+    {
+        auto event_and_time = even_odd_selector_ptr->select_event();
+        selected_event_id = event_and_time.first;
+    }
+
+    // Shut off even events
+    even_odd_calculator_ptr->set_even_rate(0.0);
+
+    // Make sure only odd events are selected now
+    int n_checks = 100;
+    for (int i = 0; i < n_checks; ++i)
+    {
+        auto event_and_time = even_odd_selector_ptr->select_event();
+        selected_event_id = event_and_time.first;
+        EXPECT_EQ(selected_event_id % 2, 1);
+    }
+}
+
+TEST_F(NextReactionEventSelectorTest, SelectionFrequency)
+{
+    // Checks that events are selected in proportion to their rates, after rates change
+    // (so that rescaled times are used) and after being turned off and on again
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    lotto::NextReactionEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, event_ids,
+                                                                         complete_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.select_event();
+    calculator_ptr->set_even_rate(0.0);
+    selector.select_event();
+    calculator_ptr->set_even_rate(3.0);
+    selector.select_event();
+
+    int n_samples = 100000;
+    std::vector<double> is_even_samples(n_samples);
+    for (int i = 0; i < n_samples; ++i)
+    {
+        is_even_samples[i] = selector.select_event().first % 2 == 0 ? 1.0 : 0.0;
+    }
+
+    // Event IDs are multiples of 7, so half of them are even
+    double expected_even_fraction = 3.0 / (3.0 + 1.0);
+    double standard_deviation = std::sqrt(expected_even_fraction * (1.0 - expected_even_fraction));
+    check_deviation_of_mean(mean(is_even_samples), expected_even_fraction,
+                            standard_error_of_mean(standard_deviation, n_samples), TEST_SIGMA);
+}
+
+TEST_F(NextReactionEventSelectorTest, RescaledTimes)
+{
+    // Checks that rescaling the rate of every event keeps the selection order and scales the time steps
+    auto reference_calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(2.0);
+    auto rescaled_calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(1.0);
+    std::map<ID, std::vector<ID>> self_impact_table;
+    for (const ID& id : event_ids)
+    {
+        self_impact_table[id] = {id};
+    }
+    lotto::NextReactionEventSelector<ID, UniformRateCalculator<ID>> reference_selector(reference_calculator_ptr,
+                                                                                       event_ids, self_impact_table);
+    lotto::NextReactionEventSelector<ID, UniformRateCalculator<ID>> rescaled_selector(rescaled_calculator_ptr,
+                                                                                      event_ids, complete_impact_table);
+    reference_selector.reseed_generator(TEST_SEED);
+    rescaled_selector.reseed_generator(TEST_SEED);
+
+    // Rates double after the first selection for the rescaled selector, halving every remaining waiting time
+    auto reference_first = reference_selector.select_event();
+    auto rescaled_first = rescaled_selector.select_event();
+    EXPECT_EQ(reference_first.first, rescaled_first.first);
+    EXPECT_DOUBLE_EQ(2.0 * reference_first.second, rescaled_first.second);
+    rescaled_calculator_ptr->set_rate(2.0);
+    EXPECT_EQ(reference_selector.select_event().first, rescaled_selector.select_event().first);
+}
+
+TEST_F(NextReactionEventSelectorTest, RunUntil)
+{
+    // Checks that the number of events carried out over consecutive intervals matches the total rate
+    double interval = 0.5;
+    int n_intervals = 100;
+    lotto::UIntType n_total_steps = 0;
+    for (int i = 1; i <= n_intervals; ++i)
+    {
+        n_total_steps += uniform_selector_ptr->run_until(i * interval, [](const ID&, double) {});
+        EXPECT_LE(uniform_selector_ptr->get_elapsed_time(), i * interval);
+    }
+    double expected_n_steps = n_events * n_intervals * interval;
+    check_deviation_of_mean(n_total_steps, expected_n_steps, std::sqrt(expected_n_steps), TEST_SIGMA);
+}
+
+TEST_F(NextReactionEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot, taken before the impacts of the last selected event are
+    // applied, carries out the same events as the original
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 3.0);
+    lotto::NextReactionEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, event_ids,
+                                                                         complete_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.run_steps(100, [](const ID&, double) {});
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    lotto::NextReactionEventSelector<ID, EvenOddRateCalculator> restored_selector(calculator_ptr, event_ids,
+                                                                                  complete_impact_table);
+    restored_selector.load_state(snapshot);
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
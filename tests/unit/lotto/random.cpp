@@ -1,8 +1,13 @@
 #include "statistics.hpp"
 #include "test_parameters.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <gtest/gtest.h>
+#include <limits>
 #include <lotto/random.hpp>
+#include <random>
+#include <sstream>
+#include <string>
 #include <vector>
 
 class RandomGeneratorTest : public testing::Test
@@ -76,6 +81,61 @@ TEST_F(RandomGeneratorTest, UnitIntervalSamples)
     check_samples_from_uniform_distribution(min_value, max_value, samples);
 }
 
+TEST_F(RandomGeneratorTest, PoissonSamples)
+{
+    // Checks that values from sample_poisson have the expected mean
+    generator.reseed_generator(TEST_SEED); // fixed seed for testing
+    EXPECT_EQ(generator.sample_poisson(0.0), 0);
+    int n_samples = 1000000;
+    for (double true_mean : {0.5, 20.0, 1e6})
+    {
+        std::vector<double> samples(n_samples);
+        for (int i = 0; i < n_samples; ++i)
+        {
+            samples[i] = generator.sample_poisson(true_mean);
+        }
+        double true_standard_deviation = std::sqrt(true_mean);
+        check_deviation_of_mean(mean(samples), true_mean, standard_error_of_mean(true_standard_deviation, n_samples),
+                                TEST_SIGMA);
+    }
+}
+
+TEST_F(RandomGeneratorTest, SaveAndLoadState)
+{
+    // Checks that a generator restored from a snapshot continues with the same values, and has the same seed
+    generator.reseed_generator(TEST_SEED);
+    for (int i = 0; i < 100; ++i)
+    {
+        generator.sample_unit_interval();
+    }
+    std::stringstream snapshot;
+    generator.save_state(snapshot);
+
+    // The generator state is stored as binary words, with room for the tag, seed, and counts
+    EXPECT_LE(snapshot.str().size(), (std::mt19937_64::state_size + 8) * sizeof(std::uint64_t));
+
+    lotto::RandomGenerator restored_generator;
+    restored_generator.load_state(snapshot);
+    EXPECT_EQ(restored_generator.get_seed(), generator.get_seed());
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(restored_generator.sample_unit_interval(), generator.sample_unit_interval());
+        EXPECT_EQ(restored_generator.sample_integer_range(1000), generator.sample_integer_range(1000));
+    }
+
+    std::stringstream empty_snapshot;
+    EXPECT_THROW(restored_generator.load_state(empty_snapshot), std::runtime_error);
+
+    // A corrupt state size fails as a truncated snapshot, without allocating the claimed size
+    std::string corrupt_snapshot = snapshot.str();
+    std::uint64_t corrupt_size = std::numeric_limits<std::uint64_t>::max() / 2;
+    corrupt_snapshot.replace(8 + sizeof(lotto::UIntType), sizeof(corrupt_size),
+                             reinterpret_cast<const char*>(&corrupt_size), sizeof(corrupt_size));
+    std::stringstream corrupt_stream(corrupt_snapshot);
+    EXPECT_THROW(restored_generator.load_state(corrupt_stream), std::runtime_error);
+    EXPECT_EQ(restored_generator.get_seed(), generator.get_seed());
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -1,6 +1,10 @@
 #ifndef RATE_CALCULATORS_H
 #define RATE_CALCULATORS_H
 
+#include <cmath>
+#include <map>
+#include <set>
+
 /*
  * Rate calculator that returns the same rate for every event id
  */
@@ -72,4 +76,94 @@ private:
     double odd_rate;
 };
 
+/*
+ * Rate calculator that stores a rate for every event id (starting from the same rate), reports which
+ * event ids have changed since they were last calculated, and counts its calls
+ */
+template <typename EventIDType>
+class ChangeAwareRateCalculator
+{
+public:
+    ChangeAwareRateCalculator(double initial_rate) : initial_rate(initial_rate), n_calculations(0) {}
+    double calculate_rate(const EventIDType& event_id)
+    {
+        ++n_calculations;
+        changed_ids.erase(event_id);
+        return get_rate(event_id);
+    }
+    bool has_rate_changed(const EventIDType& event_id) const { return changed_ids.count(event_id) != 0; }
+    double get_rate(const EventIDType& event_id) const
+    {
+        auto rate_it = rates.find(event_id);
+        return rate_it == rates.end() ? initial_rate : rate_it->second;
+    }
+    void set_rate(const EventIDType& event_id, double new_rate)
+    {
+        rates[event_id] = new_rate;
+        changed_ids.insert(event_id);
+    }
+    int get_n_calculations() const { return n_calculations; }
+
+private:
+    double initial_rate;
+    std::map<EventIDType, double> rates;
+    std::set<EventIDType> changed_ids;
+    int n_calculations;
+};
+
+/*
+ * Rate calculator whose rates depend only on a local environment, given by the event id
+ * modulo the number of environments, and that counts its calls
+ */
+class EnvironmentRateCalculator
+{
+public:
+    EnvironmentRateCalculator(int n_environments) : n_environments(n_environments), n_calculations(0) {}
+    double calculate_rate(const int& event_id)
+    {
+        ++n_calculations;
+        return 1.0 + environment_key(event_id);
+    }
+    unsigned long environment_key(const int& event_id) const { return event_id % n_environments; }
+    int get_n_calculations() const { return n_calculations; }
+
+private:
+    int n_environments;
+    int n_calculations;
+};
+
+/*
+ * Rate calculator whose rates span several orders of magnitude, decreasing tenfold
+ * with each step of the event id modulo the number of decades
+ */
+class SkewedRateCalculator
+{
+public:
+    SkewedRateCalculator(int n_decades) : n_decades(n_decades) {}
+    double calculate_rate(const int& event_id) const { return std::pow(10.0, -(event_id % n_decades)); }
+    int get_n_decades() const { return n_decades; }
+
+private:
+    int n_decades;
+};
+
+/*
+ * Rate calculator that returns a separately set rate for each event id,
+ * and a rate of 0 for any event id that has not been set
+ */
+template <typename EventIDType>
+class ListedRateCalculator
+{
+public:
+    double calculate_rate(const EventIDType& event_id) const
+    {
+        auto rate_it = rates.find(event_id);
+        return rate_it == rates.end() ? 0.0 : rate_it->second;
+    }
+    void set_rate(const EventIDType& event_id, double new_rate) { rates[event_id] = new_rate; }
+
+private:
+    std::map<EventIDType, double> rates;
+};
+
 #endif
@@ -0,0 +1,289 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "statistics.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/rate_class.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+class RateClassEventSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+
+    void SetUp() override
+    {
+        // Set up event ID list
+        event_ids = hashed_sequence(n_events);
+
+        // Set up impact tables
+        std::map<ID, std::vector<ID>> neighbor_impact_table;
+        std::vector<ID> even_event_ids;
+        for (int i = 0; i < n_events; ++i)
+        {
+            ID id = event_ids[i];
+            complete_impact_table[id] = event_ids;
+            neighbor_impact_table[id] = {id, event_ids[(i + 1) % n_events]};
+            if (id % 2 == 0)
+            {
+                even_event_ids.push_back(id);
+            }
+        }
+        std::map<ID, std::vector<ID>> even_only_impact_table;
+        for (const ID& id : even_event_ids)
+        {
+            even_only_impact_table[id] = even_event_ids;
+        }
+
+        // Set up rate calculators
+        one_hot_calculator_ptr = std::make_shared<OneHotRateCalculator<ID>>(event_ids[0]);
+        uniform_calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(1.0);
+        even_odd_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+
+        // Set up event selectors
+        one_hot_selector_ptr = std::make_unique<lotto::RateClassEventSelector<ID, OneHotRateCalculator<ID>>>(
+            one_hot_calculator_ptr, event_ids, neighbor_impact_table);
+        uniform_selector_ptr = std::make_unique<lotto::RateClassEventSelector<ID, UniformRateCalculator<ID>>>(
+            uniform_calculator_ptr, event_ids, complete_impact_table);
+        even_odd_selector_ptr = std::make_unique<lotto::RateClassEventSelector<ID, EvenOddRateCalculator>>(
+            even_odd_calculator_ptr, event_ids, even_only_impact_table);
+
+        // Reseed selector generators for testing
+        one_hot_selector_ptr->reseed_generator(TEST_SEED);
+        uniform_selector_ptr->reseed_generator(TEST_SEED);
+        even_odd_selector_ptr->reseed_generator(TEST_SEED);
+    }
+
+    // Event ID list and complete impact table
+    int n_events = 1000;
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> complete_impact_table;
+
+    // Rate calculator pointers
+    std::shared_ptr<OneHotRateCalculator<ID>> one_hot_calculator_ptr;
+    std::shared_ptr<UniformRateCalculator<ID>> uniform_calculator_ptr;
+    std::shared_ptr<EvenOddRateCalculator> even_odd_calculator_ptr;
+
+    // Event selectors, stored with pointers because they have no default constructor
+    std::unique_ptr<lotto::RateClassEventSelector<ID, OneHotRateCalculator<ID>>> one_hot_selector_ptr;
+    std::unique_ptr<lotto::RateClassEventSelector<ID, UniformRateCalculator<ID>>> uniform_selector_ptr;
+    std::unique_ptr<lotto::RateClassEventSelector<ID, EvenOddRateCalculator>> even_odd_selector_ptr;
+};
+
+TEST_F(RateClassEventSelectorTest, Construct)
+{
+    // Checks if RateClassEventSelector can be constructed
+}
+
+TEST_F(RateClassEventSelectorTest, CorrectEventSelection)
+{
+    // Checks if the correct event is selected when only one event is allowed
+    for (const ID& expected_event_id : event_ids)
+    {
+        one_hot_calculator_ptr->set_hot_id(expected_event_id);
+        auto event_and_time = one_hot_selector_ptr->select_event();
+        ID selected_event_id = event_and_time.first;
+        EXPECT_EQ(selected_event_id, expected_event_id);
+    }
+}
+
+TEST_F(RateClassEventSelectorTest, AverageTimeStep)
+{
+    // Checks if the average time step is correct when all events have the same rate
+
+    // Loop over different rates r0
+    int n_rates = 10;
+    double rate_step = 0.5;
+    int n_samples = 10000;
+    for (int i = 1; i <= n_rates; ++i)
+    {
+        double r0 = i * rate_step;
+        uniform_calculator_ptr->set_rate(r0);
+
+        // Sample time steps
+        std::vector<double> time_step_samples(n_samples);
+        for (int j = 0; j < n_samples; ++j)
+        {
+            auto event_and_time = uniform_selector_ptr->select_event();
+            time_step_samples[j] = event_and_time.second;
+        }
+        check_samples_from_log_inverse_distribution(1.0 / (event_ids.size() * r0), time_step_samples);
+    }
+}
+
+TEST_F(RateClassEventSelectorTest, EvenOddEventSelection)
+{
+    // Checks for expected behavior in case where all events have the same rate
+    // until an even event ID is chosen, at which point the rates of the even
+    // events are set to zero
+
+    // Select events until an even one is selected
+    ID selected_event_id = 1;
+    while (selected_event_id % 2 != 0)
+    {
+        auto event_and_time = even_odd_selector_ptr->select_event();
+        selected_event_id = event_and_time.first;
+    }
+
+    // Shut off even events
+    even_odd_calculator_ptr->set_even_rate(0.0);
+
+    // Make sure only odd events are selected now
+    int n_checks = 100;
+    for (int i = 0; i < n_checks; ++i)
+    {
+        auto event_and_time = even_odd_selector_ptr->select_event();
+        selected_event_id = event_and_time.first;
+        EXPECT_EQ(selected_event_id % 2, 1);
+    }
+}
+
+TEST_F(RateClassEventSelectorTest, SelectionFrequency)
+{
+    // Checks that events are selected in proportion to their rates, after all events have moved
+    // to a new rate class and back again
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    lotto::RateClassEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, event_ids,
+                                                                         complete_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    selector.select_event();
+    calculator_ptr->set_even_rate(0.0);
+    selector.select_event();
+    calculator_ptr->set_even_rate(3.0);
+    selector.select_event();
+
+    int n_samples = 100000;
+    std::vector<double> is_even_samples(n_samples);
+    for (int i = 0; i < n_samples; ++i)
+    {
+        is_even_samples[i] = selector.select_event().first % 2 == 0 ? 1.0 : 0.0;
+    }
+
+    // Event IDs are multiples of 7, so half of them are even
+    double expected_even_fraction = 3.0 / (3.0 + 1.0);
+    double standard_deviation = std::sqrt(expected_even_fraction * (1.0 - expected_even_fraction));
+    check_deviation_of_mean(mean(is_even_samples), expected_even_fraction,
+                            standard_error_of_mean(standard_deviation, n_samples), TEST_SIGMA);
+}
+
+TEST_F(RateClassEventSelectorTest, RateClassCount)
+{
+    // Checks that events are grouped into one class per distinct rate, and that empty classes are released
+    EXPECT_EQ(uniform_selector_ptr->n_rate_classes(), 1);
+
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    lotto::RateClassEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, event_ids,
+                                                                      complete_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    EXPECT_EQ(selector.n_rate_classes(), 1);
+
+    // Each selection updates every rate, so class counts follow the calculator one selection later
+    selector.select_event();
+    calculator_ptr->set_even_rate(0.0);
+    selector.select_event();
+    EXPECT_EQ(selector.n_rate_classes(), 2);
+    calculator_ptr->set_even_rate(1.0);
+    selector.select_event();
+    EXPECT_EQ(selector.n_rate_classes(), 1);
+    calculator_ptr->set_even_rate(2.0);
+    selector.select_event();
+    EXPECT_EQ(selector.n_rate_classes(), 2);
+}
+
+TEST_F(RateClassEventSelectorTest, ManyRateClasses)
+{
+    // Checks selection as the number of classes grows past the initial capacity of the tree of class totals,
+    // and after most classes are emptied again
+    auto calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+    for (const ID& id : event_ids)
+    {
+        calculator_ptr->set_rate(id, 1.0);
+    }
+    lotto::RateClassEventSelector<ID, ListedRateCalculator<ID>> selector(calculator_ptr, event_ids,
+                                                                         complete_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    EXPECT_EQ(selector.n_rate_classes(), 1);
+
+    int n_distinct_rates = 50;
+    for (int i = 0; i < n_distinct_rates; ++i)
+    {
+        calculator_ptr->set_rate(event_ids[i], i + 2.0);
+    }
+    selector.select_event();
+    selector.select_event();
+    EXPECT_EQ(selector.n_rate_classes(), n_distinct_rates + 1);
+
+    ID hot_id = event_ids[3];
+    for (const ID& id : event_ids)
+    {
+        calculator_ptr->set_rate(id, id == hot_id ? 1.0 : 0.0);
+    }
+    selector.select_event();
+    EXPECT_EQ(selector.n_rate_classes(), 2);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(selector.select_event().first, hot_id);
+    }
+}
+
+TEST_F(RateClassEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot, taken after classes have been emptied and reused and while
+    // impacted rates are pending, carries out the same events as the original
+    auto calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+    for (int i = 0; i < n_events; ++i)
+    {
+        calculator_ptr->set_rate(event_ids[i], 1.0 + i % 5);
+    }
+    lotto::RateClassEventSelector<ID, ListedRateCalculator<ID>> selector(calculator_ptr, event_ids,
+                                                                         complete_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    for (int i = 0; i < n_events; ++i)
+    {
+        calculator_ptr->set_rate(event_ids[i], 1.0 + i % 3);
+    }
+    selector.run_steps(10, [](const ID&, double) {});
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    lotto::RateClassEventSelector<ID, ListedRateCalculator<ID>> restored_selector(calculator_ptr, event_ids,
+                                                                                  complete_impact_table);
+    restored_selector.load_state(snapshot);
+    EXPECT_EQ(restored_selector.n_rate_classes(), 3);
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+
+    // Snapshots of a different set of events are rejected, leaving the selector unchanged
+    std::stringstream small_snapshot;
+    lotto::RateClassEventSelector<ID, ListedRateCalculator<ID>>(calculator_ptr, {event_ids[0]}, complete_impact_table)
+        .save_state(small_snapshot);
+    EXPECT_THROW(restored_selector.load_state(small_snapshot), std::runtime_error);
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+}
+
+TEST_F(RateClassEventSelectorTest, DuplicateEventIDs)
+{
+    // Checks that constructing with repeated event IDs throws
+    std::vector<ID> duplicate_event_ids = {event_ids[0], event_ids[1], event_ids[0]};
+    EXPECT_THROW((lotto::RateClassEventSelector<ID, UniformRateCalculator<ID>>(
+                     uniform_calculator_ptr, duplicate_event_ids, complete_impact_table)),
+                 std::runtime_error);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -5,6 +5,8 @@
 #include <gtest/gtest.h>
 #include <lotto/rejection.hpp>
 #include <memory>
+#include <sstream>
+#include <vector>
 
 class RejectionEventSelectorTest : public testing::Test
 {
@@ -52,6 +54,20 @@ protected:
         uniform_selector_ptr->reseed_generator(TEST_SEED);
         return;
     }
+
+    // Returns the event ID list stored by a selector
+    template <typename RateCalculatorType>
+    const std::vector<ID>& get_event_id_list(const lotto::RejectionEventSelector<ID, RateCalculatorType>& selector) const
+    {
+        return selector.event_id_list;
+    }
+
+    // Returns the number of events in a selector's index from event ID to list position
+    template <typename RateCalculatorType>
+    std::size_t get_event_index_size(const lotto::RejectionEventSelector<ID, RateCalculatorType>& selector) const
+    {
+        return selector.event_to_list_index.size();
+    }
 };
 
 TEST_F(RejectionEventSelectorTest, Construct)
@@ -98,6 +114,211 @@ TEST_F(RejectionEventSelectorTest, AverageTimeStep)
     }
 }
 
+TEST_F(RejectionEventSelectorTest, Statistics)
+{
+    // Checks that attempts and acceptances are counted consistently
+    int n_selections = 100;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        one_hot_selector_ptr->select_event();
+    }
+    const auto& statistics = one_hot_selector_ptr->get_statistics();
+    EXPECT_EQ(statistics.n_acceptances, n_selections);
+    EXPECT_GE(statistics.n_attempts, statistics.n_acceptances);
+    EXPECT_GE(statistics.max_attempts_per_selection, 1);
+    EXPECT_LE(statistics.max_attempts_per_selection, statistics.n_attempts);
+    EXPECT_DOUBLE_EQ(statistics.acceptance_ratio(), (double)n_selections / statistics.n_attempts);
+
+    // With all rates at the upper bound, every attempt should be accepted
+    for (int i = 0; i < n_selections; ++i)
+    {
+        uniform_selector_ptr->select_event();
+    }
+    EXPECT_EQ(uniform_selector_ptr->get_statistics().n_attempts, n_selections);
+    EXPECT_EQ(uniform_selector_ptr->get_statistics().max_attempts_per_selection, 1);
+
+    // Reset counters
+    one_hot_selector_ptr->reset_statistics();
+    EXPECT_EQ(one_hot_selector_ptr->get_statistics().n_attempts, 0);
+    EXPECT_EQ(one_hot_selector_ptr->get_statistics().n_acceptances, 0);
+    EXPECT_EQ(one_hot_selector_ptr->get_statistics().max_attempts_per_selection, 0);
+}
+
+TEST_F(RejectionEventSelectorTest, RejectionLimitThrows)
+{
+    // Checks that an exception is thrown once the rejection limit is reached when no event can be accepted
+    one_hot_calculator_ptr->set_hot_id(-1);
+    lotto::UIntType rejection_limit = 1000;
+    one_hot_selector_ptr->set_rejection_limit(rejection_limit);
+    EXPECT_THROW(one_hot_selector_ptr->select_event(), std::runtime_error);
+    EXPECT_EQ(one_hot_selector_ptr->get_statistics().n_attempts, rejection_limit);
+    EXPECT_EQ(one_hot_selector_ptr->get_statistics().n_acceptances, 0);
+}
+
+TEST_F(RejectionEventSelectorTest, RejectionLimitCallback)
+{
+    // Checks that the callback is invoked every time the rejection limit is reached
+    one_hot_calculator_ptr->set_hot_id(-1);
+    lotto::UIntType rejection_limit = 100;
+    std::size_t n_callbacks_before_abort = 5;
+    std::vector<lotto::UIntType> reported_rejections;
+    one_hot_selector_ptr->set_rejection_limit(rejection_limit, [&](lotto::UIntType n_rejections) {
+        reported_rejections.push_back(n_rejections);
+        if (reported_rejections.size() == n_callbacks_before_abort)
+        {
+            throw std::logic_error("Abort selection");
+        }
+    });
+    EXPECT_THROW(one_hot_selector_ptr->select_event(), std::logic_error);
+    ASSERT_EQ(reported_rejections.size(), n_callbacks_before_abort);
+    for (std::size_t i = 0; i < n_callbacks_before_abort; ++i)
+    {
+        EXPECT_EQ(reported_rejections[i], (i + 1) * rejection_limit);
+    }
+
+    // Disabling the limit should allow selection to proceed normally again
+    one_hot_selector_ptr->set_rejection_limit(0);
+    one_hot_calculator_ptr->set_hot_id(event_id_list[0]);
+    EXPECT_EQ(one_hot_selector_ptr->select_event().first, event_id_list[0]);
+}
+
+TEST_F(RejectionEventSelectorTest, AddAndRemoveEvents)
+{
+    // Checks that events can be added and removed, and that only current candidates are selected
+    ID new_event_id = -7;
+    EXPECT_FALSE(uniform_selector_ptr->contains_event(new_event_id));
+    uniform_selector_ptr->add_event(new_event_id);
+    EXPECT_TRUE(uniform_selector_ptr->contains_event(new_event_id));
+    EXPECT_EQ(uniform_selector_ptr->n_events(), n_events + 1);
+    EXPECT_THROW(uniform_selector_ptr->add_event(new_event_id), std::runtime_error);
+
+    // Remove all even events
+    std::vector<ID> remaining_event_ids;
+    for (const ID& id : event_id_list)
+    {
+        if (id % 2 == 0)
+        {
+            uniform_selector_ptr->remove_event(id);
+            EXPECT_FALSE(uniform_selector_ptr->contains_event(id));
+        }
+        else
+        {
+            remaining_event_ids.push_back(id);
+        }
+    }
+    remaining_event_ids.push_back(new_event_id);
+    EXPECT_EQ(uniform_selector_ptr->n_events(), remaining_event_ids.size());
+    EXPECT_THROW(uniform_selector_ptr->remove_event(event_id_list[0]), std::runtime_error);
+
+    int n_selections = 1000;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        ID selected_event_id = uniform_selector_ptr->select_event().first;
+        EXPECT_TRUE(selected_event_id % 2 != 0);
+    }
+
+    // Remove everything, selection should then fail
+    for (const ID& id : remaining_event_ids)
+    {
+        uniform_selector_ptr->remove_event(id);
+    }
+    EXPECT_EQ(uniform_selector_ptr->n_events(), 0);
+    EXPECT_THROW(uniform_selector_ptr->select_event(), std::runtime_error);
+}
+
+TEST_F(RejectionEventSelectorTest, MoveEventIDList)
+{
+    // Checks that an event ID list passed as an rvalue is moved into the selector, rather than copied
+    std::vector<ID> moved_event_id_list = event_id_list;
+    const ID* event_id_data = moved_event_id_list.data();
+    lotto::RejectionEventSelector<ID, UniformRateCalculator<ID>> selector(uniform_calculator_ptr, 1.0,
+                                                                          std::move(moved_event_id_list));
+    EXPECT_EQ(get_event_id_list(selector).data(), event_id_data);
+    EXPECT_EQ(selector.n_events(), n_events);
+    for (const ID& id : event_id_list)
+    {
+        EXPECT_TRUE(selector.contains_event(id));
+    }
+}
+
+TEST_F(RejectionEventSelectorTest, LazyEventIndex)
+{
+    // Checks that the index of event positions is only built once events are looked up, added or removed
+    uniform_selector_ptr->run_steps(100, [](const ID&, double) {});
+    EXPECT_EQ(get_event_index_size(*uniform_selector_ptr), 0);
+    EXPECT_TRUE(uniform_selector_ptr->contains_event(event_id_list[0]));
+    EXPECT_EQ(get_event_index_size(*uniform_selector_ptr), n_events);
+    uniform_selector_ptr->remove_event(event_id_list[0]);
+    EXPECT_EQ(get_event_index_size(*uniform_selector_ptr), n_events - 1);
+}
+
+TEST_F(RejectionEventSelectorTest, DuplicateEventIDs)
+{
+    // Checks that duplicate event IDs are detected once the event index is built, leaving it unbuilt
+    std::vector<ID> duplicate_event_id_list{0, 7, 0};
+    lotto::RejectionEventSelector<ID, UniformRateCalculator<ID>> selector(uniform_calculator_ptr, 1.0,
+                                                                          duplicate_event_id_list);
+    EXPECT_THROW(selector.contains_event(7), std::runtime_error);
+    EXPECT_EQ(get_event_index_size(selector), 0);
+    EXPECT_THROW(selector.add_event(3), std::runtime_error);
+    EXPECT_THROW(selector.remove_event(7), std::runtime_error);
+    EXPECT_EQ(selector.n_events(), 3);
+}
+
+TEST_F(RejectionEventSelectorTest, StaticInterface)
+{
+    // Checks that the selector is detected as an event selector at compile time, unlike a rate calculator
+    static_assert(lotto::is_event_selector<lotto::RejectionEventSelector<ID, UniformRateCalculator<ID>>>::value);
+    static_assert(!lotto::is_event_selector<UniformRateCalculator<ID>>::value);
+}
+
+TEST_F(RejectionEventSelectorTest, RunSteps)
+{
+    // Checks that running a number of steps carries out that many events, each of them the only allowed one
+    int n_steps = 100;
+    int n_applied = 0;
+    double applied_time = 0.0;
+    one_hot_selector_ptr->run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        EXPECT_EQ(event_id, event_id_list[0]);
+        applied_time += time_step;
+        ++n_applied;
+    });
+    EXPECT_EQ(n_applied, n_steps);
+    EXPECT_DOUBLE_EQ(one_hot_selector_ptr->get_elapsed_time(), applied_time);
+}
+
+TEST_F(RejectionEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot carries out the same events as the original,
+    // including events removed before the snapshot was taken, and keeps its statistics
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(0.2, 1.0);
+    lotto::RejectionEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, 1.0, event_id_list);
+    selector.reseed_generator(TEST_SEED);
+    selector.remove_event(event_id_list[0]);
+    selector.run_steps(100, [](const ID&, double) {});
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    lotto::RejectionEventSelector<ID, EvenOddRateCalculator> restored_selector(calculator_ptr, 1.0, event_id_list);
+    restored_selector.load_state(snapshot);
+    EXPECT_FALSE(restored_selector.contains_event(event_id_list[0]));
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+    EXPECT_EQ(restored_selector.get_statistics().n_attempts, selector.get_statistics().n_attempts);
+    EXPECT_EQ(restored_selector.get_statistics().max_attempts_per_selection,
+              selector.get_statistics().max_attempts_per_selection);
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -4,8 +4,11 @@
 #include "test_parameters.hpp"
 #include <atomic>
 #include <gtest/gtest.h>
+#include <limits>
+#include <list>
 #include <lotto/rejection_free.hpp>
 #include <memory>
+#include <sstream>
 #include <vector>
 
 class RejectionFreeEventSelectorTest : public testing::Test
@@ -76,6 +79,29 @@ protected:
     std::unique_ptr<lotto::RejectionFreeEventSelector<ID, UniformRateCalculator<ID>>> uniform_selector_ptr;
     std::unique_ptr<lotto::RejectionFreeEventSelector<ID, UniformRateCalculator<ID>>> uniform_no_impact_selector_ptr;
     std::unique_ptr<lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator>> even_odd_selector_ptr;
+
+    // Reseeds the generator of any selector for testing
+    template <typename RateCalculatorType>
+    void reseed_for_testing(lotto::RejectionFreeEventSelector<ID, RateCalculatorType>& selector)
+    {
+        selector.reseed_generator(TEST_SEED);
+    }
+
+    // Returns the events impacted by a given event, according to a selector's impact provider
+    template <typename RateCalculatorType>
+    lotto::ImpactedEvents<ID> get_impacted_events(lotto::RejectionFreeEventSelector<ID, RateCalculatorType>& selector,
+                                                  const ID& event_id) const
+    {
+        return selector.impact_provider.impacted_events(event_id);
+    }
+
+    // Returns the rate of an event stored in a selector's tree
+    template <typename RateCalculatorType>
+    double get_stored_rate(const lotto::RejectionFreeEventSelector<ID, RateCalculatorType>& selector,
+                           const ID& event_id) const
+    {
+        return selector.event_rate_tree.get_rate(event_id);
+    }
 };
 
 TEST_F(RejectionFreeEventSelectorTest, Construct)
@@ -83,6 +109,75 @@ TEST_F(RejectionFreeEventSelectorTest, Construct)
     // Checks if RejectionFreeEventSelector can be constructed
 }
 
+TEST_F(RejectionFreeEventSelectorTest, MoveImpactTable)
+{
+    // Checks that an impact table passed as an rvalue is moved into the selector, rather than copied
+    std::map<ID, std::vector<ID>> impact_table;
+    for (int i = 0; i < n_events; ++i)
+    {
+        impact_table[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+    }
+    const ID* impacted_events_data = impact_table.at(event_ids[0]).data();
+    lotto::RejectionFreeEventSelector<ID, OneHotRateCalculator<ID>> selector(one_hot_calculator_ptr, event_ids,
+                                                                              std::move(impact_table));
+    EXPECT_EQ(get_impacted_events(selector, event_ids[0]).data(), impacted_events_data);
+
+    // Selection matches a selector with a copied impact table
+    reseed_for_testing(selector);
+    for (int i = 0; i < 100; ++i)
+    {
+        one_hot_calculator_ptr->set_hot_id(event_ids[i]);
+        EXPECT_EQ(selector.select_event(), one_hot_selector_ptr->select_event());
+    }
+}
+
+TEST_F(RejectionFreeEventSelectorTest, ConstructFromRanges)
+{
+    // Checks that a selector built from iterator ranges calculates each rate once, and selects the same events as
+    // one built from lists, whether its rates are calculated or given
+    auto calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_events);
+    auto reference_calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_events);
+    std::list<ID> id_list(event_ids.begin(), event_ids.end());
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    std::vector<double> rates;
+    for (int i = 0; i < n_events; ++i)
+    {
+        neighbor_impact_table[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+        rates.push_back(1.0 + event_ids[i] % n_events);
+    }
+    auto impact_table_ptr = std::make_shared<const std::map<ID, std::vector<ID>>>(neighbor_impact_table);
+    using ProviderType = lotto::MapImpactProvider<ID>;
+
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator> reference_selector(
+        reference_calculator_ptr, event_ids, neighbor_impact_table);
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator> selector(
+        calculator_ptr, id_list.begin(), id_list.end(), ProviderType(impact_table_ptr));
+    EXPECT_EQ(calculator_ptr->get_n_calculations(), n_events);
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator> given_rates_selector(
+        calculator_ptr, id_list.begin(), id_list.end(), rates.data(), rates.data() + n_events,
+        ProviderType(impact_table_ptr));
+    EXPECT_EQ(calculator_ptr->get_n_calculations(), n_events);
+
+    reseed_for_testing(reference_selector);
+    reseed_for_testing(selector);
+    reseed_for_testing(given_rates_selector);
+    for (int i = 0; i < 100; ++i)
+    {
+        auto reference_event_and_time = reference_selector.select_event();
+        EXPECT_EQ(selector.select_event(), reference_event_and_time);
+        EXPECT_EQ(given_rates_selector.select_event(), reference_event_and_time);
+    }
+
+    std::list<ID> empty_id_list;
+    EXPECT_THROW((lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator>(
+                     calculator_ptr, empty_id_list.begin(), empty_id_list.end(), ProviderType(impact_table_ptr))),
+                 std::runtime_error);
+    EXPECT_THROW((lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator>(
+                     calculator_ptr, id_list.begin(), id_list.end(), rates.data(), rates.data() + n_events - 1,
+                     ProviderType(impact_table_ptr))),
+                 std::runtime_error);
+}
+
 TEST_F(RejectionFreeEventSelectorTest, CorrectEventSelection)
 {
     // Checks if the correct event is selected when only one event is allowed
@@ -156,6 +251,452 @@ TEST_F(RejectionFreeEventSelectorTest, EvenOddEventSelection)
     }
 }
 
+TEST_F(RejectionFreeEventSelectorTest, ChangeAwareRateCalculator)
+{
+    // Checks that rates reported as unchanged by the calculator are not recalculated
+    std::map<ID, std::vector<ID>> complete_impact_table;
+    for (const ID& id : event_ids)
+    {
+        complete_impact_table[id] = event_ids;
+    }
+    auto change_aware_calculator_ptr = std::make_shared<ChangeAwareRateCalculator<ID>>(1.0);
+    lotto::RejectionFreeEventSelector<ID, ChangeAwareRateCalculator<ID>> change_aware_selector(
+        change_aware_calculator_ptr, event_ids, complete_impact_table);
+    int n_initial_calculations = change_aware_calculator_ptr->get_n_calculations();
+    EXPECT_EQ(n_initial_calculations, n_events);
+
+    // Nothing has changed, so no rates should be recalculated
+    change_aware_selector.select_event();
+    change_aware_selector.select_event();
+    EXPECT_EQ(change_aware_calculator_ptr->get_n_calculations(), n_initial_calculations);
+
+    // Make a single event much more likely, only its rate should be recalculated
+    ID hot_id = event_ids[n_events / 2];
+    change_aware_calculator_ptr->set_rate(hot_id, 1.0e9);
+    auto event_and_time = change_aware_selector.select_event();
+    EXPECT_EQ(change_aware_calculator_ptr->get_n_calculations(), n_initial_calculations + 1);
+    EXPECT_EQ(event_and_time.first, hot_id);
+
+    // Skipped events really are unchanged, so every stored rate should match the calculator
+    for (const ID& id : event_ids)
+    {
+        EXPECT_EQ(get_stored_rate(change_aware_selector, id), change_aware_calculator_ptr->get_rate(id));
+    }
+}
+
+TEST_F(RejectionFreeEventSelectorTest, ParallelRateCalculation)
+{
+    // Checks that calculating impacted rates on worker threads gives the same selections as calculating serially
+    std::map<ID, std::vector<ID>> complete_impact_table;
+    for (const ID& id : event_ids)
+    {
+        complete_impact_table[id] = event_ids;
+    }
+    auto serial_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    auto parallel_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> serial_selector(serial_calculator_ptr, event_ids,
+                                                                                 complete_impact_table);
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> parallel_selector(parallel_calculator_ptr, event_ids,
+                                                                                   complete_impact_table);
+    reseed_for_testing(serial_selector);
+    reseed_for_testing(parallel_selector);
+    parallel_selector.set_n_threads(4);
+
+    int n_selections = 1000;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        // Change rates partway through so that impacted rates actually differ
+        if (i == n_selections / 2)
+        {
+            serial_calculator_ptr->set_even_rate(10.0);
+            parallel_calculator_ptr->set_even_rate(10.0);
+        }
+        auto serial_event_and_time = serial_selector.select_event();
+        auto parallel_event_and_time = parallel_selector.select_event();
+        EXPECT_EQ(serial_event_and_time.first, parallel_event_and_time.first);
+        EXPECT_EQ(serial_event_and_time.second, parallel_event_and_time.second);
+    }
+
+    // Switching back to serial calculation should also work
+    parallel_selector.set_n_threads(1);
+    EXPECT_EQ(serial_selector.select_event(), parallel_selector.select_event());
+}
+
+TEST_F(RejectionFreeEventSelectorTest, ConcurrentTree)
+{
+    // Checks that a selector whose workers apply impacted rates to a concurrent tree gives the same selections as one
+    // applying them serially to the default tree
+    std::map<ID, std::vector<ID>> complete_impact_table;
+    for (const ID& id : event_ids)
+    {
+        complete_impact_table[id] = event_ids;
+    }
+    using ConcurrentSelectorType = lotto::RejectionFreeEventSelector<ID,
+                                                                     EvenOddRateCalculator,
+                                                                     lotto::MapImpactProvider<ID>,
+                                                                     lotto::ConcurrentEventRateTree<ID>>;
+    auto serial_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    auto concurrent_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> serial_selector(serial_calculator_ptr, event_ids,
+                                                                                 complete_impact_table);
+    ConcurrentSelectorType concurrent_selector(concurrent_calculator_ptr, event_ids, complete_impact_table);
+    reseed_for_testing(serial_selector);
+    concurrent_selector.reseed_generator(TEST_SEED);
+    concurrent_selector.set_n_threads(4);
+
+    int n_selections = 1000;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        if (i == n_selections / 2)
+        {
+            serial_calculator_ptr->set_even_rate(10.0);
+            concurrent_calculator_ptr->set_even_rate(10.0);
+        }
+        ASSERT_EQ(serial_selector.select_event(), concurrent_selector.select_event());
+    }
+    EXPECT_EQ(serial_selector.total_rate(), concurrent_selector.total_rate());
+
+    // Snapshots of either tree can be restored into a selector with the other
+    std::stringstream snapshot;
+    concurrent_selector.save_state(snapshot);
+    serial_selector.load_state(snapshot);
+    concurrent_selector.set_n_threads(1);
+    EXPECT_EQ(serial_selector.select_event(), concurrent_selector.select_event());
+}
+
+TEST_F(RejectionFreeEventSelectorTest, RecalculateRates)
+{
+    // Checks that rates can be recalculated outside of the impact table
+    one_hot_calculator_ptr->set_hot_id(event_ids[0]);
+    lotto::RejectionFreeEventSelector<ID, OneHotRateCalculator<ID>> selector(one_hot_calculator_ptr, event_ids,
+                                                                             std::map<ID, std::vector<ID>>());
+    EXPECT_EQ(selector.select_event().first, event_ids[0]);
+
+    // Without an impact table the change of hot event is only seen after recalculating
+    one_hot_calculator_ptr->set_hot_id(event_ids[1]);
+    selector.recalculate_rates({event_ids[0], event_ids[1]});
+    EXPECT_EQ(selector.select_event().first, event_ids[1]);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, LeapEventCount)
+{
+    // Checks that the number of events in a leap has the expected mean, and that the leap size limit applies
+    double tau = 0.01;
+    int n_samples = 10000;
+    std::vector<double> n_events_samples(n_samples);
+    for (int i = 0; i < n_samples; ++i)
+    {
+        auto leap = uniform_no_impact_selector_ptr->select_events_leap(tau);
+        EXPECT_EQ(leap.time_step, tau);
+        double n_leap_events = 0.0;
+        for (const auto& event_and_count : leap.event_counts)
+        {
+            n_leap_events += event_and_count.second;
+        }
+        n_events_samples[i] = n_leap_events;
+    }
+    double expected_n_events = n_events * tau;
+    check_deviation_of_mean(mean(n_events_samples), expected_n_events,
+                            standard_error_of_mean(std::sqrt(expected_n_events), n_samples), TEST_SIGMA);
+
+    uniform_no_impact_selector_ptr->set_max_leap_size(2.0);
+    auto leap = uniform_no_impact_selector_ptr->select_events_leap(tau);
+    EXPECT_DOUBLE_EQ(leap.time_step, 2.0 / n_events);
+    EXPECT_THROW(uniform_no_impact_selector_ptr->set_max_leap_size(0.0), std::runtime_error);
+
+    // Leap times must be positive and finite
+    EXPECT_THROW(uniform_no_impact_selector_ptr->select_events_leap(0.0), std::runtime_error);
+    EXPECT_THROW(uniform_no_impact_selector_ptr->select_events_leap(-tau), std::runtime_error);
+    EXPECT_THROW(uniform_no_impact_selector_ptr->select_events_leap(std::numeric_limits<double>::quiet_NaN()),
+                 std::runtime_error);
+    EXPECT_THROW(uniform_no_impact_selector_ptr->select_events_leap(std::numeric_limits<double>::infinity()),
+                 std::runtime_error);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, LeapConflicts)
+{
+    // Checks that selected events impacting each other are reported as conflicts
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    for (int i = 0; i < n_events; ++i)
+    {
+        neighbor_impact_table[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+    }
+    std::map<ID, int> event_positions;
+    for (int i = 0; i < n_events; ++i)
+    {
+        event_positions[event_ids[i]] = i;
+    }
+    lotto::RejectionFreeEventSelector<ID, UniformRateCalculator<ID>> selector(uniform_calculator_ptr, event_ids,
+                                                                              neighbor_impact_table);
+    reseed_for_testing(selector);
+
+    // Large leaps select most events, so conflicts are certain
+    auto leap = selector.select_events_leap(2.0);
+    ASSERT_FALSE(leap.conflicts.empty());
+    std::map<ID, lotto::UIntType> counts(leap.event_counts.begin(), leap.event_counts.end());
+    for (const auto& conflict : leap.conflicts)
+    {
+        ASSERT_EQ(counts.count(conflict.first), 1);
+        ASSERT_EQ(counts.count(conflict.second), 1);
+        if (conflict.first == conflict.second)
+        {
+            EXPECT_GT(counts[conflict.first], 1);
+        }
+        else
+        {
+            EXPECT_EQ(event_positions[conflict.second], (event_positions[conflict.first] + 1) % n_events);
+        }
+    }
+}
+
+TEST_F(RejectionFreeEventSelectorTest, LeapImpacts)
+{
+    // Checks that rates impacted by the events of a leap are updated on the next selection
+    even_odd_calculator_ptr->set_even_rate(0.0);
+
+    // Only events with even IDs update the rates of even events, so leap until one of them occurs
+    bool has_even_event = false;
+    while (!has_even_event)
+    {
+        auto leap = even_odd_selector_ptr->select_events_leap(0.01);
+        for (const auto& event_and_count : leap.event_counts)
+        {
+            has_even_event = has_even_event || event_and_count.first % 2 == 0;
+        }
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        auto leap = even_odd_selector_ptr->select_events_leap(0.01);
+        for (const auto& event_and_count : leap.event_counts)
+        {
+            EXPECT_EQ(event_and_count.first % 2, 1);
+        }
+    }
+    EXPECT_EQ(even_odd_selector_ptr->select_event().first % 2, 1);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, StaticInterface)
+{
+    // Checks that the selector is detected as an event selector at compile time, unlike a rate calculator
+    static_assert(lotto::is_event_selector<lotto::RejectionFreeEventSelector<ID, UniformRateCalculator<ID>>>::value);
+    static_assert(!lotto::is_event_selector<UniformRateCalculator<ID>>::value);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, RunSteps)
+{
+    // Checks that running a number of steps carries out the same events as selecting them one at a time
+    auto reference_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    std::map<ID, std::vector<ID>> empty_impact_table;
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> reference_selector(reference_calculator_ptr,
+                                                                                    event_ids, empty_impact_table);
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, event_ids,
+                                                                          empty_impact_table);
+    reseed_for_testing(reference_selector);
+    reseed_for_testing(selector);
+
+    int n_steps = 1000;
+    std::vector<ID> reference_event_ids;
+    double reference_time = 0.0;
+    for (int i = 0; i < n_steps; ++i)
+    {
+        auto event_and_time = reference_selector.select_event();
+        reference_event_ids.push_back(event_and_time.first);
+        reference_time += event_and_time.second;
+    }
+
+    std::vector<ID> applied_event_ids;
+    selector.run_steps(n_steps, [&](const ID& event_id, double) { applied_event_ids.push_back(event_id); });
+    EXPECT_EQ(applied_event_ids, reference_event_ids);
+    EXPECT_DOUBLE_EQ(selector.get_elapsed_time(), reference_time);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, RunUntil)
+{
+    // Checks that running until a given time stops before it, and that the held event is carried out next
+    double max_time = 0.5;
+    double applied_time = 0.0;
+    lotto::UIntType n_steps = uniform_selector_ptr->run_until(
+        max_time, [&](const ID&, double time_step) { applied_time += time_step; });
+    EXPECT_GT(n_steps, 0);
+    EXPECT_LE(applied_time, max_time);
+    EXPECT_DOUBLE_EQ(uniform_selector_ptr->get_elapsed_time(), applied_time);
+
+    // Running until the same time again carries out nothing
+    EXPECT_EQ(uniform_selector_ptr->run_until(max_time, [](const ID&, double) {}), 0);
+
+    // The average number of events matches the total rate
+    int n_intervals = 100;
+    lotto::UIntType n_total_steps = n_steps;
+    for (int i = 2; i <= n_intervals; ++i)
+    {
+        n_total_steps += uniform_selector_ptr->run_until(i * max_time, [](const ID&, double) {});
+    }
+    double expected_n_steps = n_events * n_intervals * max_time;
+    check_deviation_of_mean(n_total_steps, expected_n_steps, std::sqrt(expected_n_steps), TEST_SIGMA);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, SelectAndCommit)
+{
+    // Checks that selecting and committing each event is the same as calling select_event
+    auto reference_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 2.0);
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    for (int i = 0; i < n_events; ++i)
+    {
+        neighbor_impact_table[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+    }
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> reference_selector(reference_calculator_ptr,
+                                                                                    event_ids, neighbor_impact_table);
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> selector(calculator_ptr, event_ids,
+                                                                          neighbor_impact_table);
+    reseed_for_testing(reference_selector);
+    reseed_for_testing(selector);
+    int n_selections = 100;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        auto reference_event_and_time = reference_selector.select_event();
+        auto event_and_time = selector.select();
+        selector.commit(event_and_time.first);
+        EXPECT_EQ(reference_event_and_time, event_and_time);
+    }
+}
+
+TEST_F(RejectionFreeEventSelectorTest, MergedCommits)
+{
+    // Checks that impacted events of several committed events are merged, so each rate is calculated once,
+    // and that rejected events cause no rate calculations
+    int n_environments = n_events;
+    auto calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_environments);
+    std::vector<ID> ids;
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    for (int i = 0; i < n_events; ++i)
+    {
+        ids.push_back(i);
+        neighbor_impact_table[i] = {i, (i + 1) % n_events};
+    }
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator> selector(calculator_ptr, ids,
+                                                                              neighbor_impact_table);
+    reseed_for_testing(selector);
+    int n_initial_calculations = calculator_ptr->get_n_calculations();
+
+    // Events 0 and 1 impact {0, 1} and {1, 2}
+    selector.commit(0);
+    selector.commit(1);
+    selector.commit(0);
+    auto event_and_time = selector.select();
+    EXPECT_EQ(calculator_ptr->get_n_calculations() - n_initial_calculations, 3);
+
+    selector.reject(event_and_time.first);
+    selector.select();
+    EXPECT_EQ(calculator_ptr->get_n_calculations() - n_initial_calculations, 3);
+
+    // A single commit after merging still works
+    selector.commit(5);
+    selector.select();
+    EXPECT_EQ(calculator_ptr->get_n_calculations() - n_initial_calculations, 5);
+}
+
+TEST_F(RejectionFreeEventSelectorTest, FunctionImpactProvider)
+{
+    // Checks that generating impacted events on demand gives the same selections as an impact table
+    auto reference_calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    auto calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    std::vector<ID> ids;
+    std::map<ID, std::vector<ID>> neighbor_impact_table;
+    for (int i = 0; i < n_events; ++i)
+    {
+        ids.push_back(i);
+        neighbor_impact_table[i] = {i, (i + 1) % n_events};
+    }
+    auto neighbor_impact_function = [this](const ID& id, std::vector<ID>& impacted_events) {
+        impacted_events.push_back(id);
+        impacted_events.push_back((id + 1) % n_events);
+    };
+    using ProviderType = lotto::FunctionImpactProvider<ID, decltype(neighbor_impact_function)>;
+
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator> reference_selector(reference_calculator_ptr, ids,
+                                                                                    neighbor_impact_table);
+    lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator, ProviderType> selector(
+        calculator_ptr, ids, ProviderType(neighbor_impact_function));
+    reseed_for_testing(reference_selector);
+    selector.reseed_generator(TEST_SEED);
+
+    // Change rates after the first selection, then merge several commits, including one with no impacts
+    int n_selections = 1000;
+    for (int i = 0; i < n_selections; ++i)
+    {
+        if (i == 1)
+        {
+            reference_calculator_ptr->set_even_rate(3.0);
+            calculator_ptr->set_even_rate(3.0);
+        }
+        if (i % 10 == 0)
+        {
+            reference_selector.commit(2 * i % n_events);
+            selector.commit(2 * i % n_events);
+        }
+        EXPECT_EQ(reference_selector.select_event(), selector.select_event());
+    }
+}
+
+TEST_F(RejectionFreeEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot, taken while an event is held and impacted rates are pending,
+    // carries out the same events as the original, without calculating any rates before them
+    int n_environments = 7;
+    auto calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_environments);
+    auto restored_calculator_ptr = std::make_shared<EnvironmentRateCalculator>(n_environments);
+    auto neighbor_impact_table_ptr = std::make_shared<std::map<ID, std::vector<ID>>>();
+    for (int i = 0; i < n_events; ++i)
+    {
+        (*neighbor_impact_table_ptr)[event_ids[i]] = {event_ids[i], event_ids[(i + 1) % n_events]};
+    }
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator> selector(calculator_ptr, event_ids,
+                                                                              *neighbor_impact_table_ptr);
+    reseed_for_testing(selector);
+    selector.run_until(0.1, [](const ID&, double) {});
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator> restored_selector(
+        restored_calculator_ptr, event_ids, std::vector<double>(n_events, 0.0),
+        lotto::MapImpactProvider<ID>(neighbor_impact_table_ptr));
+    restored_selector.load_state(snapshot);
+    EXPECT_EQ(restored_calculator_ptr->get_n_calculations(), 0);
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(1, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_calculator_ptr->get_n_calculations(), 0);
+    restored_selector.run_steps(n_steps - 1, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+    EXPECT_EQ(restored_selector.total_rate(), selector.total_rate());
+
+    // Snapshots of other types, or of a different number of events, are rejected
+    std::stringstream generator_snapshot;
+    lotto::RandomGenerator().save_state(generator_snapshot);
+    EXPECT_THROW(restored_selector.load_state(generator_snapshot), std::runtime_error);
+    std::stringstream small_snapshot;
+    lotto::RejectionFreeEventSelector<ID, EnvironmentRateCalculator>(calculator_ptr, {event_ids[0]},
+                                                                     *neighbor_impact_table_ptr)
+        .save_state(small_snapshot);
+    EXPECT_THROW(restored_selector.load_state(small_snapshot), std::runtime_error);
+
+    // A snapshot that fails to load part way through leaves the selector unchanged
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+    EXPECT_EQ(restored_selector.total_rate(), selector.total_rate());
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,136 @@
+#include "rate_calculators.hpp"
+#include "test_parameters.hpp"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <lotto/rejection_free.hpp>
+#include <lotto/replay.hpp>
+#include <lotto/trajectory.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ReplayEventSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+    using SelectorType = lotto::RejectionFreeEventSelector<ID, EvenOddRateCalculator>;
+
+    void SetUp() override
+    {
+        file_path = testing::TempDir() + "lotto_replay_test.bin";
+
+        // Record a trajectory
+        std::vector<ID> event_ids;
+        std::map<ID, std::vector<ID>> impact_table;
+        for (ID id = 0; id < n_events; ++id)
+        {
+            event_ids.push_back(id);
+            impact_table[id] = {id};
+        }
+        auto selector_ptr = std::make_shared<SelectorType>(std::make_shared<EvenOddRateCalculator>(1.0, 3.0),
+                                                           event_ids, impact_table);
+        selector_ptr->reseed_generator(TEST_SEED);
+        auto recorder_ptr = std::make_shared<lotto::TrajectoryRecorder<ID>>(file_path, 100);
+        lotto::RecordingEventSelector<SelectorType, ID> recording_selector(selector_ptr, recorder_ptr);
+        recording_selector.run_steps(n_steps, [this](const ID& event_id, double time_step) {
+            recorded_events_and_times.emplace_back(event_id, time_step);
+        });
+    }
+
+    void TearDown() override
+    {
+        std::remove(file_path.c_str());
+        return;
+    }
+
+    int n_events = 100;
+    int n_steps = 1000;
+    std::string file_path;
+    std::vector<std::pair<ID, double>> recorded_events_and_times;
+};
+
+TEST_F(ReplayEventSelectorTest, ReplaySelections)
+{
+    // Checks that the replayed events and time steps match the recorded ones, and that replay stops at the end
+    lotto::ReplayEventSelector<ID> replay_selector(file_path);
+    std::vector<std::pair<ID, double>> replayed_events_and_times;
+    replay_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        replayed_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(replayed_events_and_times, recorded_events_and_times);
+    EXPECT_EQ(replay_selector.get_n_selections(), n_steps);
+    EXPECT_FALSE(replay_selector.has_events_left());
+    EXPECT_THROW(replay_selector.select_event(), std::runtime_error);
+}
+
+TEST_F(ReplayEventSelectorTest, Verification)
+{
+    // Checks that replayed events are checked against the rate calculator at the given interval
+    auto calculator_ptr = std::make_shared<ListedRateCalculator<ID>>();
+    for (ID id = 0; id < n_events; ++id)
+    {
+        calculator_ptr->set_rate(id, 1.0);
+    }
+    lotto::ReplayEventSelector<ID> replay_selector(file_path);
+    replay_selector.set_verification(calculator_ptr, 10);
+    replay_selector.run_steps(n_steps / 2, [](const ID&, double) {});
+
+    // An event with zero rate is only detected on a selection that is checked, i.e. every tenth
+    int n_selections = n_steps / 2;
+    calculator_ptr->set_rate(recorded_events_and_times[n_selections].first, 0.0);
+    EXPECT_NO_THROW(replay_selector.select_event());
+    ++n_selections;
+    for (ID id = 0; id < n_events; ++id)
+    {
+        calculator_ptr->set_rate(id, 0.0);
+    }
+    while ((n_selections + 1) % 10 != 0)
+    {
+        EXPECT_NO_THROW(replay_selector.select_event());
+        ++n_selections;
+    }
+    EXPECT_THROW(replay_selector.select_event(), std::runtime_error);
+}
+
+TEST_F(ReplayEventSelectorTest, ReplayRunUntil)
+{
+    // Checks that a trajectory recorded with run_until holds only carried out events, so that the event held at the
+    // end of a run is recorded only once a later run carries it out
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> impact_table;
+    for (ID id = 0; id < n_events; ++id)
+    {
+        event_ids.push_back(id);
+        impact_table[id] = {id};
+    }
+    auto selector_ptr =
+        std::make_shared<SelectorType>(std::make_shared<EvenOddRateCalculator>(1.0, 3.0), event_ids, impact_table);
+    selector_ptr->reseed_generator(TEST_SEED);
+    std::vector<std::pair<ID, double>> carried_out_events_and_times;
+    auto apply_event = [&](const ID& event_id, double time_step) {
+        carried_out_events_and_times.emplace_back(event_id, time_step);
+    };
+    {
+        auto recorder_ptr = std::make_shared<lotto::TrajectoryRecorder<ID>>(file_path, 100);
+        lotto::RecordingEventSelector<SelectorType, ID> recording_selector(selector_ptr, recorder_ptr);
+        recording_selector.run_until(1.0, apply_event);
+        recording_selector.run_until(2.0, apply_event);
+    }
+    ASSERT_FALSE(carried_out_events_and_times.empty());
+
+    lotto::ReplayEventSelector<ID> replay_selector(file_path);
+    std::vector<std::pair<ID, double>> replayed_events_and_times;
+    while (replay_selector.has_events_left())
+    {
+        replayed_events_and_times.push_back(replay_selector.select_event());
+    }
+    EXPECT_EQ(replayed_events_and_times, carried_out_events_and_times);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
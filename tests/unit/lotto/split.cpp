@@ -0,0 +1,172 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "statistics.hpp"
+#include "test_parameters.hpp"
+#include <gtest/gtest.h>
+#include <lotto/split.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+class SplitEventSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+    using SelectorType = lotto::SplitEventSelector<ID, EvenOddRateCalculator>;
+
+    void SetUp() override
+    {
+        // Set up event ID list, odd events are selected by rejection and even events using a tree
+        event_ids = hashed_sequence(n_events);
+        odd_family.rate_upper_bound = odd_rate_upper_bound;
+        for (const ID& id : event_ids)
+        {
+            complete_impact_table[id] = event_ids;
+            if (id % 2 == 0)
+            {
+                even_family.event_ids.push_back(id);
+            }
+            else
+            {
+                odd_family.event_ids.push_back(id);
+            }
+        }
+        for (const ID& id : even_family.event_ids)
+        {
+            even_only_impact_table[id] = even_family.event_ids;
+        }
+
+        calculator_ptr = std::make_shared<EvenOddRateCalculator>(1.0, 1.0);
+    }
+
+    // Event ID list, families, and impact tables
+    int n_events = 1000;
+    std::vector<ID> event_ids;
+    double odd_rate_upper_bound = 2.0;
+    lotto::EventFamily<ID> even_family;
+    lotto::EventFamily<ID> odd_family;
+    std::map<ID, std::vector<ID>> complete_impact_table;
+    std::map<ID, std::vector<ID>> even_only_impact_table;
+
+    std::shared_ptr<EvenOddRateCalculator> calculator_ptr;
+};
+
+TEST_F(SplitEventSelectorTest, Construct)
+{
+    // Checks if SplitEventSelector can be constructed, and rejects invalid families
+    SelectorType selector(calculator_ptr, {even_family, odd_family}, complete_impact_table);
+    EXPECT_EQ(selector.n_families(), 2);
+    EXPECT_DOUBLE_EQ(selector.family_weight(0), even_family.event_ids.size() * 1.0);
+    EXPECT_DOUBLE_EQ(selector.family_weight(1), odd_family.event_ids.size() * odd_rate_upper_bound);
+
+    EXPECT_THROW(SelectorType(calculator_ptr, {}, complete_impact_table), std::runtime_error);
+    EXPECT_THROW(SelectorType(calculator_ptr, {even_family, lotto::EventFamily<ID>()}, complete_impact_table),
+                 std::runtime_error);
+    EXPECT_THROW(SelectorType(calculator_ptr, {even_family, even_family}, complete_impact_table), std::runtime_error);
+}
+
+TEST_F(SplitEventSelectorTest, SelectionFrequencyAndTimeStep)
+{
+    // Checks that families are selected in proportion to their total rates, including rejected attempts,
+    // and that the average time step matches the total rate
+    double even_rate = 3.0;
+    double odd_rate = 1.0;
+    calculator_ptr->set_even_rate(even_rate);
+    calculator_ptr->set_odd_rate(odd_rate);
+    SelectorType selector(calculator_ptr, {even_family, odd_family}, std::map<ID, std::vector<ID>>());
+    selector.reseed_generator(TEST_SEED);
+
+    int n_samples = 100000;
+    std::vector<double> is_even_samples(n_samples);
+    std::vector<double> time_step_samples(n_samples);
+    for (int i = 0; i < n_samples; ++i)
+    {
+        auto event_and_time = selector.select_event();
+        is_even_samples[i] = event_and_time.first % 2 == 0 ? 1.0 : 0.0;
+        time_step_samples[i] = event_and_time.second;
+    }
+
+    double even_total_rate = even_family.event_ids.size() * even_rate;
+    double odd_total_rate = odd_family.event_ids.size() * odd_rate;
+    double expected_even_fraction = even_total_rate / (even_total_rate + odd_total_rate);
+    double standard_deviation = std::sqrt(expected_even_fraction * (1.0 - expected_even_fraction));
+    check_deviation_of_mean(mean(is_even_samples), expected_even_fraction,
+                            standard_error_of_mean(standard_deviation, n_samples), TEST_SIGMA);
+    check_samples_from_log_inverse_distribution(1.0 / (even_total_rate + odd_total_rate), time_step_samples);
+}
+
+TEST_F(SplitEventSelectorTest, TreeFamilyImpacts)
+{
+    // Checks that impacted events in a tree family are updated, and that turning off every event in it works
+    SelectorType selector(calculator_ptr, {even_family, odd_family}, even_only_impact_table);
+    selector.reseed_generator(TEST_SEED);
+
+    // Select events until an even one is selected, then shut off even events
+    while (selector.select_event().first % 2 != 0)
+    {
+    }
+    calculator_ptr->set_even_rate(0.0);
+
+    int n_checks = 100;
+    for (int i = 0; i < n_checks; ++i)
+    {
+        EXPECT_EQ(selector.select_event().first % 2, 1);
+    }
+    EXPECT_EQ(selector.family_weight(0), 0.0);
+}
+
+TEST_F(SplitEventSelectorTest, RejectionFamilyNeedsNoImpacts)
+{
+    // Checks that changes to rates in a rejection family take effect immediately, without any impact table
+    SelectorType selector(calculator_ptr, {even_family, odd_family}, std::map<ID, std::vector<ID>>());
+    selector.reseed_generator(TEST_SEED);
+    selector.select_event();
+    calculator_ptr->set_odd_rate(0.0);
+
+    int n_checks = 100;
+    for (int i = 0; i < n_checks; ++i)
+    {
+        EXPECT_EQ(selector.select_event().first % 2, 0);
+    }
+}
+
+TEST_F(SplitEventSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot, taken while the impacts of a selected tree event are pending,
+    // carries out the same events as the original
+    SelectorType selector(calculator_ptr, {even_family, odd_family}, even_only_impact_table);
+    selector.reseed_generator(TEST_SEED);
+    while (selector.select_event().first % 2 != 0)
+    {
+    }
+    calculator_ptr->set_even_rate(2.0);
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+
+    int n_steps = 1000;
+    std::vector<std::pair<ID, double>> events_and_times;
+    selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        events_and_times.emplace_back(event_id, time_step);
+    });
+
+    SelectorType restored_selector(calculator_ptr, {even_family, odd_family}, even_only_impact_table);
+    restored_selector.load_state(snapshot);
+    std::vector<std::pair<ID, double>> restored_events_and_times;
+    restored_selector.run_steps(n_steps, [&](const ID& event_id, double time_step) {
+        restored_events_and_times.emplace_back(event_id, time_step);
+    });
+    EXPECT_EQ(restored_events_and_times, events_and_times);
+    EXPECT_EQ(restored_selector.family_weight(0), selector.family_weight(0));
+
+    // Snapshots of different families are rejected, leaving the selector unchanged
+    std::stringstream other_snapshot;
+    SelectorType(calculator_ptr, {even_family}, even_only_impact_table).save_state(other_snapshot);
+    EXPECT_THROW(restored_selector.load_state(other_snapshot), std::runtime_error);
+    EXPECT_EQ(restored_selector.get_elapsed_time(), selector.get_elapsed_time());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
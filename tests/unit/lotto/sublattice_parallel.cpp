@@ -0,0 +1,264 @@
+#include "test_parameters.hpp"
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <lotto/sublattice_parallel.hpp>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+/*
+ * Rate calculator for events that can each happen only once: every event starts with
+ * a rate of one, and carrying out an event sets its rate to zero. Counts the rate calculations of every event.
+ */
+class ConsumableRateCalculator
+{
+public:
+    ConsumableRateCalculator(int n_events) : rates(n_events), n_calculations(n_events)
+    {
+        for (auto& rate : rates)
+        {
+            rate.store(1.0);
+        }
+        for (auto& n_event_calculations : n_calculations)
+        {
+            n_event_calculations.store(0);
+        }
+    }
+    double calculate_rate(const int& event_id) const
+    {
+        ++n_calculations[event_id];
+        return rates[event_id].load();
+    }
+    int n_rate_calculations(const int& event_id) const { return n_calculations[event_id].load(); }
+    void consume(const int& event_id) { rates[event_id].store(0.0); }
+    double total_rate() const
+    {
+        double total_rate = 0.0;
+        for (const auto& rate : rates)
+        {
+            total_rate += rate.load();
+        }
+        return total_rate;
+    }
+
+private:
+    std::vector<std::atomic<double>> rates;
+    mutable std::vector<std::atomic<int>> n_calculations;
+};
+
+class SublatticeParallelSelectorTest : public testing::Test
+{
+protected:
+    using ID = int;
+    using Selector = lotto::SublatticeParallelSelector<ID, ConsumableRateCalculator>;
+
+    void SetUp() override
+    {
+        // Events on a ring, split into contiguous domains, alternating between sublattices within each domain
+        for (ID id = 0; id < n_events; ++id)
+        {
+            event_ids.push_back(id);
+            impact_table[id] = {id, (id + 1) % n_events, (id + n_events - 1) % n_events};
+            location_map[id] = {id / (n_events / n_domains), id % n_sublattices};
+        }
+    }
+
+    // Events, impacts, and locations
+    int n_events = 1000;
+    int n_domains = 8;
+    int n_sublattices = 2;
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> impact_table;
+    std::map<ID, lotto::SublatticeLocation> location_map;
+
+    // Returns the sum of the total rates of every tree in the selector
+    template <typename SelectorType>
+    double stored_total_rate(const SelectorType& selector) const
+    {
+        double total_rate = 0.0;
+        for (const auto& domain : selector.domains)
+        {
+            for (const auto& tree_ptr : domain.sublattice_trees)
+            {
+                if (tree_ptr != nullptr)
+                {
+                    total_rate += tree_ptr->total_rate();
+                }
+            }
+        }
+        return total_rate;
+    }
+
+    // Runs cycles until all events are consumed, and returns the events carried out in each cycle
+    std::vector<std::vector<ID>> run_to_completion(std::size_t n_threads)
+    {
+        auto calculator_ptr = std::make_shared<ConsumableRateCalculator>(n_events);
+        Selector selector(calculator_ptr, event_ids, impact_table, location_map, n_threads);
+        return run_to_completion(selector, calculator_ptr);
+    }
+
+    // Runs cycles of a selector using the given calculator until all events are consumed, and returns the events
+    // carried out in each cycle
+    template <typename SelectorType>
+    std::vector<std::vector<ID>> run_to_completion(SelectorType& selector,
+                                                   const std::shared_ptr<ConsumableRateCalculator>& calculator_ptr)
+    {
+        selector.reseed_generator(TEST_SEED);
+        EXPECT_EQ(selector.n_domains(), n_domains);
+
+        std::vector<std::vector<ID>> events_by_cycle;
+        std::mutex events_mutex;
+        double cycle_time = 0.5;
+        while (calculator_ptr->total_rate() > 0.0)
+        {
+            std::vector<ID> cycle_events;
+            auto n_events_in_cycle = selector.run_cycle(cycle_time, [&](const ID& event_id) {
+                calculator_ptr->consume(event_id);
+                std::lock_guard<std::mutex> lock(events_mutex);
+                cycle_events.push_back(event_id);
+            });
+            EXPECT_EQ(n_events_in_cycle, cycle_events.size());
+
+            // All events in a cycle should be on the active sublattice
+            for (const ID& event_id : cycle_events)
+            {
+                EXPECT_EQ(location_map.at(event_id).sublattice, selector.get_last_active_sublattice());
+            }
+
+            // Once the cycle is over, the trees should agree with the calculator
+            EXPECT_EQ(stored_total_rate(selector), calculator_ptr->total_rate());
+
+            std::sort(cycle_events.begin(), cycle_events.end());
+            events_by_cycle.push_back(cycle_events);
+        }
+        EXPECT_DOUBLE_EQ(selector.get_time(), cycle_time * events_by_cycle.size());
+        return events_by_cycle;
+    }
+};
+
+TEST_F(SublatticeParallelSelectorTest, Construct)
+{
+    // Checks construction, and that every event must have a location
+    auto calculator_ptr = std::make_shared<ConsumableRateCalculator>(n_events);
+    Selector selector(calculator_ptr, event_ids, impact_table, location_map, 2);
+    EXPECT_EQ(stored_total_rate(selector), n_events);
+
+    location_map.erase(event_ids[0]);
+    EXPECT_THROW(Selector(calculator_ptr, event_ids, impact_table, location_map, 2), std::runtime_error);
+    EXPECT_THROW(Selector(calculator_ptr, {}, impact_table, location_map, 2), std::runtime_error);
+}
+
+TEST_F(SublatticeParallelSelectorTest, AllEventsCarriedOutOnce)
+{
+    // Checks that every event is carried out exactly once before all rates are zero
+    auto events_by_cycle = run_to_completion(4);
+    std::vector<ID> all_events;
+    for (const auto& cycle_events : events_by_cycle)
+    {
+        all_events.insert(all_events.end(), cycle_events.begin(), cycle_events.end());
+    }
+    std::sort(all_events.begin(), all_events.end());
+    EXPECT_EQ(all_events, event_ids);
+}
+
+TEST_F(SublatticeParallelSelectorTest, IndependentOfThreadCount)
+{
+    // Checks that the events carried out do not depend on the number of threads
+    EXPECT_EQ(run_to_completion(1), run_to_completion(3));
+}
+
+TEST_F(SublatticeParallelSelectorTest, BoundaryImpactsUpdatedOnce)
+{
+    // Checks that an event impacted from two other domains in the same cycle is recalculated only once
+    std::vector<ID> line_event_ids{0, 1, 2};
+    Selector::ImpactTable line_impact_table{{0, {0, 1}}, {1, {1}}, {2, {2, 1}}};
+    Selector::LocationMap line_location_map{{0, {0, 0}}, {1, {1, 0}}, {2, {2, 0}}};
+    auto calculator_ptr = std::make_shared<ConsumableRateCalculator>(3);
+    calculator_ptr->consume(1);
+    Selector selector(calculator_ptr, line_event_ids, line_impact_table, line_location_map, 3);
+    EXPECT_EQ(calculator_ptr->n_rate_calculations(1), 1);
+
+    EXPECT_EQ(selector.run_cycle(1.0e6, [&](const ID& event_id) { calculator_ptr->consume(event_id); }), 2);
+    EXPECT_EQ(calculator_ptr->n_rate_calculations(1), 2);
+    EXPECT_EQ(stored_total_rate(selector), 0.0);
+}
+
+TEST_F(SublatticeParallelSelectorTest, SharedTablesAndImpactProvider)
+{
+    // Checks that selectors can share their impact table and locations, or generate impacted events on demand, and
+    // carry out the same events as a selector holding copies of the tables
+    auto impact_table_ptr = std::make_shared<const Selector::ImpactTable>(impact_table);
+    auto location_map_ptr = std::make_shared<const Selector::LocationMap>(location_map);
+    auto calculator_ptr = std::make_shared<ConsumableRateCalculator>(n_events);
+    Selector shared_selector(calculator_ptr, event_ids, impact_table_ptr, location_map_ptr, 3);
+    EXPECT_EQ(location_map_ptr.use_count(), 2);
+    EXPECT_THROW(Selector(calculator_ptr, event_ids, impact_table_ptr, nullptr, 3), std::runtime_error);
+    EXPECT_EQ(run_to_completion(shared_selector, calculator_ptr), run_to_completion(2));
+
+    int n_ring_events = n_events;
+    auto ring_impact_provider = lotto::make_function_impact_provider<ID>(
+        [n_ring_events](const ID& event_id, std::vector<ID>& impacted_events) {
+            impacted_events.push_back(event_id);
+            impacted_events.push_back((event_id + 1) % n_ring_events);
+            impacted_events.push_back((event_id + n_ring_events - 1) % n_ring_events);
+        });
+    using FunctionSelector =
+        lotto::SublatticeParallelSelector<ID, ConsumableRateCalculator, decltype(ring_impact_provider)>;
+    auto function_calculator_ptr = std::make_shared<ConsumableRateCalculator>(n_events);
+    FunctionSelector function_selector(function_calculator_ptr, event_ids, ring_impact_provider, location_map_ptr, 4);
+    EXPECT_EQ(run_to_completion(function_selector, function_calculator_ptr), run_to_completion(2));
+}
+
+TEST_F(SublatticeParallelSelectorTest, SaveAndLoadState)
+{
+    // Checks that a selector restored from a snapshot taken between cycles carries out the same events as the original
+    double cycle_time = 0.5;
+    auto run_cycles = [&](Selector& selector, ConsumableRateCalculator& calculator, int n_cycles) {
+        std::vector<std::vector<ID>> events_by_cycle;
+        std::mutex events_mutex;
+        for (int cycle = 0; cycle < n_cycles; ++cycle)
+        {
+            std::vector<ID> cycle_events;
+            selector.run_cycle(cycle_time, [&](const ID& event_id) {
+                calculator.consume(event_id);
+                std::lock_guard<std::mutex> lock(events_mutex);
+                cycle_events.push_back(event_id);
+            });
+            std::sort(cycle_events.begin(), cycle_events.end());
+            events_by_cycle.push_back(cycle_events);
+        }
+        return events_by_cycle;
+    };
+
+    auto calculator_ptr = std::make_shared<ConsumableRateCalculator>(n_events);
+    Selector selector(calculator_ptr, event_ids, impact_table, location_map, 2);
+    selector.reseed_generator(TEST_SEED);
+    auto first_events_by_cycle = run_cycles(selector, *calculator_ptr, 3);
+    std::stringstream snapshot;
+    selector.save_state(snapshot);
+    auto events_by_cycle = run_cycles(selector, *calculator_ptr, 5);
+
+    // The restored calculator must be in the same state as when the snapshot was saved
+    auto restored_calculator_ptr = std::make_shared<ConsumableRateCalculator>(n_events);
+    for (const auto& cycle_events : first_events_by_cycle)
+    {
+        for (const ID& event_id : cycle_events)
+        {
+            restored_calculator_ptr->consume(event_id);
+        }
+    }
+    Selector restored_selector(restored_calculator_ptr, event_ids, impact_table, location_map, 3);
+    restored_selector.load_state(snapshot);
+    EXPECT_EQ(restored_selector.get_time(), 3 * cycle_time);
+    EXPECT_EQ(run_cycles(restored_selector, *restored_calculator_ptr, 5), events_by_cycle);
+    EXPECT_EQ(restored_selector.get_last_active_sublattice(), selector.get_last_active_sublattice());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <lotto/thread_pool.hpp>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class ThreadPoolTest : public testing::Test
+{
+protected:
+    // Number of worker threads
+    std::size_t n_threads = 4;
+
+    // Thread pool for testing
+    lotto::ThreadPool thread_pool{n_threads};
+};
+
+TEST_F(ThreadPoolTest, Construct)
+{
+    // Checks construction, a pool must have at least one thread
+    EXPECT_EQ(thread_pool.size(), n_threads);
+    EXPECT_THROW(lotto::ThreadPool(0), std::runtime_error);
+}
+
+TEST_F(ThreadPoolTest, AllTasksRunOnce)
+{
+    // Checks that every index is visited exactly once, over several loops of different sizes
+    for (std::size_t n_tasks : {0, 1, 3, 4, 5, 1000})
+    {
+        std::vector<std::atomic<int>> visits(n_tasks);
+        thread_pool.parallel_for(n_tasks, [&](std::size_t task_ix) { ++visits[task_ix]; });
+        for (const auto& visit : visits)
+        {
+            EXPECT_EQ(visit.load(), 1);
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, StaticAssignment)
+{
+    // Checks that a given index is always run by the same thread
+    std::size_t n_tasks = 100;
+    std::vector<std::thread::id> first_thread_ids(n_tasks);
+    std::vector<std::thread::id> second_thread_ids(n_tasks);
+    thread_pool.parallel_for(n_tasks, [&](std::size_t task_ix) { first_thread_ids[task_ix] = std::this_thread::get_id(); });
+    thread_pool.parallel_for(n_tasks, [&](std::size_t task_ix) { second_thread_ids[task_ix] = std::this_thread::get_id(); });
+    EXPECT_EQ(first_thread_ids, second_thread_ids);
+}
+
+TEST_F(ThreadPoolTest, PinnedThreads)
+{
+    // Checks that a pool with pinned threads (possibly more threads than CPUs) runs every task
+    lotto::ThreadPool pinned_thread_pool(2 * std::thread::hardware_concurrency() + 1, true);
+    std::atomic<std::size_t> sum(0);
+    pinned_thread_pool.parallel_for(100, [&](std::size_t task_ix) { sum += task_ix; });
+    EXPECT_EQ(sum.load(), 4950);
+}
+
+TEST_F(ThreadPoolTest, Exception)
+{
+    // Checks that an exception thrown in a task reaches the caller, and that the pool is still usable afterwards
+    EXPECT_THROW(thread_pool.parallel_for(10,
+                                          [](std::size_t task_ix) {
+                                              if (task_ix == 7)
+                                              {
+                                                  throw std::logic_error("Task failed");
+                                              }
+                                          }),
+                 std::logic_error);
+    std::atomic<std::size_t> sum(0);
+    thread_pool.parallel_for(10, [&](std::size_t task_ix) { sum += task_ix; });
+    EXPECT_EQ(sum.load(), 45);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
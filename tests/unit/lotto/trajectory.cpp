@@ -0,0 +1,168 @@
+#include "rate_calculators.hpp"
+#include "sequences.hpp"
+#include "test_parameters.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <limits>
+#include <lotto/rejection_free.hpp>
+#include <lotto/trajectory.hpp>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TrajectoryTest : public testing::Test
+{
+protected:
+    using ID = long int;
+
+    void SetUp() override { file_path = testing::TempDir() + "lotto_trajectory_test.bin"; }
+
+    void TearDown() override
+    {
+        std::remove(file_path.c_str());
+        return;
+    }
+
+    // Read all records of the trajectory file
+    std::vector<std::pair<ID, double>> read_trajectory() const
+    {
+        lotto::TrajectoryReader<ID> reader(file_path);
+        std::vector<std::pair<ID, double>> events_and_times;
+        ID event_id;
+        double time_step;
+        while (reader.read_event(event_id, time_step))
+        {
+            events_and_times.emplace_back(event_id, time_step);
+        }
+        return events_and_times;
+    }
+
+    std::string file_path;
+};
+
+TEST_F(TrajectoryTest, RoundTrip)
+{
+    // Checks that recorded events are read back unchanged, across chunks and for IDs far apart in either direction
+    std::vector<std::pair<ID, double>> events_and_times = {{0, 1.0},
+                                                           {5, 0.5},
+                                                           {3, 0.25},
+                                                           {std::numeric_limits<ID>::max(), 1e-300},
+                                                           {std::numeric_limits<ID>::min(), 1e300},
+                                                           {-7, 0.0}};
+    for (int i = 0; i < 1000; ++i)
+    {
+        events_and_times.emplace_back(i * i % 97, 1.0 / (i + 1));
+    }
+    {
+        lotto::TrajectoryRecorder<ID> recorder(file_path, 7);
+        for (const auto& event_and_time : events_and_times)
+        {
+            recorder.record(event_and_time.first, event_and_time.second);
+        }
+        EXPECT_EQ(recorder.get_n_records(), events_and_times.size());
+
+        // Records up to a flush can be read while recording continues
+        recorder.flush();
+        EXPECT_EQ(read_trajectory(), events_and_times);
+        recorder.record(42, 2.0);
+    }
+    events_and_times.emplace_back(42, 2.0);
+    EXPECT_EQ(read_trajectory(), events_and_times);
+}
+
+TEST_F(TrajectoryTest, CompactEncoding)
+{
+    // Checks that consecutive IDs take a single byte each besides the time step
+    int n_records = 1000;
+    {
+        lotto::TrajectoryRecorder<ID> recorder(file_path);
+        for (int i = 0; i < n_records; ++i)
+        {
+            recorder.record(1000000 + i, 1.0);
+        }
+    }
+    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+    long int header_size = 16 + 16;
+    long int first_record_size = 3 + sizeof(double);
+    EXPECT_EQ(file.tellg(), header_size + first_record_size + (n_records - 1) * (1 + sizeof(double)));
+}
+
+TEST_F(TrajectoryTest, InvalidFiles)
+{
+    // Checks that files of other types, or for other event ID types, are rejected
+    {
+        lotto::TrajectoryRecorder<ID> recorder(file_path);
+        recorder.record(1, 1.0);
+    }
+    EXPECT_THROW(lotto::TrajectoryReader<int>{file_path}, std::runtime_error);
+    EXPECT_THROW(lotto::TrajectoryReader<ID>(testing::TempDir() + "lotto_missing_trajectory.bin"), std::runtime_error);
+    EXPECT_THROW(lotto::TrajectoryRecorder<ID>(file_path, 0), std::runtime_error);
+
+    std::ofstream(file_path, std::ios::binary | std::ios::trunc) << "not a trajectory";
+    EXPECT_THROW(lotto::TrajectoryReader<ID>{file_path}, std::runtime_error);
+}
+
+TEST_F(TrajectoryTest, CorruptChunkHeader)
+{
+    // Checks that a chunk header claiming more records or data than the file holds is rejected before allocating
+    std::size_t header_size = sizeof(lotto::TrajectoryFormat::magic) + 2 * sizeof(std::uint32_t);
+    for (std::size_t field_offset : {std::size_t(0), sizeof(std::uint64_t)})
+    {
+        {
+            lotto::TrajectoryRecorder<ID> recorder(file_path);
+            for (ID id = 0; id < 10; ++id)
+            {
+                recorder.record(id, 1.0);
+            }
+        }
+        std::uint64_t corrupt_value = std::numeric_limits<std::uint64_t>::max() / 2;
+        std::fstream file(file_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(header_size + field_offset);
+        file.write(reinterpret_cast<const char*>(&corrupt_value), sizeof(corrupt_value));
+        file.close();
+
+        lotto::TrajectoryReader<ID> reader(file_path);
+        ID event_id;
+        double time_step;
+        EXPECT_THROW(reader.read_event(event_id, time_step), std::runtime_error);
+    }
+}
+
+TEST_F(TrajectoryTest, RecordingEventSelector)
+{
+    // Checks that a recording selector returns the selections of the underlying selector, and records all of them
+    int n_events = 100;
+    std::vector<ID> event_ids;
+    std::map<ID, std::vector<ID>> impact_table;
+    for (ID id = 0; id < n_events; ++id)
+    {
+        event_ids.push_back(id);
+        impact_table[id] = {id};
+    }
+    using SelectorType = lotto::RejectionFreeEventSelector<ID, UniformRateCalculator<ID>>;
+    auto calculator_ptr = std::make_shared<UniformRateCalculator<ID>>(1.0);
+    auto reference_selector_ptr = std::make_shared<SelectorType>(calculator_ptr, event_ids, impact_table);
+    auto selector_ptr = std::make_shared<SelectorType>(calculator_ptr, event_ids, impact_table);
+    reference_selector_ptr->reseed_generator(TEST_SEED);
+    selector_ptr->reseed_generator(TEST_SEED);
+
+    std::vector<std::pair<ID, double>> events_and_times;
+    {
+        auto recorder_ptr = std::make_shared<lotto::TrajectoryRecorder<ID>>(file_path, 64);
+        lotto::RecordingEventSelector<SelectorType, ID> recording_selector(selector_ptr, recorder_ptr);
+        recording_selector.run_steps(1000, [&](const ID& event_id, double time_step) {
+            events_and_times.emplace_back(event_id, time_step);
+            EXPECT_EQ(std::make_pair(event_id, time_step), reference_selector_ptr->select_event());
+        });
+    }
+    EXPECT_EQ(read_trajectory(), events_and_times);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}